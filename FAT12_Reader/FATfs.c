@@ -14,22 +14,125 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "HAL.h"
 #include "FATfs.h"
+#include "FATfs_unpack.h"
+#include "FATfs_entry.h"
+
+/*******************************************************************************
+ * Struct
+ ******************************************************************************/
+
+/*Position in a cluster chain*/
+typedef struct chain_cursor
+{
+    uint32_t extent; /*extent is the index of the current extent*/
+    uint32_t offset; /*offset is the number of clusters of the current extent already passed*/
+} fatfs_chain_cursor_struct_t;
+
+/*Cluster chain of 1 file or subdirectory in the chain index*/
+typedef struct chain_index_entry
+{
+    uint32_t first_cluster;  /*first_cluster is the key of the entry*/
+    uint32_t extent_start;   /*extent_start is the index of the first extent in s_index_extents*/
+    uint32_t extent_count;   /*extent_count is the number of extents of the chain*/
+    uint32_t cluster_count;  /*cluster_count is the number of clusters of the chain*/
+    uint8_t status;          /*status is how the chain ends (fatfs_chain_status_enum_t)*/
+} fatfs_chain_index_entry_struct_t;
+
+/*File or directory of the owner map*/
+typedef struct owner_file
+{
+    uint32_t path_offset; /*path_offset is the position of the path in s_owner_paths*/
+} fatfs_owner_file_struct_t;
+
+/*Regions of the volume, found from the boot sector at mount*/
+typedef struct geometry
+{
+    uint32_t fat_start;    /*fat_start is the first sector of the first FAT*/
+    uint32_t root_start;   /*root_start is the first sector of the root directory (FAT12/FAT16)*/
+    uint32_t root_sectors; /*root_sectors is the number of sectors of the root directory, 0 on FAT32*/
+    uint32_t data_start;   /*data_start is the first sector of cluster 2*/
+    uint32_t cluster_size; /*cluster_size is the size of a cluster in bytes*/
+    uint32_t root_cluster; /*root_cluster is the first cluster of the FAT32 root directory*/
+} fatfs_geometry_struct_t;
+
+/*File or directory of the path index*/
+typedef struct path_entry
+{
+    uint32_t hash;               /*hash is the hash of the path*/
+    uint32_t path_offset;        /*path_offset is the position of the path in s_path_names*/
+    uint32_t path_length;        /*path_length is the length of the path*/
+    fatfs_dirent_struct_t entry; /*entry is the directory entry of the path*/
+} fatfs_path_entry_struct_t;
+
+/*States of a node of the dentry cache*/
+typedef enum dentry_state
+{
+    FATFS_DENTRY_FREE,     /*the node holds no lookup*/
+    FATFS_DENTRY_POSITIVE, /*the name is in the directory*/
+    FATFS_DENTRY_NEGATIVE  /*the name is not in the directory*/
+} fatfs_dentry_state_enum_t;
+
+/*1 lookup kept by the dentry cache, the key is the parent directory and the 8.3 name*/
+typedef struct dentry
+{
+    uint32_t parent;               /*parent is the first cluster of the directory looked in*/
+    uint32_t next;                 /*next is the next node of the bucket + 1, 0 ends the bucket*/
+    uint8_t name[FATFS_NAME_SIZE]; /*name is the 8.3 name looked up, as stored on the disk*/
+    uint8_t state;                 /*state is a fatfs_dentry_state_enum_t value*/
+    uint8_t referenced;            /*referenced is set by a hit and cleared when the clock hand passes*/
+    fatfs_dirent_struct_t entry;   /*entry is the entry found (FATFS_DENTRY_POSITIVE)*/
+} fatfs_dentry_struct_t;
+
+/*Iterator over the entries of 1 directory, the buffer follows the struct in the same allocation*/
+struct fatfs_dir
+{
+    uint32_t next;        /*next is the next cluster to read, 0 once the chain ended*/
+    uint32_t root_sector; /*root_sector is the next sector of the FAT12/FAT16 root directory to read*/
+    uint32_t steps;       /*steps is the number of clusters read, it bounds a looping chain*/
+    uint32_t offset;      /*offset is the offset of the next entry in the buffer*/
+    uint32_t size;        /*size is the number of bytes held in the buffer*/
+    uint8_t fixed;        /*fixed is 1 for the FAT12/FAT16 root directory, a run of sectors*/
+    uint8_t end;          /*end is 1 once the last entry was returned*/
+    uint8_t failed;       /*failed is 1 if a read of the directory came back short, the end is then not the real end*/
+    uint8_t buffer[];     /*buffer holds 1 cluster of the directory*/
+};
+
+/*Forms of the FAT a chain walker reads, 1 walker is built for each*/
+typedef enum fat_access
+{
+    FATFS_ACCESS_PACKED12,   /*s_fat_table, 2 entries in 3 bytes*/
+    FATFS_ACCESS_EXPANDED12, /*s_fat_next, 1 uint16_t per entry*/
+    FATFS_ACCESS_TABLE16,    /*s_fat_table, 2 bytes per entry*/
+    FATFS_ACCESS_TABLE32,    /*s_fat_table, 4 bytes per entry*/
+    FATFS_ACCESS_PAGED       /*read_FAT_entry, the sectors of the FAT are read on demand*/
+} fatfs_fat_access_enum_t;
+
+/*Chain walker built for 1 form of the FAT*/
+typedef uint32_t (*fatfs_walk_chain_func)(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster);
+
+/*1 FAT sector kept by the paged FAT*/
+typedef struct fat_page
+{
+    uint32_t sector;   /*sector is the sector of the FAT held by the page*/
+    uint64_t last_use; /*last_use is the tick of the last lookup, the smallest tick is dropped first*/
+} fatfs_fat_page_struct_t;
 
 /*******************************************************************************
  * Static function prototype
  ******************************************************************************/
 
 /**
- * @brief Clear the current linked list "cluster_chain" by free it's memory space.
+ * @brief Clear a cluster chain, its extent array is kept for the next chain.
  *
- * @param cluster_chain is the linked list of cluster chain we want to clear.
+ * @param chain is the cluster chain we want to clear.
  *
  * @return: This function return nothing
  */
-static void fatfs_clear_cluster_chain(void);
+static void fatfs_clear_cluster_chain(fatfs_chain_struct_t *chain);
 
 
 /**
@@ -50,524 +153,4107 @@ static uint64_t hex_to_decimal(uint8_t *hex_line, uint32_t index, uint8_t bytes_
  *
  * @return the value of the element at "logical_cluster" position in FAT table.
  */
-static uint16_t read_FAT_entry(uint16_t logical_cluster);
+static uint32_t read_FAT_entry(uint32_t logical_cluster);
 
 /**
- * @brief Add new node(cluster index) to the cluster_chain.
+ * @brief Get the page holding a sector of the FAT, read the sector into the least recently used
+ *        page if it is not kept.
  *
- * @param logical_cluster is the logical number of a cluster.
+ * @param sector is the sector of the FAT.
+ *
+ * @return the data of the page, NULL if the sector could not be read.
+ */
+static const uint8_t *fatfs_get_FAT_page(uint32_t sector);
+
+/**
+ * @brief Read an entry of the paged FAT, its 2 bytes may be in 2 sectors.
+ *
+ * @param logical_cluster is the position we want to read.
+ *
+ * @return the value of the entry, an end of chain mark if the sectors could not be read.
+ */
+static uint32_t fatfs_read_paged_entry(uint32_t logical_cluster);
+
+/**
+ * @brief Allocate the pages of the paged FAT, no sector is read.
+ *
+ * @param sector_size is the size of a sector.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_init_FAT_pages(uint32_t sector_size);
+
+/**
+ * @brief Read a monotonic clock.
+ *
+ * @param: This function has no param.
+ *
+ * @return the time in microseconds.
+ */
+static uint64_t fatfs_now_us(void);
+
+/**
+ * @brief Expand the packed 12-bit FAT table into s_fat_next, 1 uint16_t per cluster.
+ *
+ * @param: This function has no param.
  *
  * @return: This function return nothing.
  */
-static void fatfs_add_node(uint16_t logical_cluster);
+static void fatfs_expand_FAT(void);
+
+/**
+ * @brief Append a cluster to a cluster chain, it extends the last extent if it follows it.
+ *
+ * @param chain is the cluster chain.
+ * @param logical_cluster is the logical number of a cluster.
+ *
+ * @return 0 on success, -1 if the extent array could not grow.
+ */
+static int32_t fatfs_add_cluster(fatfs_chain_struct_t *chain, uint32_t logical_cluster);
 
 
 /**
- * @brief Set up a linked list that stores the cluster chain of a file or subdirectory.
+ * @brief Set up the extents of the cluster chain of a file or subdirectory, in 1 pass over the FAT.
  *
+ * @param chain stores the cluster chain.
  * @param first_logical_cluster is the firs logical cluster number of the file/subdirectory .
  *
- * @return the length of the list.
+ * @return the number of clusters in the chain.
  */
-static uint32_t fatfs_get_cluster_chain(uint16_t first_logical_cluster);
+static uint32_t fatfs_get_cluster_chain(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster);
 
-/*******************************************************************************
- * Variable
- ******************************************************************************/
+/**
+ * @brief The chain walker, built once for each form of the FAT so the loop reads the entries
+ *        without testing the width.
+ *
+ * @param chain stores the clusters of the chain.
+ * @param first_logical_cluster is the first logical cluster number of the file/subdirectory.
+ * @param access is the form of the FAT read, a constant in each caller.
+ *
+ * @return the number of clusters of the chain.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_walk_chain(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster, fatfs_fat_access_enum_t access);
 
-/*This variable stores the information of boot sector*/
-static fatfs_boot_sector_struct_t s_FAT12Infor;
+/**
+ * @brief The chain walkers of each form of the FAT (see fatfs_walk_chain).
+ *
+ * @param chain stores the clusters of the chain.
+ * @param first_logical_cluster is the first logical cluster number of the file/subdirectory.
+ *
+ * @return the number of clusters of the chain.
+ */
+static uint32_t fatfs_walk_chain_packed12(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster);
+static uint32_t fatfs_walk_chain_expanded12(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster);
+static uint32_t fatfs_walk_chain_table16(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster);
+static uint32_t fatfs_walk_chain_table32(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster);
+static uint32_t fatfs_walk_chain_paged(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster);
 
-/*This variable stores the FAT table data*/
-static uint8_t *s_fat_table = NULL;
+/**
+ * @brief Find the regions of the volume from the boot sector: the reserved sectors, the FATs, the
+ *        root directory (FAT12/FAT16), then the data region.
+ *
+ * @param: This function has no param.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_find_geometry(void);
 
-/*This varible stores the entry list of a directory*/
-static fatfs_entry_list_struct_t s_dirlist;
+/**
+ * @brief Get the first sector of a data cluster.
+ *
+ * @param logical_cluster is the logical number of the cluster (2 or more).
+ *
+ * @return the sector of the cluster.
+ */
+static uint32_t fatfs_cluster_sector(uint32_t logical_cluster);
 
-/*This variable stores a cluster chain*/
-static fatfs_node_struct_t *s_cluster_chain = NULL;
+/**
+ * @brief Read the next cluster of a directory into the buffer of its iterator.
+ *
+ * @param dir is the iterator.
+ *
+ * @return the number of bytes read, 0 at the end of the directory.
+ */
+static uint32_t fatfs_dir_fill(fatfs_dir_t *dir);
 
-/*Call back pointer*/
-static callback_print_filecontent print_file_callback = NULL;
+/**
+ * @brief Find the width of the FAT entries from the number of clusters of the volume, the way the
+ *        FAT specification does (less than 4085 clusters is FAT12, less than 65525 is FAT16).
+ *
+ * @param: This function has no param.
+ *
+ * @return the width of the entries.
+ */
+static fatfs_fat_width_enum_t fatfs_find_FAT_width(void);
 
-/*******************************************************************************
- * Static functions
- ******************************************************************************/
+/**
+ * @brief Get the first cluster of a directory entry, the high word is used on FAT32 only.
+ *
+ * @param entry is the 32-byte directory entry.
+ *
+ * @return the first cluster of the entry.
+ */
+static uint32_t fatfs_entry_cluster(const uint8_t *entry);
 
-/*Static functions*************************************************************
-*
-* Function name: fatfs_clear_cluster_chain.
-* Description: Clear the linked list "cluster_chain" by freeing it's memory space.
-*
-END***************************************************************************/
-static void fatfs_clear_cluster_chain(void)
-{
-    fatfs_node_struct_t *temp = NULL; /*temp is used for traversaling the list*/
+/**
+ * @brief Read the next clusters of the cluster chain with 1 extent list, each extent of the
+ *        chain is 1 request.
+ *
+ * @param chain is the cluster chain.
+ * @param cursor is the first cluster to read, it is moved past the clusters read, or to the end of
+ *        the chain on a short read.
+ * @param buffer is the buffer that stores the clusters.
+ *
+ * @return the number of whole clusters read (at most FATFS_IO_BATCH_CLUSTERS).
+ */
+static uint32_t fatfs_read_cluster_batch(const fatfs_chain_struct_t *chain, fatfs_chain_cursor_struct_t *cursor, uint8_t *buffer);
 
-    /*Traversal the list*/
-    while (s_cluster_chain != NULL)
-    {
-        /*Set temp to the new head node*/
-        temp = s_cluster_chain;
+/**
+ * @brief Get the cluster chain of a file or subdirectory, from the chain index if it has it.
+ *
+ * @param first_logical_cluster is the firs logical cluster number of the file/subdirectory.
+ *
+ * @return the cluster chain, valid until the next call.
+ */
+static const fatfs_chain_struct_t *fatfs_find_chain(uint32_t first_logical_cluster);
 
-        /*Move head to next node*/
-        s_cluster_chain = s_cluster_chain->next;
+/**
+ * @brief Read the whole content of the root directory or of a subdirectory.
+ *
+ * @param first_logical_cluster is the firs logical cluster number of the directory (0 for root).
+ * @param buffer_size stores the size of the content, the bytes read before a short read.
+ *
+ * @return the content (to be freed by the caller), NULL if the directory is empty.
+ */
+static uint8_t *fatfs_load_dir(uint32_t first_logical_cluster, uint32_t *buffer_size);
 
-        /*Free the previous node*/
-        free(temp);
-    }
+/**
+ * @brief Write the name of a directory entry as "NAME.EXT".
+ *
+ * @param entry is the directory entry.
+ * @param name stores the name, at least 13 bytes.
+ *
+ * @return the length of the name.
+ */
+static uint32_t fatfs_format_name(const uint8_t *entry, uint8_t *name);
 
-    /*Set the head node to NULL*/
-    s_cluster_chain = NULL;
+/**
+ * @brief Add the chain stored in s_cluster_chain to the chain index.
+ *
+ * @param first_logical_cluster is the firs logical cluster number of the chain.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_index_chain(uint32_t first_logical_cluster);
 
-    return;
-}
+/**
+ * @brief Add a file or directory to the owner map.
+ *
+ * @param path is the full path of the file/subdirectory.
+ * @param path_length is the length of the path.
+ * @param chain is the cluster chain of the file/subdirectory, NULL for the root directory.
+ *
+ * @return the file ID given, FATFS_OWNER_NONE if the owner map is full.
+ */
+static uint16_t fatfs_owner_add(const uint8_t *path, uint32_t path_length, const fatfs_chain_struct_t *chain);
 
-/*Static functions*************************************************************
-*
-* Function name: hex_to_decimal.
-* Description: Read a hex value in little endian form to decimal value.
-*
-END***************************************************************************/
-static uint64_t hex_to_decimal(uint8_t *hex_line, uint32_t index, uint8_t bytes_count)
-{
-    uint64_t decimal_value = 0; /*decimal_value stores the decimal value of a hex string*/
-    uint32_t i = 0;             /*i used for traversaling the hex string*/
-    uint32_t byte_offset = 0;   /*byte_offset is the position we want to start reading in the hex-buffer*/
-    uint32_t line_length = 0;   /*line_length stores the length of the hex buffer string*/
+/**
+ * @brief Add a file or directory to the path index.
+ *
+ * @param path is the full path of the file/subdirectory.
+ * @param path_length is the length of the path.
+ * @param raw is the directory entry of the file/subdirectory.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_path_add(const uint8_t *path, uint32_t path_length, const uint8_t *raw);
 
-    /*Get the length of the hex buffer string*/
-    line_length = strlen(hex_line);
+/**
+ * @brief Build the hash table of the path index once the directory tree was walked.
+ *
+ * @param: This function has no param.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_build_path_table(void);
 
-    /*Check if the index is valid*/
-    if (index >= line_length && index < 0)
-    {
-        /*Do nothing*/
-    }
-    else
-    {
-        /*Convert hex string in little endian to decimal value*/
-        for (i = 0; i < bytes_count; i++)
-        {
-            byte_offset = index + i;
-            decimal_value += hex_line[byte_offset] << (8 * i);
-        }
-    }
+/**
+ * @brief Hash a path (FNV-1a).
+ *
+ * @param path is the path.
+ * @param length is the length of the path.
+ *
+ * @return the hash of the path.
+ */
+static uint32_t fatfs_path_hash(const uint8_t *path, uint32_t length);
 
-    return decimal_value;
-}
+/**
+ * @brief Find a path in the hash table of the path index.
+ *
+ * @param path is the normalized path.
+ * @param length is the length of the path.
+ *
+ * @return the entry of the path, NULL if the path is not in the index.
+ */
+static const fatfs_path_entry_struct_t *fatfs_path_find(const uint8_t *path, uint32_t length);
 
-/*Static functions*************************************************************
-*
-* Function name: read_FAT_entry.
-* Description: Read 12-bit element (litter endian) in FAT table at the position
-*              "logical_cluster" to a decimal value.
-*
-END***************************************************************************/
-static uint16_t read_FAT_entry(uint16_t logical_cluster)
-{
-    uint16_t FAT_entry = 0;  /*FAT_entry stores the value of the element at "logical_cluster" position in FAT table*/
-    uint16_t four_bits = 0;  /*four_bits stores the value of 4-bit part of an FAT entry element*/
-    uint16_t eight_bits = 0; /*eight_bits stores the value of 8-bit part of an FAT entry element */
+/**
+ * @brief Normalize a path: "/" then the upper-cased names joined by "/", see fatfs_stat_path.
+ *
+ * @param path is the path.
+ * @param normal stores the normalized path, FATFS_MAX_PATH bytes.
+ *
+ * @return the length of the normalized path, 0 if it does not fit in FATFS_MAX_PATH bytes.
+ */
+static uint32_t fatfs_normalize_path(const uint8_t *path, uint8_t *normal);
 
-    /*If the logical number is odd*/
-    if (logical_cluster & 1)
-    {
-        four_bits = s_fat_table[(3 * logical_cluster) / 2] >> 4;
+/**
+ * @brief Find a normalized path by reading the directories level by level.
+ *
+ * @param path is the normalized path, not the root directory.
+ * @param length is the length of the path.
+ * @param entry stores the entry of the path.
+ *
+ * @return 0 if the path was found, -1 if not.
+ */
+static int32_t fatfs_walk_path(const uint8_t *path, uint32_t length, fatfs_dirent_struct_t *entry);
 
-        eight_bits = s_fat_table[(3 * logical_cluster) / 2 + 1] << 4;
+/**
+ * @brief Find a name in a directory, from the dentry cache if it is kept there, by reading the
+ *        directory otherwise.
+ *
+ * @param cluster is the first cluster of the directory.
+ * @param name is the name as "NAME.EXT".
+ * @param name_length is the length of the name.
+ * @param entry stores the entry of the name.
+ *
+ * @return 0 if the name was found, -1 if not.
+ */
+static int32_t fatfs_lookup_name(uint32_t cluster, const uint8_t *name, uint32_t name_length, fatfs_dirent_struct_t *entry);
 
-        FAT_entry = four_bits + eight_bits;
-    }
-    /*If it's even*/
+/**
+ * @brief Turn a name "NAME.EXT" into the 8.3 name stored on the disk.
+ *
+ * @param name is the name.
+ * @param name_length is the length of the name.
+ * @param key stores the 8.3 name, FATFS_NAME_SIZE bytes.
+ *
+ * @return 1 if the name has an 8.3 form, 0 if no entry can have this name.
+ */
+static uint8_t fatfs_dentry_key(const uint8_t *name, uint32_t name_length, uint8_t *key);
+
+/**
+ * @brief Get the bucket of a key of the dentry cache.
+ *
+ * @param parent is the first cluster of the directory.
+ * @param key is the 8.3 name.
+ *
+ * @return the bucket.
+ */
+static uint32_t fatfs_dentry_bucket(uint32_t parent, const uint8_t *key);
+
+/**
+ * @brief Find a key in the dentry cache.
+ *
+ * @param parent is the first cluster of the directory.
+ * @param key is the 8.3 name.
+ *
+ * @return the node of the key, NULL if the key is not kept.
+ */
+static fatfs_dentry_struct_t *fatfs_dentry_find(uint32_t parent, const uint8_t *key);
+
+/**
+ * @brief Keep a lookup in the dentry cache, a node is dropped if the cache is full.
+ *
+ * @param parent is the first cluster of the directory.
+ * @param key is the 8.3 name.
+ * @param entry is the entry found, NULL if the name is not in the directory.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_dentry_add(uint32_t parent, const uint8_t *key, const fatfs_dirent_struct_t *entry);
+
+/**
+ * @brief Allocate the nodes and the buckets of the dentry cache.
+ *
+ * @param: This function has no param.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_init_dentry_cache(void);
+
+/**
+ * @brief Add the entries of a directory to the indexes asked in the mount options, then the
+ *        entries of its subdirectories.
+ *
+ * @param first_logical_cluster is the firs logical cluster number of the directory (0 for root).
+ * @param depth is the depth of the directory, the walk stops at FATFS_INDEX_MAX_DEPTH.
+ * @param path stores the path of the directory, FATFS_MAX_PATH bytes.
+ * @param path_length is the length of the path of the directory.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_index_dir(uint32_t first_logical_cluster, uint32_t depth, uint8_t *path, uint32_t path_length);
+
+/**
+ * @brief Get the end of the data clusters of the volume.
+ *
+ * @param: This function has no param.
+ *
+ * @return the number past the last data cluster, bounded by the size of the FAT table.
+ */
+static uint32_t fatfs_data_cluster_end(void);
+
+/**
+ * @brief Count the set bits of a bitmap.
+ *
+ * @param bits is the bitmap.
+ * @param size is the size of the bitmap in bytes.
+ *
+ * @return the number of set bits.
+ */
+static uint32_t fatfs_count_bits(const uint8_t *bits, uint32_t size);
+
+/**
+ * @brief Build the free/bad/reserved bitmaps from the FAT and the allocation summary.
+ *
+ * @param: This function has no param.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_build_space_map(void);
+
+/**
+ * @brief Count the entries of 1 sector of 1 copy of the FAT that can not be right: the value 1, a
+ *        cluster past the volume or the cluster itself.
+ *
+ * @param table is the copy of the FAT.
+ * @param sector is the sector of the FAT.
+ * @param sector_size is the size of a sector.
+ *
+ * @return the number of invalid entries starting in the sector.
+ */
+static uint32_t fatfs_count_invalid_entries(const uint8_t *table, uint32_t sector, uint32_t sector_size);
+
+/**
+ * @brief Read every copy of the FAT, compare them per sector and, with FATFS_OPT_FAT_REPAIR,
+ *        replace the sectors of s_fat_table by the consistent copy.
+ *
+ * @param sector_size is the size of a sector.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_load_FAT_copies(uint32_t sector_size);
+
+/**
+ * @brief Build the indexes asked in the mount options.
+ *
+ * @param: This function has no param.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_build_indexes(void);
+
+/**
+ * @brief Compare 2 entries of the chain index by first cluster (qsort callback).
+ *
+ * @param a is the first entry.
+ * @param b is the second entry.
+ *
+ * @return <0, 0 or >0.
+ */
+static int fatfs_index_compare(const void *a, const void *b);
+
+/**
+ * @brief Free the chain index and the owner map.
+ *
+ * @param: This function has no param.
+ *
+ * @return: This function return nothing.
+ */
+static void fatfs_clear_index(void);
+
+/*******************************************************************************
+ * Variable
+ ******************************************************************************/
+
+/*This variable stores the handle of the opened disk image*/
+static kmc_dev_t *s_dev = NULL;
+
+/*This variable tells if s_dev was opened by fatfs_init (and must be closed here)*/
+static uint8_t s_dev_owned = 0;
+
+/*This variable stores the information of boot sector*/
+static fatfs_boot_sector_struct_t s_FAT12Infor;
+
+/*This variable stores the regions of the volume*/
+static fatfs_geometry_struct_t s_geometry;
+
+/*This variable stores the FAT table data*/
+static uint8_t *s_fat_table = NULL;
+
+/*This variable stores the number of entries in the FAT table*/
+static uint32_t s_fat_entry_count = 0;
+
+/*This variable stores the width of the FAT entries*/
+static fatfs_fat_width_enum_t s_fat_width = FATFS_FAT12;
+
+/*This variable stores the chain walker of the form of the FAT, chosen at mount*/
+static fatfs_walk_chain_func s_walk_chain = fatfs_walk_chain_packed12;
+
+/*This variable stores the expanded FAT table (next cluster of each cluster), NULL if not expanded*/
+static uint16_t *s_fat_next = NULL;
+
+/*This variable marks the clusters of the chain being walked, 1 bit per cluster, NULL if the
+  chain length is only bounded by the number of clusters*/
+static uint8_t *s_chain_seen = NULL;
+
+/*This variable stores every copy of the FAT one after another, NULL if the copies are not loaded*/
+static uint8_t *s_fat_copies = NULL;
+
+/*This variable stores the size of 1 copy of the FAT in bytes*/
+static uint32_t s_fat_size = 0;
+
+/*This variable stores the result of the comparison of the FAT copies*/
+static fatfs_fat_copies_stats_struct_t s_fat_copies_stats;
+
+/*This variable stores the pages of the paged FAT, NULL if the FAT is not paged*/
+static fatfs_fat_page_struct_t *s_fat_pages = NULL;
+
+/*This variable stores the data of the pages, 1 sector per page*/
+static uint8_t *s_fat_page_data = NULL;
+
+/*This variable stores the page of each sector of the FAT plus 1, 0 if the sector is not kept*/
+static uint32_t *s_fat_page_of = NULL;
+
+/*This variable stores the size of 1 page*/
+static uint32_t s_fat_page_size = 0;
+
+/*This variable stores the tick of the paged FAT lookups*/
+static uint64_t s_fat_page_tick = 0;
+
+/*This variable stores the number of pages of the next mount, 0 for FATFS_FAT_PAGE_BUDGET*/
+static uint32_t s_fat_page_budget = 0;
+
+/*This variable stores the mount time and the paging counters*/
+static fatfs_fat_stats_struct_t s_fat_stats;
+
+/*This variable stores the options of the next mount*/
+static uint32_t s_mount_options = FATFS_OPT_NONE;
+
+/*This varible stores the entry list of a directory*/
+static fatfs_entry_list_struct_t s_dirlist;
+
+/*This variable stores a cluster chain*/
+static fatfs_chain_struct_t s_cluster_chain = {NULL, 0, 0, 0, FATFS_CHAIN_OK};
+
+/*This variable stores the chain index, sorted by first cluster*/
+static fatfs_chain_index_entry_struct_t *s_index = NULL;
+
+/*This variable stores the number of entries in s_index, and the size of s_index*/
+static uint32_t s_index_count = 0;
+static uint32_t s_index_capacity = 0;
+
+/*This variable stores the extents of every chain of the chain index*/
+static fatfs_chain_struct_t s_index_extents = {NULL, 0, 0, 0, FATFS_CHAIN_OK};
+
+/*This variable stores the chain of the last index hit, its extents point into s_index_extents*/
+static fatfs_chain_struct_t s_index_view = {NULL, 0, 0, 0, FATFS_CHAIN_OK};
+
+/*This variable stores the free, bad and reserved bitmaps one after another, NULL if not built*/
+static uint8_t *s_space_bits = NULL;
+
+/*This variable stores the size of 1 bitmap of s_space_bits in bytes*/
+static uint32_t s_space_size = 0;
+
+/*This variable stores the allocation summary*/
+static fatfs_space_stats_struct_t s_space_stats;
+
+/*This variable marks the first clusters already indexed while the indexes are built*/
+static uint8_t *s_index_seen = NULL;
+
+/*This variable stores the file ID owning each cluster, NULL if the owner map is not built*/
+static uint16_t *s_owner = NULL;
+
+/*This variable stores the files of the owner map, file ID n is s_owner_files[n - 1]*/
+static fatfs_owner_file_struct_t *s_owner_files = NULL;
+static uint32_t s_owner_file_count = 0;
+static uint32_t s_owner_file_capacity = 0;
+
+/*This variable stores the paths of the files of the owner map, each path ends with '\0'*/
+static uint8_t *s_owner_paths = NULL;
+static uint32_t s_owner_paths_size = 0;
+static uint32_t s_owner_paths_capacity = 0;
+
+/*This variable stores the files and directories of the path index*/
+static fatfs_path_entry_struct_t *s_path_entries = NULL;
+static uint32_t s_path_count = 0;
+static uint32_t s_path_capacity = 0;
+
+/*This variable stores the paths of the path index, each path ends with '\0'*/
+static uint8_t *s_path_names = NULL;
+static uint32_t s_path_names_size = 0;
+static uint32_t s_path_names_capacity = 0;
+
+/*This variable is 1 if an entry could not be added to the path index, the table is then not built*/
+static uint8_t s_path_incomplete = 0;
+
+/*This variable is 1 if a directory linked twice was walked once, the paths under its second link
+  are then not in the path index*/
+static uint8_t s_path_pruned = 0;
+
+/*This variable stores the hash table of the path index, entry n of s_path_entries is n + 1, 0 is
+  a free slot. NULL if the path index is not built*/
+static uint32_t *s_path_slots = NULL;
+
+/*This variable stores the number of slots of s_path_slots minus 1, the number is a power of 2*/
+static uint32_t s_path_slot_mask = 0;
+
+/*This variable stores the nodes of the dentry cache, NULL if the cache is not used*/
+static fatfs_dentry_struct_t *s_dentries = NULL;
+
+/*This variable stores the first node of each bucket of the dentry cache + 1, 0 is an empty bucket*/
+static uint32_t *s_dentry_buckets = NULL;
+
+/*This variable stores the number of buckets of the dentry cache minus 1, the number is a power of 2*/
+static uint32_t s_dentry_bucket_mask = 0;
+
+/*This variable stores the clock hand, the next node looked at to be dropped*/
+static uint32_t s_dentry_hand = 0;
+
+/*This variable stores the number of lookups kept by the next mount, 0 for FATFS_DENTRY_CACHE_BUDGET*/
+static uint32_t s_dentry_budget = 0;
+
+/*This variable stores the counters of the dentry cache*/
+static fatfs_dentry_stats_struct_t s_dentry_stats;
+
+/*Call back pointer*/
+static callback_print_filecontent print_file_callback = NULL;
+
+/*******************************************************************************
+ * Static functions
+ ******************************************************************************/
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_clear_cluster_chain.
+* Description: Clear a cluster chain. The extent array is kept, so the next
+*              chain does not allocate unless it has more extents.
+*
+END***************************************************************************/
+static void fatfs_clear_cluster_chain(fatfs_chain_struct_t *chain)
+{
+    chain->extent_count = 0;
+    chain->cluster_count = 0;
+    chain->status = FATFS_CHAIN_OK;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hex_to_decimal.
+* Description: Read a hex value in little endian form to decimal value.
+*
+END***************************************************************************/
+static uint64_t hex_to_decimal(uint8_t *hex_line, uint32_t index, uint8_t bytes_count)
+{
+    uint64_t decimal_value = 0; /*decimal_value stores the decimal value of a hex string*/
+    uint32_t i = 0;             /*i used for traversaling the hex string*/
+    uint32_t byte_offset = 0;   /*byte_offset is the position we want to start reading in the hex-buffer*/
+    uint32_t line_length = 0;   /*line_length stores the length of the hex buffer string*/
+
+    /*Get the length of the hex buffer string*/
+    line_length = strlen(hex_line);
+
+    /*Check if the index is valid*/
+    if (index >= line_length && index < 0)
+    {
+        /*Do nothing*/
+    }
+    else
+    {
+        /*Convert hex string in little endian to decimal value*/
+        for (i = 0; i < bytes_count; i++)
+        {
+            byte_offset = index + i;
+            decimal_value += hex_line[byte_offset] << (8 * i);
+        }
+    }
+
+    return decimal_value;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: read_FAT_entry.
+* Description: Read 12-bit element (litter endian) in FAT table at the position
+*              "logical_cluster" to a decimal value. The 16 and 32-bit entries
+*              are read by the decoders of FATfs_entry.h.
+*
+END***************************************************************************/
+static uint32_t read_FAT_entry(uint32_t logical_cluster)
+{
+    uint32_t FAT_entry = 0;  /*FAT_entry stores the value of the element at "logical_cluster" position in FAT table*/
+    uint16_t four_bits = 0;  /*four_bits stores the value of 4-bit part of an FAT entry element*/
+    uint16_t eight_bits = 0; /*eight_bits stores the value of 8-bit part of an FAT entry element */
+
+    /*A cluster outside the table ends the chain*/
+    if (logical_cluster >= s_fat_entry_count)
+    {
+        FAT_entry = fatfs_entry_mask(s_fat_width);
+    }
+    /*If the table is expanded, 1 load per entry*/
+    else if (NULL != s_fat_next)
+    {
+        FAT_entry = s_fat_next[logical_cluster];
+    }
+    /*If the table is paged, its sectors are read on demand*/
+    else if (NULL != s_fat_pages)
+    {
+        FAT_entry = fatfs_read_paged_entry(logical_cluster);
+    }
+    /*If the entries are 16 or 32 bits wide*/
+    else if (FATFS_FAT12 != s_fat_width)
+    {
+        FAT_entry = fatfs_decode(s_fat_width, s_fat_table, logical_cluster);
+    }
+    /*If the logical number is odd*/
+    else if (logical_cluster & 1)
+    {
+        four_bits = s_fat_table[(3 * logical_cluster) / 2] >> 4;
+
+        eight_bits = s_fat_table[(3 * logical_cluster) / 2 + 1] << 4;
+
+        FAT_entry = four_bits + eight_bits;
+    }
+    /*If it's even*/
+    else
+    {
+        four_bits = (s_fat_table[(3 * logical_cluster) / 2 + 1] & 0x0f) << 8;
+
+        eight_bits = s_fat_table[(3 * logical_cluster) / 2];
+
+        FAT_entry = four_bits + eight_bits;
+    }
+
+    return FAT_entry;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_get_FAT_page.
+* Description: The page of a kept sector is found in s_fat_page_of, a sector
+*              not kept goes to an empty page or to the page used least
+*              recently.
+*
+END***************************************************************************/
+static const uint8_t *fatfs_get_FAT_page(uint32_t sector)
+{
+    uint32_t page = s_fat_page_of[sector]; /*page stores the page of the sector plus 1*/
+    uint32_t i = 0;                        /*i used for traversaling the pages*/
+
+    s_fat_page_tick++;
+
+    if (0 != page)
+    {
+        page--;
+        s_fat_stats.page_hits++;
+    }
+    else
+    {
+        /*Take an empty page, else the least recently used one*/
+        if (s_fat_stats.resident_pages < s_fat_stats.page_budget)
+        {
+            page = s_fat_stats.resident_pages;
+            s_fat_stats.resident_pages++;
+        }
+        else
+        {
+            for (i = 1; i < s_fat_stats.page_budget; i++)
+            {
+                if (s_fat_pages[i].last_use < s_fat_pages[page].last_use)
+                {
+                    page = i;
+                }
+                else
+                {
+                    /*Do nothing*/
+                }
+            }
+
+            s_fat_page_of[s_fat_pages[page].sector] = 0;
+            s_fat_stats.page_evictions++;
+        }
+
+        if (s_fat_page_size != (uint32_t)kmc_read_sector(s_dev, s_geometry.fat_start + sector, s_fat_page_data + (size_t)page * s_fat_page_size))
+        {
+            /*Give the page back, the last kept page takes its place*/
+            s_fat_stats.resident_pages--;
+
+            if (page != s_fat_stats.resident_pages)
+            {
+                s_fat_pages[page] = s_fat_pages[s_fat_stats.resident_pages];
+                memcpy(s_fat_page_data + (size_t)page * s_fat_page_size, s_fat_page_data + (size_t)s_fat_stats.resident_pages * s_fat_page_size, s_fat_page_size);
+                s_fat_page_of[s_fat_pages[page].sector] = page + 1;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+
+            return NULL;
+        }
+        else
+        {
+            s_fat_pages[page].sector = sector;
+            s_fat_page_of[sector] = page + 1;
+            s_fat_stats.page_loads++;
+        }
+    }
+
+    s_fat_pages[page].last_use = s_fat_page_tick;
+
+    return s_fat_page_data + (size_t)page * s_fat_page_size;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_read_paged_entry.
+* Description: A 16 or 32-bit entry is in 1 sector. For a 12-bit entry read
+*              the 2 bytes, then decode them as read_FAT_entry does. The first
+*              byte is copied before the second sector is looked up, the
+*              lookup may drop its page.
+*
+END***************************************************************************/
+static uint32_t fatfs_read_paged_entry(uint32_t logical_cluster)
+{
+    uint32_t offset = fatfs_entry_offset(s_fat_width, logical_cluster); /*offset is the offset of the entry in the FAT*/
+    const uint8_t *page = NULL;                                         /*page stores the data of a page*/
+    uint16_t low = 0;                                                   /*low stores the first byte of the entry*/
+    uint16_t high = 0;                                                  /*high stores the second byte of the entry*/
+
+    page = fatfs_get_FAT_page(offset / s_fat_page_size);
+
+    if (NULL == page)
+    {
+        return fatfs_entry_mask(s_fat_width);
+    }
+    else if (FATFS_FAT12 != s_fat_width)
+    {
+        return fatfs_decode(s_fat_width, page, (offset % s_fat_page_size) / (s_fat_width / 8));
+    }
+    else
+    {
+        low = page[offset % s_fat_page_size];
+    }
+
+    /*The entry crosses the end of the sector*/
+    if (0 == (offset + 1) % s_fat_page_size)
+    {
+        page = fatfs_get_FAT_page((offset + 1) / s_fat_page_size);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL == page)
+    {
+        return fatfs_entry_mask(s_fat_width);
+    }
+    else
+    {
+        high = page[(offset + 1) % s_fat_page_size];
+    }
+
+    if (logical_cluster & 1)
+    {
+        return (low >> 4) + (high << 4);
+    }
+    else
+    {
+        return ((high & 0x0f) << 8) + low;
+    }
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_init_FAT_pages.
+* Description: Allocate the pages and the sector to page map. The map is
+*              zeroed by calloc, no sector is kept.
+*
+END***************************************************************************/
+static void fatfs_init_FAT_pages(uint32_t sector_size)
+{
+    uint32_t budget = (0 != s_fat_page_budget) ? s_fat_page_budget : FATFS_FAT_PAGE_BUDGET; /*budget is the number of pages*/
+
+    /*No more pages than sectors*/
+    if (budget > s_FAT12Infor.sectors_per_FAT)
+    {
+        budget = s_FAT12Infor.sectors_per_FAT;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if ((0 == budget) || (0 == sector_size))
+    {
+        return;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    s_fat_pages = (fatfs_fat_page_struct_t *)calloc(budget, sizeof(fatfs_fat_page_struct_t));
+    s_fat_page_data = (uint8_t *)malloc((size_t)budget * sector_size);
+    s_fat_page_of = (uint32_t *)calloc(s_FAT12Infor.sectors_per_FAT, sizeof(uint32_t));
+
+    if ((NULL == s_fat_pages) || (NULL == s_fat_page_data) || (NULL == s_fat_page_of))
+    {
+        /*The whole table is read instead*/
+        free(s_fat_pages);
+        free(s_fat_page_data);
+        free(s_fat_page_of);
+        s_fat_pages = NULL;
+        s_fat_page_data = NULL;
+        s_fat_page_of = NULL;
+    }
+    else
+    {
+        s_fat_page_size = sector_size;
+        s_fat_page_tick = 0;
+        s_fat_stats.paged = 1;
+        s_fat_stats.page_budget = budget;
+    }
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_now_us.
+* Description: Use timespec_get when the C library has it, else the processor
+*              time of clock.
+*
+END***************************************************************************/
+static uint64_t fatfs_now_us(void)
+{
+#if defined(TIME_UTC)
+    struct timespec now; /*now stores the current time*/
+
+    timespec_get(&now, TIME_UTC);
+
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#else
+    return (uint64_t)clock() * 1000000 / CLOCKS_PER_SEC;
+#endif
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_expand_FAT.
+* Description: Expand the packed FAT table, 3 bytes hold 2 entries. The packed
+*              table is kept, it is the form written back to the disk.
+*
+END***************************************************************************/
+static void fatfs_expand_FAT(void)
+{
+    /*Allocate memory space for the expanded table*/
+    s_fat_next = (uint16_t *)malloc(sizeof(uint16_t) * s_fat_entry_count);
+
+    if (NULL != s_fat_next)
+    {
+        /*Unpack with the fastest kernel the CPU supports*/
+        fatfs_unpack12(s_fat_table, s_fat_next, s_fat_entry_count);
+    }
+    else
+    {
+        /*Do nothing, read_FAT_entry falls back to the packed table*/
+    }
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_add_cluster.
+* Description: Extend the last extent if the cluster follows it, else start a
+*              new extent. The extent array doubles when it is full.
+*
+END***************************************************************************/
+static int32_t fatfs_add_cluster(fatfs_chain_struct_t *chain, uint32_t logical_cluster)
+{
+    fatfs_extent_struct_t *last = NULL;    /*last points to the last extent of the chain*/
+    fatfs_extent_struct_t *extents = NULL; /*extents stores the grown extent array*/
+    uint32_t capacity = 0;                 /*capacity stores the size of the grown extent array*/
+    int32_t result = 0;                    /*result stores the result of the function*/
+
+    if (0 != chain->extent_count)
+    {
+        last = &chain->extents[chain->extent_count - 1];
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    /*If the cluster follows the last extent on the disk*/
+    if ((NULL != last) && (logical_cluster == last->first_cluster + last->length))
+    {
+        last->length++;
+    }
+    else
+    {
+        /*Grow the extent array if it is full*/
+        if (chain->extent_count == chain->extent_capacity)
+        {
+            capacity = (0 == chain->extent_capacity) ? 16 : chain->extent_capacity * 2;
+            extents = (fatfs_extent_struct_t *)realloc(chain->extents, sizeof(fatfs_extent_struct_t) * capacity);
+
+            if (NULL != extents)
+            {
+                chain->extents = extents;
+                chain->extent_capacity = capacity;
+            }
+            else
+            {
+                result = -1;
+            }
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if (0 == result)
+        {
+            chain->extents[chain->extent_count].first_cluster = logical_cluster;
+            chain->extents[chain->extent_count].length = 1;
+            chain->extent_count++;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    if (0 == result)
+    {
+        chain->cluster_count++;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return result;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_walk_chain.
+* Description: Follow the FAT from the first cluster and store the clusters as
+*              extents. Each cluster, the first one included even if it has
+*              the value of a mark, must be a data cluster of the volume not
+*              met before in the chain (checked with s_chain_seen, or with the
+*              number of clusters if it could not be allocated), so a damaged
+*              FAT ends the walk after at most 1 pass over the volume.
+*
+END***************************************************************************/
+FATFS_ALWAYS_INLINE uint32_t fatfs_walk_chain(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster, fatfs_fat_access_enum_t access)
+{
+    fatfs_fat_width_enum_t width = FATFS_FAT12; /*width is the width of the entries read*/
+    uint32_t logical_cluster = 0;               /*logical_cluster is the logical cluster number*/
+    uint32_t reserved = 0;                      /*reserved is the first reserved value*/
+    uint32_t eoc = 0;                           /*eoc is the first end of chain mark*/
+    uint32_t end = 0;                           /*end is the number past the last data cluster*/
+    uint32_t cluster = 0;                       /*cluster is used for traversaling the clusters of an extent*/
+    uint32_t i = 0;                             /*i is used for traversaling the extents*/
+
+    if (FATFS_ACCESS_TABLE16 == access)
+    {
+        width = FATFS_FAT16;
+    }
+    else if (FATFS_ACCESS_TABLE32 == access)
+    {
+        width = FATFS_FAT32;
+    }
+    else if (FATFS_ACCESS_PAGED == access)
+    {
+        width = s_fat_width;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    fatfs_clear_cluster_chain(chain);
+
+    reserved = fatfs_entry_reserved(width);
+    eoc = fatfs_entry_eoc(width);
+    end = fatfs_data_cluster_end();
+    logical_cluster = first_logical_cluster;
+
+    /*The first cluster must be a data cluster, an end of chain mark there is not an empty chain*/
+    if (first_logical_cluster >= end)
+    {
+        chain->status = FATFS_CHAIN_OUT_OF_RANGE;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    /*Add the clusters until the end of chain mark*/
+    while ((FATFS_CHAIN_OK == chain->status) && (logical_cluster < eoc))
+    {
+        if ((logical_cluster < DATA_REGION_12_LOGICAL_BASE_INDEX) || ((logical_cluster >= end) && (logical_cluster < reserved)))
+        {
+            chain->status = FATFS_CHAIN_OUT_OF_RANGE;
+            break;
+        }
+        else if (logical_cluster >= reserved)
+        {
+            /*Bad or reserved mark*/
+            chain->status = FATFS_CHAIN_TRUNCATED;
+            break;
+        }
+        else if (((NULL != s_chain_seen) && (0 != (s_chain_seen[logical_cluster / 8] & (1 << (logical_cluster & 7))))) ||
+                 (chain->cluster_count >= end - DATA_REGION_12_LOGICAL_BASE_INDEX))
+        {
+            chain->status = FATFS_CHAIN_CYCLIC;
+            break;
+        }
+        else if (0 != fatfs_add_cluster(chain, logical_cluster))
+        {
+            chain->status = FATFS_CHAIN_TRUNCATED;
+            break;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if (NULL != s_chain_seen)
+        {
+            s_chain_seen[logical_cluster / 8] |= 1 << (logical_cluster & 7);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*The cluster is below end, the entry is in the table*/
+        if (FATFS_ACCESS_PACKED12 == access)
+        {
+            logical_cluster = fatfs_decode12(s_fat_table, logical_cluster);
+        }
+        else if (FATFS_ACCESS_EXPANDED12 == access)
+        {
+            logical_cluster = s_fat_next[logical_cluster];
+        }
+        else if (FATFS_ACCESS_TABLE16 == access)
+        {
+            logical_cluster = fatfs_decode16(s_fat_table, logical_cluster);
+        }
+        else if (FATFS_ACCESS_TABLE32 == access)
+        {
+            logical_cluster = fatfs_decode32(s_fat_table, logical_cluster);
+        }
+        else
+        {
+            logical_cluster = read_FAT_entry(logical_cluster);
+        }
+    }
+
+    /*Clear the marks of the chain for the next walk*/
+    for (i = 0; (NULL != s_chain_seen) && (i < chain->extent_count); i++)
+    {
+        for (cluster = chain->extents[i].first_cluster; cluster < chain->extents[i].first_cluster + chain->extents[i].length; cluster++)
+        {
+            s_chain_seen[cluster / 8] &= ~(1 << (cluster & 7));
+        }
+    }
+
+    return chain->cluster_count;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_walk_chain_packed12.
+* Description: Build fatfs_walk_chain for the packed FAT12.
+*
+END***************************************************************************/
+static uint32_t fatfs_walk_chain_packed12(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster)
+{
+    return fatfs_walk_chain(chain, first_logical_cluster, FATFS_ACCESS_PACKED12);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_walk_chain_expanded12.
+* Description: Build fatfs_walk_chain for the expanded FAT12.
+*
+END***************************************************************************/
+static uint32_t fatfs_walk_chain_expanded12(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster)
+{
+    return fatfs_walk_chain(chain, first_logical_cluster, FATFS_ACCESS_EXPANDED12);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_walk_chain_table16.
+* Description: Build fatfs_walk_chain for the FAT16.
+*
+END***************************************************************************/
+static uint32_t fatfs_walk_chain_table16(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster)
+{
+    return fatfs_walk_chain(chain, first_logical_cluster, FATFS_ACCESS_TABLE16);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_walk_chain_table32.
+* Description: Build fatfs_walk_chain for the FAT32.
+*
+END***************************************************************************/
+static uint32_t fatfs_walk_chain_table32(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster)
+{
+    return fatfs_walk_chain(chain, first_logical_cluster, FATFS_ACCESS_TABLE32);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_walk_chain_paged.
+* Description: Build fatfs_walk_chain for the paged FAT of any width.
+*
+END***************************************************************************/
+static uint32_t fatfs_walk_chain_paged(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster)
+{
+    return fatfs_walk_chain(chain, first_logical_cluster, FATFS_ACCESS_PAGED);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_get_cluster_chain.
+* Description: Run the walker chosen at mount.
+*
+END***************************************************************************/
+static uint32_t fatfs_get_cluster_chain(fatfs_chain_struct_t *chain, uint32_t first_logical_cluster)
+{
+    return s_walk_chain(chain, first_logical_cluster);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_find_geometry.
+* Description: The root directory takes max_root_dir_entries entries of 32
+*              bytes, rounded up to whole sectors. The sizes were checked at
+*              mount.
+*
+END***************************************************************************/
+static void fatfs_find_geometry(void)
+{
+    s_geometry.fat_start = s_FAT12Infor.reserved_sectors_quantity;
+    s_geometry.root_start = s_geometry.fat_start + s_FAT12Infor.num_of_FATs * s_FAT12Infor.sectors_per_FAT;
+    s_geometry.root_sectors = ((uint32_t)s_FAT12Infor.max_root_dir_entries * 32 + s_FAT12Infor.bytes_per_sector - 1) / s_FAT12Infor.bytes_per_sector;
+    s_geometry.data_start = s_geometry.root_start + s_geometry.root_sectors;
+    s_geometry.cluster_size = (uint32_t)s_FAT12Infor.bytes_per_sector * s_FAT12Infor.sectors_per_cluster;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_cluster_sector.
+* Description: Cluster 2 is the first cluster of the data region.
+*
+END***************************************************************************/
+static uint32_t fatfs_cluster_sector(uint32_t logical_cluster)
+{
+    return s_geometry.data_start + (logical_cluster - DATA_REGION_12_LOGICAL_BASE_INDEX) * s_FAT12Infor.sectors_per_cluster;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_find_FAT_width.
+* Description: Count the clusters of the data region.
+*
+END***************************************************************************/
+static fatfs_fat_width_enum_t fatfs_find_FAT_width(void)
+{
+    fatfs_fat_width_enum_t width = FATFS_FAT12; /*width stores the width of the entries*/
+    uint32_t clusters = 0;                      /*clusters stores the number of data clusters*/
+
+    if (s_FAT12Infor.total_sectors > s_geometry.data_start)
+    {
+        clusters = (s_FAT12Infor.total_sectors - s_geometry.data_start) / s_FAT12Infor.sectors_per_cluster;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (clusters >= 65525)
+    {
+        width = FATFS_FAT32;
+    }
+    else if (clusters >= 4085)
+    {
+        width = FATFS_FAT16;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return width;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_entry_cluster.
+* Description: The low word is at byte 26, the high word at byte 20 holds
+*              other data on FAT12/FAT16.
+*
+END***************************************************************************/
+static uint32_t fatfs_entry_cluster(const uint8_t *entry)
+{
+    uint32_t cluster = entry[26] | (entry[27] << 8); /*cluster stores the first cluster*/
+
+    if (FATFS_FAT32 == s_fat_width)
+    {
+        cluster |= ((uint32_t)entry[20] << 16) | ((uint32_t)entry[21] << 24);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return cluster;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_read_cluster_batch.
+* Description: Turn up to FATFS_IO_BATCH_CLUSTERS clusters of the cluster chain
+*              into an extent list, 1 entry per extent of the chain, and read
+*              them in 1 call to the HAL. Whole clusters are read, so 1 extent
+*              is sectors_per_cluster sectors per cluster. Return the number
+*              of whole clusters read, a short read ends the walk.
+*
+END***************************************************************************/
+static uint32_t fatfs_read_cluster_batch(const fatfs_chain_struct_t *chain, fatfs_chain_cursor_struct_t *cursor, uint8_t *buffer)
+{
+    kmc_extent_struct_t extents[FATFS_IO_BATCH_CLUSTERS]; /*extents stores the sectors of each extent*/
+    struct iovec iov[FATFS_IO_BATCH_CLUSTERS];            /*iov stores the place of each extent in buffer*/
+    const fatfs_extent_struct_t *extent = NULL;           /*extent points to the current extent of the chain*/
+    uint32_t count = 0;                                   /*count stores the number of extents in the batch*/
+    uint32_t clusters = 0;                                /*clusters stores the number of clusters in the batch*/
+    uint32_t num = 0;                                     /*num stores the number of clusters taken from 1 extent*/
+    uint32_t bytes_read = 0;                              /*bytes_read stores the number of bytes read*/
+
+    while ((cursor->extent < chain->extent_count) && (clusters < FATFS_IO_BATCH_CLUSTERS))
+    {
+        extent = &chain->extents[cursor->extent];
+
+        /*Take the rest of the extent, as much as the buffer holds*/
+        num = extent->length - cursor->offset;
+        if (num > FATFS_IO_BATCH_CLUSTERS - clusters)
+        {
+            num = FATFS_IO_BATCH_CLUSTERS - clusters;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        extents[count].index = fatfs_cluster_sector(extent->first_cluster + cursor->offset);
+        extents[count].num = num * s_FAT12Infor.sectors_per_cluster;
+
+        iov[count].iov_base = buffer + clusters * s_geometry.cluster_size;
+        iov[count].iov_len = num * s_geometry.cluster_size;
+
+        count++;
+        clusters += num;
+
+        /*Move to next extent if this one is done*/
+        cursor->offset += num;
+        if (cursor->offset == extent->length)
+        {
+            cursor->extent++;
+            cursor->offset = 0;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    /*Read the whole batch*/
+    bytes_read = (uint32_t)kmc_read_extents(s_dev, extents, count, iov);
+
+    /*The clusters after a short read are not in the buffer, stop the walk there*/
+    if (bytes_read < clusters * s_geometry.cluster_size)
+    {
+        cursor->extent = chain->extent_count;
+        cursor->offset = 0;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return bytes_read / s_geometry.cluster_size;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_find_chain.
+* Description: Binary search the chain index, the hit is returned as a view of
+*              the index extents. Follow the FAT on a miss.
+*
+END***************************************************************************/
+static const fatfs_chain_struct_t *fatfs_find_chain(uint32_t first_logical_cluster)
+{
+    const fatfs_chain_struct_t *chain = NULL; /*chain stores the chain found*/
+    uint32_t low = 0;                         /*low is the first entry of the search range*/
+    uint32_t high = s_index_count;            /*high is past the last entry of the search range*/
+    uint32_t middle = 0;                      /*middle is the entry compared*/
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+
+        if (s_index[middle].first_cluster < first_logical_cluster)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    /*If the index has the chain*/
+    if ((low < s_index_count) && (first_logical_cluster == s_index[low].first_cluster))
+    {
+        s_index_view.extents = s_index_extents.extents + s_index[low].extent_start;
+        s_index_view.extent_count = s_index[low].extent_count;
+        s_index_view.cluster_count = s_index[low].cluster_count;
+        s_index_view.status = (fatfs_chain_status_enum_t)s_index[low].status;
+
+        chain = &s_index_view;
+    }
+    else
+    {
+        fatfs_get_cluster_chain(&s_cluster_chain, first_logical_cluster);
+
+        chain = &s_cluster_chain;
+    }
+
+    return chain;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_load_dir.
+* Description: The FAT12/FAT16 root directory is a fixed run of sectors, a
+*              subdirectory and the FAT32 root directory are read along their
+*              cluster chain batch by batch. The size is cut to the bytes read,
+*              so a short read leaves no unread bytes to parse.
+*
+END***************************************************************************/
+static uint8_t *fatfs_load_dir(uint32_t first_logical_cluster, uint32_t *buffer_size)
+{
+    fatfs_chain_cursor_struct_t cursor = {0, 0}; /*cursor is used for traversaling the cluster chain*/
+    const fatfs_chain_struct_t *chain = NULL;    /*chain stores the cluster chain of the subdirectory*/
+    uint8_t *buffer = NULL;                      /*buffer stores the content of the directory*/
+    uint32_t i = 0;                              /*i stores the offset value to move in the buffer*/
+
+    *buffer_size = 0;
+
+    /*The FAT32 root directory has a cluster chain*/
+    if ((ROOT_DIR_12_LOGICAL_BASE_INDEX == first_logical_cluster) && (FATFS_FAT32 == s_fat_width))
+    {
+        first_logical_cluster = s_geometry.root_cluster;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    /*If the directory is root directory*/
+    if (ROOT_DIR_12_LOGICAL_BASE_INDEX == first_logical_cluster)
+    {
+        /*Get the buffer size*/
+        *buffer_size = s_FAT12Infor.bytes_per_sector * s_geometry.root_sectors;
+
+        /*Allocate memory space for buffer*/
+        buffer = (uint8_t *)malloc(sizeof(uint8_t) * *buffer_size);
+
+        /*Read the content of root directory to buffer, only the whole entries read are kept*/
+        if (NULL != buffer)
+        {
+            *buffer_size = (uint32_t)kmc_read_multi_sector(s_dev, s_geometry.root_start, s_geometry.root_sectors, buffer) & ~(uint32_t)31;
+        }
+        else
+        {
+            *buffer_size = 0;
+        }
+    }
+    /*If the directory is subdirectory*/
+    else if (first_logical_cluster > ROOT_DIR_12_LOGICAL_BASE_INDEX)
+    {
+        /*Get the cluster chain of the subdirectory*/
+        chain = fatfs_find_chain(first_logical_cluster);
+
+        /*Get the buffer size*/
+        *buffer_size = chain->cluster_count * s_geometry.cluster_size;
+
+        /*Allocate memory space for buffer*/
+        buffer = (uint8_t *)malloc(sizeof(uint8_t) * *buffer_size);
+
+        if (NULL != buffer)
+        {
+            /*Traversal the chain, read the cluster chain batch by batch, a short read ends it*/
+            while (cursor.extent < chain->extent_count)
+            {
+                i += fatfs_read_cluster_batch(chain, &cursor, buffer + i) * s_geometry.cluster_size;
+            }
+
+            *buffer_size = i;
+        }
+        else
+        {
+            *buffer_size = 0;
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return buffer;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_format_name.
+* Description: Trim the blanks of the 8 bytes name and 3 bytes extension, and
+*              join them with a dot if the extension is not blank.
+*
+END***************************************************************************/
+static uint32_t fatfs_format_name(const uint8_t *entry, uint8_t *name)
+{
+    uint32_t length = 0; /*length stores the length of the name*/
+    uint32_t i = 0;      /*i is used for traversaling the name*/
+    uint32_t end = 0;    /*end is past the last non blank character*/
+
+    for (end = 8; (end > 0) && (' ' == entry[end - 1]); end--)
+    {
+        /*Do nothing*/
+    }
+
+    for (i = 0; i < end; i++)
+    {
+        name[length++] = entry[i];
+    }
+
+    /*0x05 stands for a first character 0xE5, which marks the deleted entries*/
+    if ((0 < length) && (0x05 == name[0]))
+    {
+        name[0] = DELETED_ENTRY;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    for (end = 11; (end > 8) && (' ' == entry[end - 1]); end--)
+    {
+        /*Do nothing*/
+    }
+
+    if (end > 8)
+    {
+        name[length++] = '.';
+
+        for (i = 8; i < end; i++)
+        {
+            name[length++] = entry[i];
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    name[length] = '\0';
+
+    return length;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_index_chain.
+* Description: Append the chain in s_cluster_chain to the chain index, growing
+*              the index and its extent array if they are full.
+*
+END***************************************************************************/
+static void fatfs_index_chain(uint32_t first_logical_cluster)
+{
+    fatfs_chain_index_entry_struct_t *index = NULL; /*index stores the grown chain index*/
+    fatfs_extent_struct_t *extents = NULL;          /*extents stores the grown extent array of the index*/
+    uint32_t capacity = 0;                          /*capacity stores the size of a grown array*/
+
+    if (s_index_count == s_index_capacity)
+    {
+        capacity = (0 == s_index_capacity) ? 64 : s_index_capacity * 2;
+        index = (fatfs_chain_index_entry_struct_t *)realloc(s_index, sizeof(fatfs_chain_index_entry_struct_t) * capacity);
+
+        if (NULL == index)
+        {
+            return;
+        }
+
+        s_index = index;
+        s_index_capacity = capacity;
+    }
+
+    if (s_index_extents.extent_count + s_cluster_chain.extent_count > s_index_extents.extent_capacity)
+    {
+        capacity = (0 == s_index_extents.extent_capacity) ? 256 : s_index_extents.extent_capacity;
+        while (capacity < s_index_extents.extent_count + s_cluster_chain.extent_count)
+        {
+            capacity *= 2;
+        }
+        extents = (fatfs_extent_struct_t *)realloc(s_index_extents.extents, sizeof(fatfs_extent_struct_t) * capacity);
+
+        if (NULL == extents)
+        {
+            return;
+        }
+
+        s_index_extents.extents = extents;
+        s_index_extents.extent_capacity = capacity;
+    }
+
+    /*Store the chain*/
+    s_index[s_index_count].first_cluster = first_logical_cluster;
+    s_index[s_index_count].extent_start = s_index_extents.extent_count;
+    s_index[s_index_count].extent_count = s_cluster_chain.extent_count;
+    s_index[s_index_count].cluster_count = s_cluster_chain.cluster_count;
+    s_index[s_index_count].status = (uint8_t)s_cluster_chain.status;
+    s_index_count++;
+
+    /*A chain with no extent (a bad first cluster) may have no extent array yet*/
+    if (0 != s_cluster_chain.extent_count)
+    {
+        memcpy(s_index_extents.extents + s_index_extents.extent_count, s_cluster_chain.extents, sizeof(fatfs_extent_struct_t) * s_cluster_chain.extent_count);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    s_index_extents.extent_count += s_cluster_chain.extent_count;
+    s_index_extents.cluster_count += s_cluster_chain.cluster_count;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_owner_add.
+* Description: Give the next file ID to a path, store the path and mark the
+*              clusters of s_cluster_chain that no file owns yet (a cluster
+*              shared by 2 chains stays with the first one found).
+*
+END***************************************************************************/
+static uint16_t fatfs_owner_add(const uint8_t *path, uint32_t path_length, const fatfs_chain_struct_t *chain)
+{
+    fatfs_owner_file_struct_t *files = NULL; /*files stores the grown file table*/
+    uint8_t *paths = NULL;                   /*paths stores the grown path pool*/
+    uint32_t capacity = 0;                   /*capacity stores the size of a grown array*/
+    uint16_t owner = FATFS_OWNER_NONE;       /*owner stores the file ID given to the path*/
+    uint32_t cluster = 0;                    /*cluster is used for traversaling the clusters of an extent*/
+    uint32_t i = 0;                          /*i is used for traversaling the extents*/
+
+    /*The last ID is kept for the system area*/
+    if (s_owner_file_count + 1 >= FATFS_OWNER_SYSTEM)
+    {
+        return FATFS_OWNER_NONE;
+    }
+
+    if (s_owner_file_count == s_owner_file_capacity)
+    {
+        capacity = (0 == s_owner_file_capacity) ? 64 : s_owner_file_capacity * 2;
+        files = (fatfs_owner_file_struct_t *)realloc(s_owner_files, sizeof(fatfs_owner_file_struct_t) * capacity);
+
+        if (NULL == files)
+        {
+            return FATFS_OWNER_NONE;
+        }
+
+        s_owner_files = files;
+        s_owner_file_capacity = capacity;
+    }
+
+    if (s_owner_paths_size + path_length + 1 > s_owner_paths_capacity)
+    {
+        capacity = (0 == s_owner_paths_capacity) ? 4096 : s_owner_paths_capacity;
+        while (capacity < s_owner_paths_size + path_length + 1)
+        {
+            capacity *= 2;
+        }
+        paths = (uint8_t *)realloc(s_owner_paths, capacity);
+
+        if (NULL == paths)
+        {
+            return FATFS_OWNER_NONE;
+        }
+
+        s_owner_paths = paths;
+        s_owner_paths_capacity = capacity;
+    }
+
+    /*Store the path*/
+    memcpy(s_owner_paths + s_owner_paths_size, path, path_length);
+    s_owner_paths[s_owner_paths_size + path_length] = '\0';
+    s_owner_files[s_owner_file_count].path_offset = s_owner_paths_size;
+    s_owner_paths_size += path_length + 1;
+
+    s_owner_file_count++;
+    owner = (uint16_t)s_owner_file_count;
+
+    /*Mark the clusters*/
+    for (i = 0; (NULL != chain) && (i < chain->extent_count); i++)
+    {
+        for (cluster = chain->extents[i].first_cluster; cluster < (uint32_t)chain->extents[i].first_cluster + chain->extents[i].length; cluster++)
+        {
+            if ((cluster < s_fat_entry_count) && (FATFS_OWNER_NONE == s_owner[cluster]))
+            {
+                s_owner[cluster] = owner;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+    }
+
+    return owner;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_index_dir.
+* Description: Walk the directory tree depth first and feed the indexes asked
+*              in the mount options. Each first cluster is indexed once, so a
+*              directory linked twice (or into itself) on a damaged disk is
+*              not walked again. A free entry ends the directory, as in
+*              fatfs_readdir. The chain of a file is only walked for the
+*              chain index and the owner map.
+*
+END***************************************************************************/
+static void fatfs_index_dir(uint32_t first_logical_cluster, uint32_t depth, uint8_t *path, uint32_t path_length)
+{
+    uint8_t *buffer = NULL;       /*buffer stores the content of the directory*/
+    uint32_t buffer_size = 0;     /*buffer_size is the size of the buffer*/
+    uint32_t cluster = 0;         /*cluster stores the first cluster of an entry*/
+    uint32_t name_length = 0;     /*name_length stores the length of the path of an entry*/
+    uint32_t i = 0;               /*i is used for traversaling the buffer*/
+
+    buffer = fatfs_load_dir(first_logical_cluster, &buffer_size);
+
+    for (i = 0; i < buffer_size; i += 32)
+    {
+        cluster = fatfs_entry_cluster(buffer + i);
+
+        /*A free entry ends the directory*/
+        if (UNUSED_ENTRY == buffer[i])
+        {
+            break;
+        }
+
+        /*Skip the deleted and long name entries, ".", ".."*/
+        if ((DELETED_ENTRY == buffer[i]) || (FAKE_ENTRY == buffer[i + 11]) || ('.' == buffer[i]))
+        {
+            continue;
+        }
+
+        /*Append "/NAME.EXT" to the path of the directory*/
+        path[path_length] = '/';
+        name_length = path_length + 1 + fatfs_format_name(buffer + i, path + path_length + 1);
+
+        /*The path index also holds the empty files*/
+        if (0 != (s_mount_options & FATFS_OPT_PATH_INDEX))
+        {
+            fatfs_path_add(path, name_length, buffer + i);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*Skip the empty files and the chains already indexed*/
+        if ((cluster < DATA_REGION_12_LOGICAL_BASE_INDEX) || (cluster >= s_fat_entry_count))
+        {
+            continue;
+        }
+
+        if (0 != s_index_seen[cluster])
+        {
+            if (FOLDER_ENTRY == (buffer[i + 11] & FOLDER_ENTRY))
+            {
+                s_path_pruned = 1;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+
+            continue;
+        }
+
+        s_index_seen[cluster] = 1;
+
+        /*The path index only needs the content of the directories*/
+        if ((0 != (s_mount_options & (FATFS_OPT_CHAIN_INDEX | FATFS_OPT_OWNER_MAP))) || (FOLDER_ENTRY == (buffer[i + 11] & FOLDER_ENTRY)))
+        {
+            fatfs_get_cluster_chain(&s_cluster_chain, cluster);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if (0 != (s_mount_options & FATFS_OPT_CHAIN_INDEX))
+        {
+            fatfs_index_chain(cluster);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if (NULL != s_owner)
+        {
+            fatfs_owner_add(path, name_length, &s_cluster_chain);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*Walk the subdirectory*/
+        if ((FOLDER_ENTRY == (buffer[i + 11] & FOLDER_ENTRY)) && (depth + 1 < FATFS_INDEX_MAX_DEPTH))
+        {
+            fatfs_index_dir(cluster, depth + 1, path, name_length);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    free(buffer);
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_path_add.
+* Description: Store the path in the path pool and the entry in the entry
+*              table, the hash table is built once every path is known.
+*
+END***************************************************************************/
+static void fatfs_path_add(const uint8_t *path, uint32_t path_length, const uint8_t *raw)
+{
+    fatfs_path_entry_struct_t *entries = NULL; /*entries stores the grown entry table*/
+    fatfs_path_entry_struct_t *added = NULL;   /*added points to the entry added*/
+    uint8_t *names = NULL;                     /*names stores the grown path pool*/
+    uint32_t capacity = 0;                     /*capacity stores the size of a grown array*/
+
+    if (s_path_count == s_path_capacity)
+    {
+        capacity = (0 == s_path_capacity) ? 64 : s_path_capacity * 2;
+        entries = (fatfs_path_entry_struct_t *)realloc(s_path_entries, sizeof(fatfs_path_entry_struct_t) * capacity);
+
+        if (NULL == entries)
+        {
+            s_path_incomplete = 1;
+            return;
+        }
+
+        s_path_entries = entries;
+        s_path_capacity = capacity;
+    }
+
+    if (s_path_names_size + path_length + 1 > s_path_names_capacity)
+    {
+        capacity = (0 == s_path_names_capacity) ? 4096 : s_path_names_capacity;
+        while (capacity < s_path_names_size + path_length + 1)
+        {
+            capacity *= 2;
+        }
+        names = (uint8_t *)realloc(s_path_names, capacity);
+
+        if (NULL == names)
+        {
+            s_path_incomplete = 1;
+            return;
+        }
+
+        s_path_names = names;
+        s_path_names_capacity = capacity;
+    }
+
+    /*Store the path*/
+    memcpy(s_path_names + s_path_names_size, path, path_length);
+    s_path_names[s_path_names_size + path_length] = '\0';
+
+    /*Store the entry*/
+    added = &s_path_entries[s_path_count];
+    added->hash = fatfs_path_hash(path, path_length);
+    added->path_offset = s_path_names_size;
+    added->path_length = path_length;
+    memcpy(added->entry.name, raw, FATFS_NAME_SIZE);
+    added->entry.attribute = raw[11];
+    added->entry.first_logical_cluster = fatfs_entry_cluster(raw);
+    added->entry.entry_size = hex_to_decimal((uint8_t *)raw, 28, 4);
+
+    s_path_names_size += path_length + 1;
+    s_path_count++;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_build_path_table.
+* Description: Open addressing with linear probing, the table has at least 2
+*              slots per path so a probe sequence stays short. A path found
+*              twice (a damaged directory) keeps its first entry.
+*
+END***************************************************************************/
+static void fatfs_build_path_table(void)
+{
+    uint32_t capacity = 16; /*capacity stores the number of slots*/
+    uint32_t slot = 0;      /*slot is used for traversaling the probe sequence*/
+    uint32_t i = 0;         /*i is used for traversaling the entries*/
+
+    while (capacity < s_path_count * 2)
+    {
+        capacity *= 2;
+    }
+
+    if (0 == s_path_incomplete)
+    {
+        s_path_slots = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+    }
+    else
+    {
+        /*Do nothing, the paths are found by reading the directories*/
+    }
+
+    if (NULL != s_path_slots)
+    {
+        s_path_slot_mask = capacity - 1;
+
+        for (i = 0; i < s_path_count; i++)
+        {
+            slot = s_path_entries[i].hash & s_path_slot_mask;
+            while (0 != s_path_slots[slot])
+            {
+                slot = (slot + 1) & s_path_slot_mask;
+            }
+            s_path_slots[slot] = i + 1;
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_path_hash.
+* Description: 32-bit FNV-1a.
+*
+END***************************************************************************/
+static uint32_t fatfs_path_hash(const uint8_t *path, uint32_t length)
+{
+    uint32_t hash = 2166136261u; /*hash stores the hash of the path*/
+    uint32_t i = 0;              /*i is used for traversaling the path*/
+
+    for (i = 0; i < length; i++)
+    {
+        hash = (hash ^ path[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_path_find.
+* Description: Probe from the home slot of the hash until a free slot.
+*
+END***************************************************************************/
+static const fatfs_path_entry_struct_t *fatfs_path_find(const uint8_t *path, uint32_t length)
+{
+    const fatfs_path_entry_struct_t *found = NULL; /*found points to the entry of the path*/
+    const fatfs_path_entry_struct_t *entry = NULL; /*entry points to the entry of a slot*/
+    uint32_t hash = 0;                             /*hash stores the hash of the path*/
+    uint32_t slot = 0;                             /*slot is used for traversaling the probe sequence*/
+
+    hash = fatfs_path_hash(path, length);
+
+    for (slot = hash & s_path_slot_mask; (NULL == found) && (0 != s_path_slots[slot]); slot = (slot + 1) & s_path_slot_mask)
+    {
+        entry = &s_path_entries[s_path_slots[slot] - 1];
+
+        if ((hash == entry->hash) && (length == entry->path_length) && (0 == memcmp(path, s_path_names + entry->path_offset, length)))
+        {
+            found = entry;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    return found;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_normalize_path.
+* Description: Copy the path name by name, a name ends at '/', '\\' or the
+*              end of the path.
+*
+END***************************************************************************/
+static uint32_t fatfs_normalize_path(const uint8_t *path, uint8_t *normal)
+{
+    uint32_t length = 0; /*length stores the length of the normalized path*/
+    uint32_t start = 0;  /*start is the position of the name being copied*/
+    uint32_t end = 0;    /*end is past the last character of the name*/
+    uint32_t i = 0;      /*i is used for traversaling the name*/
+    uint8_t fits = 1;    /*fits is 0 once the path does not fit in normal*/
+
+    while ((0 != fits) && ('\0' != path[start]))
+    {
+        for (end = start; ('\0' != path[end]) && ('/' != path[end]) && ('\\' != path[end]); end++)
+        {
+            /*Do nothing*/
+        }
+
+        /*Drop the empty names and "."*/
+        if ((end == start) || ((end == start + 1) && ('.' == path[start])))
+        {
+            /*Do nothing*/
+        }
+        /*Go up 1 level, the root directory has no parent*/
+        else if ((end == start + 2) && ('.' == path[start]) && ('.' == path[start + 1]))
+        {
+            while ((length > 0) && ('/' != normal[length - 1]))
+            {
+                length--;
+            }
+
+            if (length > 0)
+            {
+                length--;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+        else if (length + 1 + (end - start) >= FATFS_MAX_PATH)
+        {
+            fits = 0;
+        }
+        else
+        {
+            normal[length++] = '/';
+
+            for (i = start; i < end; i++)
+            {
+                normal[length++] = (('a' <= path[i]) && (path[i] <= 'z')) ? (uint8_t)(path[i] - 'a' + 'A') : path[i];
+            }
+        }
+
+        start = ('\0' == path[end]) ? end : end + 1;
+    }
+
+    if (0 == fits)
+    {
+        length = 0;
+    }
+    else if (0 == length)
+    {
+        normal[length++] = '/';
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    normal[length] = '\0';
+
+    return length;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_walk_path.
+* Description: Find the names of the path 1 level at a time from the root.
+*
+END***************************************************************************/
+static int32_t fatfs_walk_path(const uint8_t *path, uint32_t length, fatfs_dirent_struct_t *entry)
+{
+    uint32_t cluster = ROOT_DIR_12_LOGICAL_BASE_INDEX; /*cluster is the first cluster of the directory being read*/
+    uint32_t start = 1;                                /*start is the position of the name being looked for*/
+    uint32_t end = 0;                                  /*end is past the last character of the name*/
+    int32_t found = 1;                                 /*found is 1 while every name was found*/
+
+    while ((1 == found) && (start < length))
+    {
+        for (end = start; (end < length) && ('/' != path[end]); end++)
+        {
+            /*Do nothing*/
+        }
+
+        found = (0 == fatfs_lookup_name(cluster, path + start, end - start, entry)) ? 1 : 0;
+
+        /*Only a directory has names under it*/
+        if ((1 == found) && (end < length) &&
+            ((FOLDER_ENTRY != (entry->attribute & FOLDER_ENTRY)) || (entry->first_logical_cluster < DATA_REGION_12_LOGICAL_BASE_INDEX)))
+        {
+            found = 0;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        cluster = entry->first_logical_cluster;
+        start = end + 1;
+    }
+
+    return (1 == found) ? 0 : -1;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_lookup_name.
+* Description: Read the directory with fatfs_readdir until the entry of the
+*              name. The result is kept in the dentry cache if it is used: a
+*              name found, or a name not found once the directory was read to
+*              its end without a failed read.
+*
+END***************************************************************************/
+static int32_t fatfs_lookup_name(uint32_t cluster, const uint8_t *name, uint32_t name_length, fatfs_dirent_struct_t *entry)
+{
+    uint8_t formatted[13];                /*formatted stores the name of an entry as "NAME.EXT"*/
+    uint8_t key[FATFS_NAME_SIZE];         /*key stores the 8.3 form of the name*/
+    fatfs_dentry_struct_t *cached = NULL; /*cached points to the lookup kept in the dentry cache*/
+    fatfs_dir_t *dir = NULL;              /*dir is the iterator of the directory*/
+    uint8_t keyed = 0;                    /*keyed is 1 if the lookup can be kept in the dentry cache*/
+    uint8_t complete = 0;                 /*complete is 1 if the directory was read without a failed read*/
+    int32_t found = -1;                   /*found is 0 once the name is found*/
+
+    if (NULL != s_dentries)
+    {
+        keyed = fatfs_dentry_key(name, name_length, key);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (0 != keyed)
+    {
+        cached = fatfs_dentry_find(cluster, key);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL != cached)
+    {
+        cached->referenced = 1;
+        s_dentry_stats.hits++;
+
+        if (FATFS_DENTRY_POSITIVE == cached->state)
+        {
+            *entry = cached->entry;
+            found = 0;
+        }
+        else
+        {
+            s_dentry_stats.negative_hits++;
+        }
+    }
+    else
+    {
+        dir = fatfs_opendir(cluster);
+
+        while ((0 != found) && (1 == fatfs_readdir(dir, entry)))
+        {
+            if ((name_length == fatfs_format_name(entry->name, formatted)) && (0 == memcmp(name, formatted, name_length)))
+            {
+                found = 0;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+
+        complete = ((NULL != dir) && (0 == dir->failed));
+        fatfs_closedir(dir);
+
+        if ((0 != keyed) && (0 == found))
+        {
+            s_dentry_stats.misses++;
+            fatfs_dentry_add(cluster, key, entry);
+        }
+        else if ((0 != keyed) && (0 != complete))
+        {
+            s_dentry_stats.misses++;
+            fatfs_dentry_add(cluster, key, NULL);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    return found;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_dentry_key.
+* Description: The inverse of fatfs_format_name: the name up to the first dot
+*              padded to 8 bytes, the extension padded to 3 bytes. The key
+*              is kept only if fatfs_format_name gives back the name: a name
+*              ending with a dot or holding blanks fatfs_format_name would
+*              trim has no 8.3 form, and would share the key of another name.
+*
+END***************************************************************************/
+static uint8_t fatfs_dentry_key(const uint8_t *name, uint32_t name_length, uint8_t *key)
+{
+    uint8_t formatted[13]; /*formatted stores the name given back by the key*/
+    uint32_t dot = 0;      /*dot is the position of the first dot, name_length if there is none*/
+    uint32_t i = 0;        /*i is used for traversaling the name*/
+    uint8_t valid = 0;     /*valid is 1 if the name has an 8.3 form*/
+
+    for (dot = 0; (dot < name_length) && ('.' != name[dot]); dot++)
+    {
+        /*Do nothing*/
+    }
+
+    if ((0 < dot) && (dot <= 8) && ((dot == name_length) || ((dot + 1 < name_length) && (name_length - dot - 1 <= 3))))
+    {
+        memset(key, ' ', FATFS_NAME_SIZE);
+        memcpy(key, name, dot);
+
+        for (i = dot + 1; i < name_length; i++)
+        {
+            key[8 + i - dot - 1] = name[i];
+        }
+
+        /*A first character 0xE5 is stored as 0x05*/
+        if (DELETED_ENTRY == key[0])
+        {
+            key[0] = 0x05;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*"SAMPLE .TXT" pads to the key of "SAMPLE.TXT", only a round trip is exact*/
+        if ((name_length == fatfs_format_name(key, formatted)) && (0 == memcmp(name, formatted, name_length)))
+        {
+            valid = 1;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return valid;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_dentry_bucket.
+* Description: The hash of the name mixed with the parent cluster.
+*
+END***************************************************************************/
+static uint32_t fatfs_dentry_bucket(uint32_t parent, const uint8_t *key)
+{
+    return (fatfs_path_hash(key, FATFS_NAME_SIZE) ^ (parent * 0x9E3779B1u)) & s_dentry_bucket_mask;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_dentry_find.
+* Description: Walk the nodes of the bucket of the key.
+*
+END***************************************************************************/
+static fatfs_dentry_struct_t *fatfs_dentry_find(uint32_t parent, const uint8_t *key)
+{
+    fatfs_dentry_struct_t *found = NULL; /*found points to the node of the key*/
+    uint32_t node = 0;                   /*node is used for traversaling the bucket, node + 1*/
+
+    for (node = s_dentry_buckets[fatfs_dentry_bucket(parent, key)]; (NULL == found) && (0 != node); node = s_dentries[node - 1].next)
+    {
+        if ((parent == s_dentries[node - 1].parent) && (0 == memcmp(key, s_dentries[node - 1].name, FATFS_NAME_SIZE)))
+        {
+            found = &s_dentries[node - 1];
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    return found;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_dentry_add.
+* Description: Take a free node, or the first node of the clock not referenced
+*              since the hand last passed (CLOCK replacement), unlink it from
+*              its bucket and put it first in the bucket of the key.
+*
+END***************************************************************************/
+static void fatfs_dentry_add(uint32_t parent, const uint8_t *key, const fatfs_dirent_struct_t *entry)
+{
+    fatfs_dentry_struct_t *added = NULL; /*added points to the node taken*/
+    uint32_t *link = NULL;               /*link points to the link to the node taken in its bucket*/
+    uint32_t bucket = 0;                 /*bucket stores the bucket of the key*/
+    uint32_t node = 0;                   /*node stores the number of the node taken*/
+
+    if (s_dentry_stats.entries < s_dentry_stats.budget)
+    {
+        node = s_dentry_stats.entries;
+        s_dentry_stats.entries++;
+    }
+    else
+    {
+        while (0 != s_dentries[s_dentry_hand].referenced)
+        {
+            s_dentries[s_dentry_hand].referenced = 0;
+            s_dentry_hand = (s_dentry_hand + 1) % s_dentry_stats.budget;
+        }
+
+        node = s_dentry_hand;
+        s_dentry_hand = (s_dentry_hand + 1) % s_dentry_stats.budget;
+
+        /*Unlink the node from its bucket*/
+        link = &s_dentry_buckets[fatfs_dentry_bucket(s_dentries[node].parent, s_dentries[node].name)];
+        while (node + 1 != *link)
+        {
+            link = &s_dentries[*link - 1].next;
+        }
+        *link = s_dentries[node].next;
+
+        s_dentry_stats.evictions++;
+    }
+
+    added = &s_dentries[node];
+    added->parent = parent;
+    memcpy(added->name, key, FATFS_NAME_SIZE);
+    added->referenced = 0;
+
+    if (NULL != entry)
+    {
+        added->state = FATFS_DENTRY_POSITIVE;
+        added->entry = *entry;
+    }
+    else
+    {
+        added->state = FATFS_DENTRY_NEGATIVE;
+    }
+
+    bucket = fatfs_dentry_bucket(parent, key);
+    added->next = s_dentry_buckets[bucket];
+    s_dentry_buckets[bucket] = node + 1;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_init_dentry_cache.
+* Description: 1 bucket or more per node, the nodes are zeroed by calloc.
+*
+END***************************************************************************/
+static void fatfs_init_dentry_cache(void)
+{
+    uint32_t budget = (0 != s_dentry_budget) ? s_dentry_budget : FATFS_DENTRY_CACHE_BUDGET; /*budget is the number of nodes*/
+    uint32_t buckets = 16;                                                                 /*buckets stores the number of buckets*/
+
+    while (buckets < budget)
+    {
+        buckets *= 2;
+    }
+
+    s_dentries = (fatfs_dentry_struct_t *)calloc(budget, sizeof(fatfs_dentry_struct_t));
+    s_dentry_buckets = (uint32_t *)calloc(buckets, sizeof(uint32_t));
+
+    if ((NULL == s_dentries) || (NULL == s_dentry_buckets))
+    {
+        /*The directories are read for every lookup instead*/
+        free(s_dentries);
+        free(s_dentry_buckets);
+        s_dentries = NULL;
+        s_dentry_buckets = NULL;
+    }
+    else
+    {
+        s_dentry_bucket_mask = buckets - 1;
+        s_dentry_hand = 0;
+        s_dentry_stats.budget = budget;
+    }
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_data_cluster_end.
+* Description: The data region starts after the root directory and holds
+*              sectors_per_cluster sectors per cluster, from cluster 2.
+*
+END***************************************************************************/
+static uint32_t fatfs_data_cluster_end(void)
+{
+    uint32_t end = DATA_REGION_12_LOGICAL_BASE_INDEX; /*end stores the number past the last data cluster*/
+
+    if ((s_FAT12Infor.total_sectors > s_geometry.data_start) && (0 != s_FAT12Infor.sectors_per_cluster))
+    {
+        end += (s_FAT12Infor.total_sectors - s_geometry.data_start) / s_FAT12Infor.sectors_per_cluster;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return (end < s_fat_entry_count) ? end : s_fat_entry_count;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_count_bits.
+* Description: Count the bits 64 at a time.
+*
+END***************************************************************************/
+static uint32_t fatfs_count_bits(const uint8_t *bits, uint32_t size)
+{
+    uint64_t word = 0;  /*word stores 8 bytes of the bitmap*/
+    uint32_t count = 0; /*count stores the number of set bits*/
+    uint32_t i = 0;     /*i used for traversaling the bitmap*/
+
+    for (i = 0; i < size; i += 8)
+    {
+        word = 0;
+        memcpy(&word, bits + i, (size - i < 8) ? size - i : 8);
+
+#if defined(__GNUC__) || defined(__clang__)
+        count += __builtin_popcountll(word);
+#else
+        while (0 != word)
+        {
+            word &= word - 1;
+            count++;
+        }
+#endif
+    }
+
+    return count;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_build_space_map.
+* Description: Classify the expanded FAT with the vector kernels (FAT32 entry
+*              by entry), clear the bits of the clusters that are not data
+*              clusters, count each bitmap and measure the free runs 64
+*              clusters at a time.
+*
+END***************************************************************************/
+static void fatfs_build_space_map(void)
+{
+    uint16_t *entries = s_fat_next; /*entries stores the expanded FAT table*/
+    uint8_t *free_bits = NULL;      /*free_bits points to the free bitmap*/
+    uint32_t end = 0;               /*end is the number past the last data cluster*/
+    uint32_t cluster = 0;           /*cluster is used for traversaling the clusters*/
+    uint32_t run = 0;               /*run stores the length of the current free run*/
+    uint32_t bucket = 0;            /*bucket stores the histogram bucket of a run*/
+    uint64_t word = 0;              /*word stores 64 bits of the free bitmap*/
+    uint32_t map = 0;               /*map is used for traversaling the 3 bitmaps*/
+    uint32_t entry = 0;             /*entry stores the value of a FAT32 entry*/
+
+    /*Expand the FAT12/FAT16 for the pass if it is not kept expanded*/
+    if ((NULL == entries) && (FATFS_FAT32 != s_fat_width))
+    {
+        entries = (uint16_t *)malloc(sizeof(uint16_t) * s_fat_entry_count);
+
+        if ((NULL != entries) && (FATFS_FAT12 == s_fat_width))
+        {
+            fatfs_unpack12(s_fat_table, entries, s_fat_entry_count);
+        }
+        else
+        {
+            for (cluster = 0; (NULL != entries) && (cluster < s_fat_entry_count); cluster++)
+            {
+                entries[cluster] = (uint16_t)fatfs_decode16(s_fat_table, cluster);
+            }
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    s_space_size = (s_fat_entry_count + 7) / 8;
+    s_space_bits = (uint8_t *)calloc(3 * s_space_size + 8, sizeof(uint8_t));
+
+    if (((NULL != entries) || (FATFS_FAT32 == s_fat_width)) && (NULL != s_space_bits))
+    {
+        free_bits = s_space_bits;
+        end = fatfs_data_cluster_end();
+
+        if (NULL != entries)
+        {
+            fatfs_classify16(entries, s_fat_entry_count, (uint16_t)fatfs_entry_bad(s_fat_width), free_bits, free_bits + s_space_size, free_bits + 2 * s_space_size);
+        }
+        else
+        {
+            for (cluster = 0; cluster < s_fat_entry_count; cluster++)
+            {
+                entry = fatfs_decode32(s_fat_table, cluster);
+
+                if (0 == entry)
+                {
+                    map = 0;
+                }
+                else if (fatfs_entry_bad(FATFS_FAT32) == entry)
+                {
+                    map = 1;
+                }
+                else if ((fatfs_entry_reserved(FATFS_FAT32) <= entry) && (fatfs_entry_bad(FATFS_FAT32) > entry))
+                {
+                    map = 2;
+                }
+                else
+                {
+                    continue;
+                }
+
+                s_space_bits[map * s_space_size + cluster / 8] |= 1 << (cluster & 7);
+            }
+        }
+
+        /*Clusters 0 and 1 hold the media descriptor, the entries past the volume fill the last FAT sector*/
+        for (map = 0; map < 3; map++)
+        {
+            s_space_bits[map * s_space_size] &= ~0x03;
+
+            for (cluster = end; cluster < s_fat_entry_count; cluster++)
+            {
+                s_space_bits[map * s_space_size + cluster / 8] &= ~(1 << (cluster & 7));
+            }
+        }
+
+        memset(&s_space_stats, 0, sizeof(s_space_stats));
+
+        s_space_stats.total_clusters = end - DATA_REGION_12_LOGICAL_BASE_INDEX;
+        s_space_stats.free_clusters = fatfs_count_bits(free_bits, s_space_size);
+        s_space_stats.bad_clusters = fatfs_count_bits(free_bits + s_space_size, s_space_size);
+        s_space_stats.reserved_clusters = fatfs_count_bits(free_bits + 2 * s_space_size, s_space_size);
+        s_space_stats.used_clusters = s_space_stats.total_clusters - s_space_stats.free_clusters - s_space_stats.bad_clusters - s_space_stats.reserved_clusters;
+
+        /*Measure the free runs, the cluster past the end closes the last run*/
+        cluster = DATA_REGION_12_LOGICAL_BASE_INDEX;
+        while (cluster <= end)
+        {
+            word = 1;
+
+            /*Skip 64 clusters at once when they are all free or all not free*/
+            if ((0 == (cluster & 63)) && (cluster + 64 <= end))
+            {
+                memcpy(&word, free_bits + cluster / 8, 8);
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+
+            if (~(uint64_t)0 == word)
+            {
+                run += 64;
+                cluster += 64;
+            }
+            else if ((0 == word) && (0 == run))
+            {
+                cluster += 64;
+            }
+            else if ((cluster < end) && (0 != (free_bits[cluster / 8] & (1 << (cluster & 7)))))
+            {
+                run++;
+                cluster++;
+            }
+            else
+            {
+                /*The run ends before this cluster*/
+                if (0 != run)
+                {
+                    s_space_stats.free_runs++;
+
+                    if (run > s_space_stats.largest_free_run)
+                    {
+                        s_space_stats.largest_free_run = run;
+                        s_space_stats.largest_free_first = cluster - run;
+                    }
+                    else
+                    {
+                        /*Do nothing*/
+                    }
+
+                    for (bucket = 0; ((2u << bucket) <= run) && (bucket + 1 < FATFS_FREE_RUN_BUCKETS); bucket++)
+                    {
+                        /*Do nothing*/
+                    }
+
+                    s_space_stats.free_run_histogram[bucket]++;
+                    run = 0;
+                }
+                else
+                {
+                    /*Do nothing*/
+                }
+
+                cluster++;
+            }
+        }
+    }
+    else
+    {
+        free(s_space_bits);
+        s_space_bits = NULL;
+    }
+
+    if (entries != s_fat_next)
+    {
+        free(entries);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_count_invalid_entries.
+* Description: Decode the entries whose first byte is in the sector, an entry
+*              crossing the end of the sector is counted with this sector.
+*
+END***************************************************************************/
+static uint32_t fatfs_count_invalid_entries(const uint8_t *table, uint32_t sector, uint32_t sector_size)
+{
+    uint32_t first = sector * sector_size;                 /*first is the offset of the sector in the table*/
+    uint32_t end = fatfs_data_cluster_end();               /*end is the number past the last data cluster*/
+    uint32_t cluster = (first * 8) / s_fat_width;          /*cluster is the first entry that may start in the sector*/
+    uint32_t reserved = fatfs_entry_reserved(s_fat_width); /*reserved is the first reserved value*/
+    uint32_t offset = 0;                                   /*offset stores the offset of the entry in the table*/
+    uint32_t entry = 0;                                    /*entry stores the value of the entry*/
+    uint32_t count = 0;                                    /*count stores the number of invalid entries*/
+
+    for (; cluster < s_fat_entry_count; cluster++)
+    {
+        offset = fatfs_entry_offset(s_fat_width, cluster);
+
+        if (offset >= first + sector_size)
+        {
+            break;
+        }
+        else if ((cluster < DATA_REGION_12_LOGICAL_BASE_INDEX) || (offset < first))
+        {
+            continue;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        entry = fatfs_decode(s_fat_width, table, cluster);
+
+        if ((1 == entry) || (cluster == entry) || ((end <= entry) && (reserved > entry)))
+        {
+            count++;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    return count;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_load_FAT_copies.
+* Description: The copies follow each other on the disk and are read at once.
+*              A sector where the copies differ takes the copy most copies
+*              agree with, with no majority (2 copies) the copy with the
+*              fewest invalid entries, the first copy on a tie.
+*
+END***************************************************************************/
+static void fatfs_load_FAT_copies(uint32_t sector_size)
+{
+    uint32_t votes[FATFS_MAX_FAT_COPIES]; /*votes stores the number of copies equal to each copy*/
+    uint32_t invalid = 0;                 /*invalid stores the invalid entries of the copy chosen*/
+    uint32_t count = 0;                   /*count stores the invalid entries of a copy*/
+    uint32_t copies = 0;                  /*copies stores the number of copies*/
+    uint32_t chosen = 0;                  /*chosen stores the copy used for the sector*/
+    uint32_t sector = 0;                  /*sector used for traversaling the sectors of 1 copy*/
+    uint32_t offset = 0;                  /*offset stores the offset of the sector in 1 copy*/
+    uint32_t i = 0;                       /*i used for traversaling the copies*/
+    uint32_t j = 0;                       /*j used for traversaling the copies*/
+
+    copies = (s_FAT12Infor.num_of_FATs < FATFS_MAX_FAT_COPIES) ? s_FAT12Infor.num_of_FATs : FATFS_MAX_FAT_COPIES;
+    s_fat_size = sector_size * s_FAT12Infor.sectors_per_FAT;
+    memset(&s_fat_copies_stats, 0, sizeof(s_fat_copies_stats));
+
+    if ((0 != copies) && (0 != s_fat_size))
+    {
+        s_fat_copies = (uint8_t *)malloc((size_t)s_fat_size * copies);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL == s_fat_copies)
+    {
+        return;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    /*Keep the copies read completely*/
+    copies = (uint32_t)kmc_read_multi_sector(s_dev, s_geometry.fat_start, copies * s_FAT12Infor.sectors_per_FAT, s_fat_copies) / s_fat_size;
+    s_fat_copies_stats.copy_count = copies;
+
+    for (sector = 0; sector < s_FAT12Infor.sectors_per_FAT; sector++)
+    {
+        offset = sector * sector_size;
+
+        /*Most sectors are the same in every copy*/
+        for (i = 1; i < copies; i++)
+        {
+            if (sector_size != fatfs_find_diff(s_fat_copies + offset, s_fat_copies + (size_t)i * s_fat_size + offset, sector_size))
+            {
+                break;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+
+        if (i >= copies)
+        {
+            continue;
+        }
+        else
+        {
+            s_fat_copies_stats.differing_sectors++;
+        }
+
+        /*Vote, a copy votes for every copy equal to it*/
+        chosen = 0;
+
+        for (i = 0; i < copies; i++)
+        {
+            votes[i] = 0;
+
+            for (j = 0; j < copies; j++)
+            {
+                if ((i == j) || (sector_size == fatfs_find_diff(s_fat_copies + (size_t)i * s_fat_size + offset, s_fat_copies + (size_t)j * s_fat_size + offset, sector_size)))
+                {
+                    votes[i]++;
+                }
+                else
+                {
+                    /*Do nothing*/
+                }
+            }
+
+            if (votes[i] > votes[chosen])
+            {
+                chosen = i;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+
+        /*No majority, check the entries of every copy*/
+        if (2 * votes[chosen] <= copies)
+        {
+            s_fat_copies_stats.unresolved_sectors++;
+            chosen = 0;
+            invalid = fatfs_count_invalid_entries(s_fat_copies, sector, sector_size);
+
+            for (i = 1; i < copies; i++)
+            {
+                count = fatfs_count_invalid_entries(s_fat_copies + (size_t)i * s_fat_size, sector, sector_size);
+
+                if (count < invalid)
+                {
+                    invalid = count;
+                    chosen = i;
+                }
+                else
+                {
+                    /*Do nothing*/
+                }
+            }
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if ((0 != (s_mount_options & FATFS_OPT_FAT_REPAIR)) && (0 != chosen))
+        {
+            memcpy(s_fat_table + offset, s_fat_copies + (size_t)chosen * s_fat_size + offset, sector_size);
+            s_fat_copies_stats.repaired_sectors++;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_build_indexes.
+* Description: Walk the directory tree once for all the indexes asked. The root
+*              directory is file ID FATFS_OWNER_ROOT of the owner map.
+*
+END***************************************************************************/
+static void fatfs_build_indexes(void)
+{
+    uint8_t path[FATFS_MAX_PATH];             /*path stores the path of the directory being walked*/
+    const fatfs_chain_struct_t *chain = NULL; /*chain stores the cluster chain of the root directory*/
+    uint32_t root = s_geometry.root_cluster;  /*root is the first cluster of the FAT32 root directory*/
+
+    s_index_seen = (uint8_t *)calloc(s_fat_entry_count, sizeof(uint8_t));
+
+    if (0 != (s_mount_options & FATFS_OPT_OWNER_MAP))
+    {
+        s_owner = (uint16_t *)calloc(s_fat_entry_count, sizeof(uint16_t));
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL != s_index_seen)
+    {
+        /*The FAT32 root directory has a chain like any directory*/
+        if ((FATFS_FAT32 == s_fat_width) && (root >= DATA_REGION_12_LOGICAL_BASE_INDEX) && (root < s_fat_entry_count))
+        {
+            s_index_seen[root] = 1;
+            fatfs_get_cluster_chain(&s_cluster_chain, root);
+            chain = &s_cluster_chain;
+
+            if (0 != (s_mount_options & FATFS_OPT_CHAIN_INDEX))
+            {
+                fatfs_index_chain(root);
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if (NULL != s_owner)
+        {
+            fatfs_owner_add((const uint8_t *)"/", 1, chain);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        fatfs_index_dir(ROOT_DIR_12_LOGICAL_BASE_INDEX, 0, path, 0);
+
+        if (0 != s_index_count)
+        {
+            qsort(s_index, s_index_count, sizeof(fatfs_chain_index_entry_struct_t), fatfs_index_compare);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if (0 != (s_mount_options & FATFS_OPT_PATH_INDEX))
+        {
+            fatfs_build_path_table();
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+    else
+    {
+        /*Do nothing, the chains are followed in the FAT and the owner map stays empty*/
+    }
+
+    free(s_index_seen);
+    s_index_seen = NULL;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_index_compare.
+* Description: Order the entries of the chain index by first cluster.
+*
+END***************************************************************************/
+static int fatfs_index_compare(const void *a, const void *b)
+{
+    const fatfs_chain_index_entry_struct_t *entry_a = (const fatfs_chain_index_entry_struct_t *)a; /*entry_a is the first entry*/
+    const fatfs_chain_index_entry_struct_t *entry_b = (const fatfs_chain_index_entry_struct_t *)b; /*entry_b is the second entry*/
+
+    return (entry_a->first_cluster > entry_b->first_cluster) - (entry_a->first_cluster < entry_b->first_cluster);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_clear_index.
+* Description: Free the chain index and its extents.
+*
+END***************************************************************************/
+static void fatfs_clear_index(void)
+{
+    free(s_index);
+    s_index = NULL;
+    s_index_count = 0;
+    s_index_capacity = 0;
+
+    free(s_index_extents.extents);
+    s_index_extents.extents = NULL;
+    s_index_extents.extent_count = 0;
+    s_index_extents.extent_capacity = 0;
+    s_index_extents.cluster_count = 0;
+
+    free(s_owner);
+    s_owner = NULL;
+
+    free(s_owner_files);
+    s_owner_files = NULL;
+    s_owner_file_count = 0;
+    s_owner_file_capacity = 0;
+
+    free(s_owner_paths);
+    s_owner_paths = NULL;
+    s_owner_paths_size = 0;
+    s_owner_paths_capacity = 0;
+
+    free(s_space_bits);
+    s_space_bits = NULL;
+    s_space_size = 0;
+
+    free(s_path_entries);
+    s_path_entries = NULL;
+    s_path_count = 0;
+    s_path_capacity = 0;
+
+    free(s_path_names);
+    s_path_names = NULL;
+    s_path_names_size = 0;
+    s_path_names_capacity = 0;
+
+    free(s_path_slots);
+    s_path_slots = NULL;
+    s_path_slot_mask = 0;
+    s_path_incomplete = 0;
+    s_path_pruned = 0;
+
+    return;
+}
+
+/*******************************************************************************
+ * Functions
+ ******************************************************************************/
+
+/*Functions*********************************************************************
+*
+* Function name: ResgisterPrint_file_func.
+* Description: Register the print file function to the call back function pointer.
+*
+END***************************************************************************/
+void ResgisterPrint_file_func(callback_print_filecontent func)
+{
+    print_file_callback = func;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_set_mount_options.
+* Description: Store the options used by the next mount.
+*
+END***************************************************************************/
+void fatfs_set_mount_options(uint32_t options)
+{
+    s_mount_options = options;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_set_FAT_page_budget.
+* Description: Store the number of pages of the next paged mount.
+*
+END***************************************************************************/
+void fatfs_set_FAT_page_budget(uint32_t pages)
+{
+    s_fat_page_budget = pages;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_set_dentry_cache_budget.
+* Description: Store the number of lookups kept by the next mount.
+*
+END***************************************************************************/
+void fatfs_set_dentry_cache_budget(uint32_t entries)
+{
+    s_dentry_budget = entries;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_init.
+* Description: Initial the FATfs layer. Open the disk image and mount it. The
+*              function will return the state of the disk image.
+*
+END***************************************************************************/
+disk_state_enum_t fatfs_init(uint8_t *file_name)
+{
+    disk_state_enum_t state = 0; /*state stores the status of the disk*/
+
+    /*Initial the HAL layer, map the image to avoid copying sectors*/
+    state = fatfs_mount(kmc_open(file_name, KMC_ACCESS_MMAP));
+
+    /*The handle was opened here, so it is closed by fatfs_de_init*/
+    s_dev_owned = 1;
+
+    return state;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_mount.
+* Description: Mount an opened disk image. Read boot sector, update sector size,
+*              allocate and read FAT table. The function will return the state
+*              of the disk image.
+*
+END***************************************************************************/
+disk_state_enum_t fatfs_mount(kmc_dev_t *dev)
+{
+    uint8_t buffer[512];         /*buffer stores a sector content*/
+    uint32_t i = 0;              /*i used for getting the name of FAT type*/
+    uint32_t offset = 0;         /*offset stores the offset value in the buffer*/
+    uint32_t sector_size = 0;    /*sector_size stores the size of sector after updating*/
+    disk_state_enum_t state = 0; /*state stores the status of the disk*/
+    uint64_t start = 0;          /*start stores the time the mount started*/
+
+    start = fatfs_now_us();
+    memset(&s_fat_stats, 0, sizeof(s_fat_stats));
+
+    s_dev = dev;
+    s_dev_owned = 0;
+
+    /*If the disk image failed to open*/
+    if (NULL == s_dev)
+    {
+        state = FAILED_TO_OPEN;
+    }
+    /*If it opend succesfully*/
+    else
+    {
+        /*Read the boot sector*/
+        kmc_read_sector(s_dev, BOOT_SECTOR_BASE_ADDRESS, buffer);
+
+        s_FAT12Infor.bytes_per_sector = hex_to_decimal(buffer, 11, 2);
+
+        s_FAT12Infor.sectors_per_cluster = hex_to_decimal(buffer, 13, 1);
+
+        s_FAT12Infor.reserved_sectors_quantity = hex_to_decimal(buffer, 14, 2);
+
+        s_FAT12Infor.num_of_FATs = hex_to_decimal(buffer, 16, 1);
+
+        s_FAT12Infor.max_root_dir_entries = hex_to_decimal(buffer, 17, 2);
+
+        s_FAT12Infor.total_sectors = hex_to_decimal(buffer, 19, 2);
+
+        /*Large volumes keep the count in 32 bits*/
+        if (0 == s_FAT12Infor.total_sectors)
+        {
+            s_FAT12Infor.total_sectors = hex_to_decimal(buffer, 32, 4);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        s_FAT12Infor.sectors_per_FAT = hex_to_decimal(buffer, 22, 2);
+
+        /*FAT32 keeps the FAT size in 32 bits*/
+        if (0 == s_FAT12Infor.sectors_per_FAT)
+        {
+            s_FAT12Infor.sectors_per_FAT = hex_to_decimal(buffer, 36, 4);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        s_FAT12Infor.signature = hex_to_decimal(buffer, 38, 1);
+
+        /*Only a FAT32 boot sector has the root directory cluster*/
+        s_geometry.root_cluster = hex_to_decimal(buffer, 44, 4);
+
+        for (i = 0; i < 8; i++)
+        {
+            offset = 54 + i;
+
+            s_FAT12Infor.fat_type[i] = buffer[offset];
+        }
+    }
+
+    /*Nothing to check if the disk image failed to open*/
+    if (FAILED_TO_OPEN == state)
+    {
+        /*Do nothing*/
+    }
+    /*Check if the boot sector is invalid, the regions can not be found from it*/
+    else if ((s_FAT12Infor.bytes_per_sector % 512 != 0) || (s_FAT12Infor.bytes_per_sector < 1) || (s_FAT12Infor.sectors_per_cluster < 1) ||
+             (s_FAT12Infor.reserved_sectors_quantity < 1) || (s_FAT12Infor.num_of_FATs < 1) || (s_FAT12Infor.sectors_per_FAT < 1))
+    {
+        state = BAD_BOOT_SECTOR;
+    }
+    /*If it's valid*/
+    else
+    {
+        state = GOOD_CONDITION;
+
+        /*Get sector size after updating*/
+        sector_size = kmc_update_sector_size(s_dev, s_FAT12Infor.bytes_per_sector);
+
+        /*Find the regions, then the width of the entries: each entry takes 1.5, 2 or 4 bytes*/
+        fatfs_find_geometry();
+        s_fat_width = fatfs_find_FAT_width();
+        s_fat_entry_count = (uint32_t)(((uint64_t)sector_size * s_FAT12Infor.sectors_per_FAT * 8) / s_fat_width);
+
+        /*Page the FAT if asked, nothing is read before the first lookup*/
+        if (0 != (s_mount_options & FATFS_OPT_LAZY_FAT))
+        {
+            fatfs_init_FAT_pages(sector_size);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*Read the whole table if it is not paged*/
+        if (NULL == s_fat_pages)
+        {
+            /*Allocate memory space for FAT table*/
+            s_fat_table = (uint8_t *)malloc(sizeof(uint8_t) * sector_size * s_FAT12Infor.sectors_per_FAT);
+
+            /*Read the FAT table*/
+            kmc_read_multi_sector(s_dev, s_geometry.fat_start, s_FAT12Infor.sectors_per_FAT, s_fat_table);
+
+            /*Compare the copies of the FAT if asked, the table may then be repaired*/
+            if (0 != (s_mount_options & (FATFS_OPT_FAT_COPIES | FATFS_OPT_FAT_REPAIR)))
+            {
+                fatfs_load_FAT_copies(sector_size);
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*Allocate the marks of the chain walker, 1 bit per cluster*/
+        s_chain_seen = (uint8_t *)calloc((s_fat_entry_count + 7) / 8, sizeof(uint8_t));
+
+        /*Expand a FAT12 once if asked, chain walking is then 1 load per hop*/
+        if ((NULL != s_fat_table) && (FATFS_FAT12 == s_fat_width) && (0 != (s_mount_options & FATFS_OPT_EXPAND_FAT)))
+        {
+            fatfs_expand_FAT();
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*Pick the walker of the form of the table, once for the whole mount*/
+        if (NULL != s_fat_pages)
+        {
+            s_walk_chain = fatfs_walk_chain_paged;
+        }
+        else if (NULL != s_fat_next)
+        {
+            s_walk_chain = fatfs_walk_chain_expanded12;
+        }
+        else if (FATFS_FAT16 == s_fat_width)
+        {
+            s_walk_chain = fatfs_walk_chain_table16;
+        }
+        else if (FATFS_FAT32 == s_fat_width)
+        {
+            s_walk_chain = fatfs_walk_chain_table32;
+        }
+        else
+        {
+            s_walk_chain = fatfs_walk_chain_packed12;
+        }
+
+        /*Summarize the free space if asked*/
+        if ((NULL != s_fat_table) && (0 != (s_mount_options & FATFS_OPT_SPACE_MAP)))
+        {
+            fatfs_build_space_map();
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*Keep the names found while the paths are resolved if asked*/
+        if (0 != (s_mount_options & FATFS_OPT_DENTRY_CACHE))
+        {
+            fatfs_init_dentry_cache();
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*Walk the directory tree once if an index is asked*/
+        if (0 != (s_mount_options & (FATFS_OPT_CHAIN_INDEX | FATFS_OPT_OWNER_MAP | FATFS_OPT_PATH_INDEX)))
+        {
+            fatfs_build_indexes();
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    s_fat_stats.mount_time_us = fatfs_now_us() - start;
+
+    return state;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_get_FAT_width.
+* Description: Return the width found at mount.
+*
+END***************************************************************************/
+fatfs_fat_width_enum_t fatfs_get_FAT_width(void)
+{
+    return s_fat_width;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_read_dir.
+* Description: Get the entry list(directory entries) of the root directory or
+*              a subdirectory and return it to the application layer. A first
+*              pass counts the entries, so the columns are laid out in 1
+*              block: the clusters, the sizes, the names, then the attributes.
+*
+END***************************************************************************/
+fatfs_entry_list_struct_t fatfs_read_dir(uint32_t first_logical_cluster)
+{
+    uint8_t *buffer = NULL;   /*buffer stores the content of the directory*/
+    uint8_t *block = NULL;    /*block stores the columns of the entry list*/
+    uint32_t buffer_size = 0; /*buffer_size is the size of the buffer*/
+    uint32_t count = 0;       /*count stores the number of entries in the directory*/
+    uint32_t i = 0;           /*i is used for traversaling the buffer*/
+    uint32_t j = 0;           /*j is used for traversaling the entry list*/
+
+    /*Clear the list of the previous call if the caller did not*/
+    fatfs_clear_dir_list();
+
+    /*Read the content of the directory to buffer*/
+    buffer = fatfs_load_dir(first_logical_cluster, &buffer_size);
+
+    /*Count the entries*/
+    for (i = 0; i < buffer_size; i += 32)
+    {
+        if ((DELETED_ENTRY != buffer[i]) && (UNUSED_ENTRY != buffer[i]) && (FAKE_ENTRY != buffer[i + 11]))
+        {
+            count++;
+        }
+    }
+
+    /*Allocate memory space for the columns of the directory list*/
+    if (0 != count)
+    {
+        block = (uint8_t *)malloc((sizeof(uint32_t) * 2 + FATFS_NAME_SIZE + 1) * count);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL != block)
+    {
+        s_dirlist.first_logical_cluster = (uint32_t *)block;
+        s_dirlist.entry_size = s_dirlist.first_logical_cluster + count;
+        s_dirlist.entry_name = (uint8_t(*)[FATFS_NAME_SIZE])(s_dirlist.entry_size + count);
+        s_dirlist.attribute = (uint8_t *)(s_dirlist.entry_name + count);
+        s_dirlist.list_count = count;
+
+        /*Store each entry to each element in directory list*/
+        for (i = 0; i < buffer_size; i += 32)
+        {
+            if ((DELETED_ENTRY != buffer[i]) && (UNUSED_ENTRY != buffer[i]) && (FAKE_ENTRY != buffer[i + 11]))
+            {
+                /*Get entry name*/
+                memcpy(s_dirlist.entry_name[j], buffer + i, FATFS_NAME_SIZE);
+
+                /*Get entry attribute*/
+                s_dirlist.attribute[j] = buffer[i + 11];
+
+                /*Get entry first logical cluster*/
+                s_dirlist.first_logical_cluster[j] = fatfs_entry_cluster(buffer + i);
+
+                /*Get entry size*/
+                s_dirlist.entry_size[j] = hex_to_decimal(buffer, i + 28, 4);
+
+                j++;
+            }
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    /*Free the buffer*/
+    free(buffer);
+
+    return s_dirlist;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_clear_dir_list.
+* Description: CLear the memory allocate for current entry list(directory list)
+*
+END***************************************************************************/
+void fatfs_clear_dir_list(void)
+{
+    /*Free the block of the columns, it starts at the field first logical cluster*/
+    free(s_dirlist.first_logical_cluster);
+
+    /*Clear the list*/
+    memset(&s_dirlist, 0, sizeof(s_dirlist));
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_dir_fill.
+* Description: The FAT12/FAT16 root directory is read sectors_per_cluster
+*              sectors at a time. A subdirectory follows its chain, the chain
+*              ends on a value that is not a data cluster or after as many
+*              clusters as the data region has. A short read ends the
+*              directory and marks the iterator failed.
+*
+END***************************************************************************/
+static uint32_t fatfs_dir_fill(fatfs_dir_t *dir)
+{
+    uint32_t count = 0; /*count stores the number of sectors to read*/
+    uint32_t entry = 0; /*entry stores the FAT entry of the cluster read*/
+    uint32_t end = 0;   /*end is the number past the last data cluster*/
+
+    dir->size = 0;
+    dir->offset = 0;
+
+    if ((0 != dir->fixed) && (dir->root_sector < s_geometry.root_sectors))
+    {
+        count = s_geometry.root_sectors - dir->root_sector;
+        if (count > s_FAT12Infor.sectors_per_cluster)
+        {
+            count = s_FAT12Infor.sectors_per_cluster;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        dir->size = (uint32_t)kmc_read_multi_sector(s_dev, s_geometry.root_start + dir->root_sector, count, dir->buffer);
+        dir->root_sector += count;
+
+        if (dir->size < count * s_FAT12Infor.bytes_per_sector)
+        {
+            dir->failed = 1;
+            dir->size = 0;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+    else if ((0 == dir->fixed) && (0 != dir->next))
+    {
+        dir->size = (uint32_t)kmc_read_multi_sector(s_dev, fatfs_cluster_sector(dir->next), s_FAT12Infor.sectors_per_cluster, dir->buffer);
+        dir->steps++;
+
+        if (dir->size < s_geometry.cluster_size)
+        {
+            dir->failed = 1;
+            dir->size = 0;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        entry = read_FAT_entry(dir->next);
+        end = fatfs_data_cluster_end();
+
+        if ((entry >= DATA_REGION_12_LOGICAL_BASE_INDEX) && (entry < end) && (dir->steps < end - DATA_REGION_12_LOGICAL_BASE_INDEX))
+        {
+            dir->next = entry;
+        }
+        else
+        {
+            dir->next = 0;
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return dir->size;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_stat_path.
+* Description: Normalize the path, then look it up in the path index if it was
+*              built, in the directories otherwise. A path the index may not
+*              hold (deeper than FATFS_INDEX_MAX_DEPTH, or under a directory
+*              linked twice) is looked up in the directories on a miss.
+*
+END***************************************************************************/
+int32_t fatfs_stat_path(const uint8_t *path, fatfs_dirent_struct_t *entry)
+{
+    uint8_t normal[FATFS_MAX_PATH];                  /*normal stores the normalized path*/
+    const fatfs_path_entry_struct_t *indexed = NULL; /*indexed points to the entry of the path in the path index*/
+    uint32_t length = 0;                             /*length stores the length of the normalized path*/
+    uint32_t depth = 0;                              /*depth stores the number of names in the path*/
+    uint32_t i = 0;                                  /*i is used for traversaling the path*/
+    int32_t result = -1;                             /*result is 0 if the path was found*/
+
+    if ((NULL != s_dev) && (NULL != path))
+    {
+        length = fatfs_normalize_path(path, normal);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (1 == length)
+    {
+        /*The root directory has no entry*/
+        memset(entry->name, ' ', FATFS_NAME_SIZE);
+        entry->attribute = FOLDER_ENTRY;
+        entry->first_logical_cluster = ROOT_DIR_12_LOGICAL_BASE_INDEX;
+        entry->entry_size = 0;
+        result = 0;
+    }
+    else if ((0 != length) && (NULL != s_path_slots))
+    {
+        indexed = fatfs_path_find(normal, length);
+
+        for (i = 0; i < length; i++)
+        {
+            depth += ('/' == normal[i]) ? 1 : 0;
+        }
+
+        if (NULL != indexed)
+        {
+            *entry = indexed->entry;
+            result = 0;
+        }
+        else if ((depth > FATFS_INDEX_MAX_DEPTH) || (0 != s_path_pruned))
+        {
+            result = fatfs_walk_path(normal, length, entry);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+    else if (0 != length)
+    {
+        result = fatfs_walk_path(normal, length, entry);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return result;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_open_path.
+* Description: Find the entry of the path, then read it as fatfs_read_file.
+*
+END***************************************************************************/
+int32_t fatfs_open_path(const uint8_t *path)
+{
+    fatfs_dirent_struct_t entry; /*entry stores the entry of the path*/
+    int32_t result = -1;         /*result is 0 if the file was read*/
+
+    if ((0 == fatfs_stat_path(path, &entry)) && (FOLDER_ENTRY != (entry.attribute & FOLDER_ENTRY)))
+    {
+        fatfs_read_file(entry.first_logical_cluster);
+        result = 0;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return result;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_opendir.
+* Description: Allocate the iterator and its 1 cluster buffer, nothing is read
+*              before the first fatfs_readdir.
+*
+END***************************************************************************/
+fatfs_dir_t *fatfs_opendir(uint32_t first_logical_cluster)
+{
+    fatfs_dir_t *dir = NULL; /*dir stores the iterator*/
+
+    /*The FAT32 root directory has a cluster chain*/
+    if ((ROOT_DIR_12_LOGICAL_BASE_INDEX == first_logical_cluster) && (FATFS_FAT32 == s_fat_width))
+    {
+        first_logical_cluster = s_geometry.root_cluster;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if ((NULL != s_dev) && ((ROOT_DIR_12_LOGICAL_BASE_INDEX == first_logical_cluster) ||
+                            ((first_logical_cluster >= DATA_REGION_12_LOGICAL_BASE_INDEX) && (first_logical_cluster < fatfs_data_cluster_end()))))
+    {
+        dir = (fatfs_dir_t *)malloc(sizeof(fatfs_dir_t) + s_geometry.cluster_size);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL != dir)
+    {
+        memset(dir, 0, sizeof(fatfs_dir_t));
+        dir->fixed = (ROOT_DIR_12_LOGICAL_BASE_INDEX == first_logical_cluster);
+        dir->next = first_logical_cluster;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return dir;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_readdir.
+* Description: Decode the entries of the buffer, read the next cluster when
+*              the buffer is used up.
+*
+END***************************************************************************/
+int32_t fatfs_readdir(fatfs_dir_t *dir, fatfs_dirent_struct_t *entry)
+{
+    uint8_t *raw = NULL; /*raw points to the entry in the buffer*/
+    int32_t found = 0;   /*found is 1 once an entry is stored*/
+
+    if (NULL == dir)
+    {
+        found = -1;
+    }
     else
     {
-        four_bits = (s_fat_table[(3 * logical_cluster) / 2 + 1] & 0x0f) << 8;
-
-        eight_bits = s_fat_table[(3 * logical_cluster) / 2];
+        while ((0 == found) && (0 == dir->end))
+        {
+            /*The buffer is used up, read the next cluster*/
+            if (dir->offset + 32 > dir->size)
+            {
+                if (0 == fatfs_dir_fill(dir))
+                {
+                    dir->end = 1;
+                }
+                else
+                {
+                    /*Do nothing*/
+                }
+            }
+            else
+            {
+                raw = dir->buffer + dir->offset;
+                dir->offset += 32;
 
-        FAT_entry = four_bits + eight_bits;
+                /*No entry follows the first free entry*/
+                if (UNUSED_ENTRY == raw[0])
+                {
+                    dir->end = 1;
+                }
+                else if ((DELETED_ENTRY != raw[0]) && (FAKE_ENTRY != raw[11]))
+                {
+                    memcpy(entry->name, raw, FATFS_NAME_SIZE);
+                    entry->attribute = raw[11];
+                    entry->first_logical_cluster = fatfs_entry_cluster(raw);
+                    entry->entry_size = hex_to_decimal(raw, 28, 4);
+                    found = 1;
+                }
+                else
+                {
+                    /*Do nothing*/
+                }
+            }
+        }
     }
 
-    return FAT_entry;
+    return found;
 }
 
-/*Static functions*************************************************************
+/*Functions*********************************************************************
+*
+* Function name: fatfs_closedir.
+* Description: The buffer is part of the iterator, 1 free releases both.
+*
+END***************************************************************************/
+void fatfs_closedir(fatfs_dir_t *dir)
+{
+    free(dir);
+
+    return;
+}
+
+/*Functions*********************************************************************
 *
-* Function name: fatfs_add_node.
-* Description: Add new node(cluster index) to the cluster_chain.
+* Function name: fatfs_read_file.
+* Description: Get the cluster chain of a file. Use the callback function of file
+*              printing to print the file to console.
 *
 END***************************************************************************/
-static void fatfs_add_node(uint16_t logical_cluster)
+void fatfs_read_file(uint32_t first_logical_cluster)
 {
-    fatfs_node_struct_t *temp = NULL;              /*temp is used for creating new node*/
-    fatfs_node_struct_t *travel = s_cluster_chain; /*travel is used for traversaling the list*/
+    fatfs_chain_cursor_struct_t cursor = {0, 0}; /*cursor is used for traversaling the cluster chain*/
+    const fatfs_chain_struct_t *chain = NULL;    /*chain stores the cluster chain of the file*/
+    const fatfs_extent_struct_t *extent = NULL;  /*extent points to the current extent of the chain*/
+    uint32_t bytes_read = 0;                     /*bytes_read is the number of bytes in the file*/
+    uint8_t *file_content = NULL;                /*file_content stores the content of file*/
+    const uint8_t *sector_view = NULL;           /*sector_view points to the sectors inside the mapped image*/
+    uint32_t view_count = 0;                     /*view_count stores the number of clusters in sector_view*/
+    uint32_t batch_count = 0;                    /*batch_count stores the number of clusters in 1 batch*/
 
-    /*Allocate for new node*/
-    temp = (fatfs_node_struct_t *)malloc(sizeof(fatfs_node_struct_t));
+    /*Get the cluster chain of file, from the chain index if the disk was mounted with it*/
+    chain = fatfs_find_chain(first_logical_cluster);
 
-    /*Assign value for the new node(cluster index)*/
-    temp->logical_cluster = logical_cluster;
-    temp->next = NULL;
+    /*Allocate memory space for file_content, it holds 1 batch of clusters*/
+    file_content = (uint8_t *)malloc(sizeof(uint8_t) * s_geometry.cluster_size * FATFS_IO_BATCH_CLUSTERS);
 
-    /*If the list is currently empty*/
-    if (NULL == s_cluster_chain)
-    {
-        s_cluster_chain = temp;
-    }
-    /*If it's not empty*/
-    else
+    /*Traversal the chain*/
+    while (cursor.extent < chain->extent_count)
     {
-        /*Traversal the list*/
-        while (NULL != travel->next)
+        extent = &chain->extents[cursor.extent];
+        view_count = extent->length - cursor.offset;
+
+        /*Get the rest of the extent straight from the mapped image if possible*/
+        sector_view = kmc_map_sectors(s_dev, fatfs_cluster_sector(extent->first_cluster + cursor.offset), view_count * s_FAT12Infor.sectors_per_cluster);
+
+        if (NULL != sector_view)
         {
-            /*Move to last node*/
-            travel = travel->next;
+            bytes_read += view_count * s_geometry.cluster_size;
+
+            /*Print the extent to console without copying it*/
+            print_file_callback((uint8_t *)sector_view, view_count * s_geometry.cluster_size);
+
+            /*Move to next extent*/
+            cursor.extent++;
+            cursor.offset = 0;
         }
+        else
+        {
+            /*Read the next batch of clusters, each extent is read with 1 request*/
+            batch_count = fatfs_read_cluster_batch(chain, &cursor, file_content);
+
+            bytes_read += batch_count * s_geometry.cluster_size;
 
-        /*Set the new node to be the last node*/
-        travel->next = temp;
+            /*Print the batch to console*/
+            print_file_callback(file_content, batch_count * s_geometry.cluster_size);
+        }
     }
 
+    /*Free the file_content*/
+    free(file_content);
+
     return;
 }
 
-/*Static functions*************************************************************
+/*Functions*********************************************************************
 *
-* Function name: fatfs_get_cluster_chain.
-* Description: Set up a linked list that stores the cluster chain of a file
-*              or subdirectory.
+* Function name: fatfs_check_chain.
+* Description: Get the chain (from the chain index if it has it) and return
+*              how its walk ended.
 *
 END***************************************************************************/
-static uint32_t fatfs_get_cluster_chain(uint16_t first_logical_cluster)
+fatfs_chain_status_enum_t fatfs_check_chain(uint32_t first_logical_cluster, uint32_t *cluster_count)
 {
-    uint16_t logical_cluster = 0; /*logical_cluster is the logical cluster number*/
-    uint32_t chain_length = 0;    /*chain_length stores the length of the cluster chain*/
-
-    logical_cluster = first_logical_cluster;
-
-    /*Add firt_logical_cluster to the list*/
-    fatfs_add_node(logical_cluster);
+    const fatfs_chain_struct_t *chain = NULL; /*chain stores the cluster chain*/
 
-    chain_length++;
+    chain = fatfs_find_chain(first_logical_cluster);
 
-    /*Add the remaining clusters to the list*/
-    while (logical_cluster < 0xFF8)
+    if (NULL != cluster_count)
     {
-        logical_cluster = read_FAT_entry(logical_cluster);
-        fatfs_add_node(logical_cluster);
-        chain_length++;
+        *cluster_count = chain->cluster_count;
+    }
+    else
+    {
+        /*Do nothing*/
     }
 
-    return chain_length - 1;
+    return chain->status;
 }
 
-/*******************************************************************************
- * Functions
- ******************************************************************************/
-
 /*Functions*********************************************************************
 *
-* Function name: ResgisterPrint_file_func.
-* Description: Register the print file function to the call back function pointer.
+* Function name: fatfs_get_cluster_owner.
+* Description: Look the cluster up in the owner map.
 *
 END***************************************************************************/
-void ResgisterPrint_file_func(callback_print_filecontent func)
+uint16_t fatfs_get_cluster_owner(uint32_t logical_cluster)
 {
-    print_file_callback = func;
+    return ((NULL != s_owner) && (logical_cluster < s_fat_entry_count)) ? s_owner[logical_cluster] : FATFS_OWNER_NONE;
 }
 
 /*Functions*********************************************************************
 *
-* Function name: fatfs_init.
-* Description: Initial the FATfs layer. Read boot sector, update sector size,
-*              allocate and read FAT table. The function will return the state
-*              of the disk image.
+* Function name: fatfs_get_sector_owner.
+* Description: The sectors before the root directory are the system area, the
+*              root directory follows, then the data region.
 *
 END***************************************************************************/
-disk_state_enum_t fatfs_init(uint8_t *file_name)
+uint16_t fatfs_get_sector_owner(uint32_t sector)
 {
-    FILE *disk_ptr = NULL;       /*disk_ptr stores the FILE pointer points to the current disk*/
-    uint8_t buffer[512];         /*buffer stores a sector content*/
-    uint32_t i = 0;              /*i used for getting the name of FAT type*/
-    uint32_t offset = 0;         /*offset stores the offset value in the buffer*/
-    uint32_t sector_size = 0;    /*sector_size stores the size of sector after updating*/
-    disk_state_enum_t state = 0; /*state stores the status of the disk*/
-
-    /*Initial the HAL layer*/
-    disk_ptr = kmc_init(file_name);
+    uint16_t owner = FATFS_OWNER_NONE; /*owner stores the file ID owning the sector*/
 
-    /*If the disk image failed to open*/
-    if (NULL == disk_ptr)
+    if (NULL == s_owner)
     {
-        state = FAILED_TO_OPEN;
+        /*Do nothing*/
+    }
+    else if (sector < s_geometry.root_start)
+    {
+        owner = FATFS_OWNER_SYSTEM;
+    }
+    else if (sector < s_geometry.data_start)
+    {
+        owner = FATFS_OWNER_ROOT;
     }
-    /*If it opend succesfully*/
     else
     {
-        /*Read the boot sector*/
-        kmc_read_sector(BOOT_SECTOR_BASE_ADDRESS, buffer);
-
-        s_FAT12Infor.bytes_per_sector = hex_to_decimal(buffer, 11, 2);
-
-        s_FAT12Infor.sectors_per_cluster = hex_to_decimal(buffer, 13, 1);
+        owner = fatfs_get_cluster_owner((sector - s_geometry.data_start) / s_FAT12Infor.sectors_per_cluster + DATA_REGION_12_LOGICAL_BASE_INDEX);
+    }
 
-        s_FAT12Infor.reserved_sectors_quantity = hex_to_decimal(buffer, 14, 2);
+    return owner;
+}
 
-        s_FAT12Infor.num_of_FATs = hex_to_decimal(buffer, 16, 1);
+/*Functions*********************************************************************
+*
+* Function name: fatfs_get_range_owners.
+* Description: Look up each sector of the range, a file met again is not
+*              stored twice.
+*
+END***************************************************************************/
+uint32_t fatfs_get_range_owners(uint64_t offset, uint64_t length, uint16_t *owners, uint32_t max_count)
+{
+    uint64_t sector = 0;                  /*sector is used for traversaling the sectors of the range*/
+    uint64_t last_sector = 0;             /*last_sector is the last sector of the range*/
+    uint16_t owner = FATFS_OWNER_NONE;    /*owner stores the file ID owning the current sector*/
+    uint16_t previous = FATFS_OWNER_NONE; /*previous stores the file ID owning the previous sector*/
+    uint32_t count = 0;                   /*count stores the number of file IDs stored*/
+    uint32_t i = 0;                       /*i is used for traversaling the file IDs stored*/
 
-        s_FAT12Infor.max_root_dir_entries = hex_to_decimal(buffer, 17, 2);
+    if ((0 != length) && (NULL != s_owner) && (0 != s_FAT12Infor.bytes_per_sector))
+    {
+        last_sector = (offset + length - 1) / s_FAT12Infor.bytes_per_sector;
 
-        s_FAT12Infor.total_sectors = hex_to_decimal(buffer, 19, 2);
+        for (sector = offset / s_FAT12Infor.bytes_per_sector; (sector <= last_sector) && (sector < s_FAT12Infor.total_sectors) && (count < max_count); sector++)
+        {
+            owner = fatfs_get_sector_owner((uint32_t)sector);
 
-        s_FAT12Infor.sectors_per_FAT = hex_to_decimal(buffer, 22, 2);
+            if ((FATFS_OWNER_NONE == owner) || (previous == owner))
+            {
+                continue;
+            }
 
-        s_FAT12Infor.signature = hex_to_decimal(buffer, 38, 1);
+            previous = owner;
 
-        for (i = 0; i < 8; i++)
-        {
-            offset = 54 + i;
+            for (i = 0; (i < count) && (owners[i] != owner); i++)
+            {
+                /*Do nothing*/
+            }
 
-            s_FAT12Infor.fat_type[i] = buffer[offset];
+            if (i == count)
+            {
+                owners[count++] = owner;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
         }
     }
-
-    /*Check if the boot sector is invalid*/
-    if ((s_FAT12Infor.bytes_per_sector % 512 != 0) || (s_FAT12Infor.bytes_per_sector < 1) && (s_FAT12Infor.reserved_sectors_quantity < 1) && (s_FAT12Infor.num_of_FATs < 2) && (s_FAT12Infor.max_root_dir_entries % 16 != 0))
-    {
-        state = BAD_BOOT_SECTOR;
-    }
-    /*If it's valid*/
     else
     {
-        state = GOOD_CONDITION;
-
-        /*Get sector size after updating*/
-        sector_size = kmc_update_sector_size(s_FAT12Infor.bytes_per_sector);
-
-        /*Allocate memory space for FAT table*/
-        s_fat_table = (uint8_t *)malloc(sizeof(uint8_t) * sector_size * s_FAT12Infor.sectors_per_FAT);
-
-        /*Read the FAT table*/
-        kmc_read_multi_sector(FAT_TABE_PHYSC_BASE_INDEX, s_FAT12Infor.sectors_per_FAT, s_fat_table);
+        /*Do nothing*/
     }
 
-    return state;
+    return count;
 }
 
 /*Functions*********************************************************************
 *
-* Function name: fatfs_read_dir.
-* Description: Get the entry list(directory entries) of the root directory or
-*              a subdirectory and return it to the application layer.
+* Function name: fatfs_get_owner_path.
+* Description: Return the path stored for the file ID.
 *
 END***************************************************************************/
-fatfs_entry_list_struct_t fatfs_read_dir(uint16_t first_logical_cluster)
+const uint8_t *fatfs_get_owner_path(uint16_t owner)
 {
-    fatfs_node_struct_t *temp = NULL;    /*temp is used for traversaling the list*/
-    uint8_t *buffer = NULL;              /*buffer stores the content of the directory*/
-    uint16_t *entries_index = NULL;      /*entries_index stores the index of all entry in buffer*/
-    uint32_t buffer_size = 0;            /*buffer_size is the size of the buffer*/
-    uint32_t chain_length = 0;           /*chain_length stores the length of the cluster_chain*/
-    uint32_t root_dir_cluster_count = 0; /*root_dir_cluster_count stores the nubmer of cluster in root directory*/
-    uint32_t offset = 0;                 /*offset stores the value of the offset position in buffer*/
-    uint32_t i = 0;                      /*i is used for traversaling the buffer*/
-    uint32_t j = 0;                      /*j is used for traversaling the entries_index*/
+    const uint8_t *path = NULL; /*path stores the path of the file*/
 
-    /*If the directory is root directory*/
-    if (ROOT_DIR_12_LOGICAL_BASE_INDEX == first_logical_cluster)
+    if ((FATFS_OWNER_NONE != owner) && (owner <= s_owner_file_count))
     {
-        /*Get the number of cluster in the root directory*/
-        root_dir_cluster_count = s_FAT12Infor.max_root_dir_entries / ENTRIES_PER_SECTOR;
-
-        /*Get the buffer size*/
-        buffer_size = s_FAT12Infor.bytes_per_sector * root_dir_cluster_count;
-
-        /*Allocate memory space for buffer*/
-        buffer = (uint8_t *)malloc(sizeof(uint8_t) * buffer_size);
-
-        /*Allocate memory space for entries_index*/
-        entries_index = (uint16_t *)malloc(sizeof(uint16_t) * s_FAT12Infor.max_root_dir_entries);
-
-        /*Read the content of root directory to buffer*/
-        kmc_read_multi_sector(ROOT_DIR_12_PHYSC_BASE_INDEX, root_dir_cluster_count, buffer);
+        path = s_owner_paths + s_owner_files[owner - 1].path_offset;
     }
-    /*If the directory is subdirectory*/
-    else if (first_logical_cluster > ROOT_DIR_12_LOGICAL_BASE_INDEX)
+    else
     {
-        /*Get the cluster chain of the subdirectory and it's length*/
-        chain_length = fatfs_get_cluster_chain(first_logical_cluster);
-
-        /*Get the buffer size*/
-        buffer_size = chain_length * s_FAT12Infor.bytes_per_sector;
-
-        /*Allocate memory space for buffer*/
-        buffer = (uint8_t *)malloc(sizeof(uint8_t) * buffer_size);
+        /*Do nothing*/
+    }
 
-        /*Allocate memory space for entries_index*/
-        entries_index = (uint16_t *)malloc(sizeof(uint16_t) * chain_length * ENTRIES_PER_SECTOR);
+    return path;
+}
 
-        /*Set temp node to head node*/
-        temp = s_cluster_chain;
+/*Functions*********************************************************************
+*
+* Function name: fatfs_get_cluster_state.
+* Description: Test the bits of the cluster, or classify its FAT entry.
+*
+END***************************************************************************/
+fatfs_cluster_state_enum_t fatfs_get_cluster_state(uint32_t logical_cluster)
+{
+    fatfs_cluster_state_enum_t state = FATFS_CLUSTER_RESERVED; /*state stores the state of the cluster*/
+    uint32_t entry = 0;                                        /*entry stores the FAT entry of the cluster*/
+    uint8_t bit = 1 << (logical_cluster & 7);                  /*bit is the bit of the cluster in its byte*/
 
-        /*Traversal the list*/
-        while (temp->next != NULL)
+    if ((logical_cluster < DATA_REGION_12_LOGICAL_BASE_INDEX) || (logical_cluster >= fatfs_data_cluster_end()))
+    {
+        /*Do nothing, it is not a data cluster*/
+    }
+    else if (NULL != s_space_bits)
+    {
+        if (0 != (s_space_bits[logical_cluster / 8] & bit))
         {
-            /*Read content of each sector in cluster chain*/
-            kmc_read_sector(temp->logical_cluster + FAT12_CLUSTER_OFFSET_FACTOR, buffer + i);
-
-            /*Move to next node*/
-            temp = temp->next;
-
-            /*Set i as the offset value to move in the buffer*/
-            i += s_FAT12Infor.bytes_per_sector;
+            state = FATFS_CLUSTER_FREE;
+        }
+        else if (0 != (s_space_bits[s_space_size + logical_cluster / 8] & bit))
+        {
+            state = FATFS_CLUSTER_BAD;
+        }
+        else if (0 == (s_space_bits[2 * s_space_size + logical_cluster / 8] & bit))
+        {
+            state = FATFS_CLUSTER_USED;
+        }
+        else
+        {
+            /*Do nothing*/
         }
     }
     else
     {
-        /*Do nothing*/
-    }
+        entry = read_FAT_entry(logical_cluster);
 
-    /*Traversal the buffer*/
-    for (i = 0; i < buffer_size; i += 32)
-    {
-        /*Check the entry*/
-        if ((DELETED_ENTRY != buffer[i]) && (UNUSED_ENTRY != buffer[i]) && (FAKE_ENTRY != buffer[i + 11]))
+        if (0 == entry)
         {
-            /*Store the index of the entry to entries_index*/
-            entries_index[j++] = i;
-
-            /*Increase the entry list count*/
-            s_dirlist.list_count++;
+            state = FATFS_CLUSTER_FREE;
+        }
+        else if (fatfs_entry_bad(s_fat_width) == entry)
+        {
+            state = FATFS_CLUSTER_BAD;
+        }
+        else if ((fatfs_entry_reserved(s_fat_width) > entry) || (fatfs_entry_eoc(s_fat_width) <= entry))
+        {
+            state = FATFS_CLUSTER_USED;
+        }
+        else
+        {
+            /*Do nothing*/
         }
     }
 
-    /*Allocate memory space for the directory list*/
-    s_dirlist.entry_name = (uint8_t **)malloc(sizeof(uint8_t *) * s_dirlist.list_count);
-    for (i = 0; i < s_dirlist.list_count; i++)
+    return state;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_get_space_stats.
+* Description: Copy the allocation summary built at mount.
+*
+END***************************************************************************/
+int32_t fatfs_get_space_stats(fatfs_space_stats_struct_t *stats)
+{
+    int32_t result = -1; /*result stores the result of the function*/
+
+    if (NULL != s_space_bits)
+    {
+        *stats = s_space_stats;
+        result = 0;
+    }
+    else
     {
-        /*Allocate memory space for each entry name in directory list*/
-        s_dirlist.entry_name[i] = (uint8_t *)malloc(sizeof(uint8_t) * 12);
+        /*Do nothing*/
     }
 
-    /*Allocate memory space for field entry_attribute in directory list*/
-    s_dirlist.attribute = (uint8_t *)malloc(sizeof(uint8_t) * s_dirlist.list_count);
+    return result;
+}
 
-    /*Allocate memory space for field entry_size in directory list*/
-    s_dirlist.entry_size = (uint32_t *)malloc(sizeof(uint32_t) * s_dirlist.list_count);
+/*Functions*********************************************************************
+*
+* Function name: fatfs_get_free_bitmap.
+* Description: Return the free bitmap built at mount.
+*
+END***************************************************************************/
+const uint8_t *fatfs_get_free_bitmap(uint32_t *cluster_count)
+{
+    *cluster_count = (NULL != s_space_bits) ? s_fat_entry_count : 0;
 
-    /*Allocate memory space for field first_logical_cluster in directory list*/
-    s_dirlist.first_logical_cluster = (uint16_t *)malloc(sizeof(uint16_t) * s_dirlist.list_count);
+    return s_space_bits;
+}
 
-    /*Store each entry to each element in directory list*/
-    for (i = 0; i < s_dirlist.list_count; i++)
-    {
-        /*Get entry name*/
-        memcpy(s_dirlist.entry_name[i], (buffer + entries_index[i]), 11);
-        s_dirlist.entry_name[i][11] = '\0';
+/*Functions*********************************************************************
+*
+* Function name: fatfs_diff_FAT_copies.
+* Description: Find the differing bytes with the vector kernel and turn them
+*              into entries. On FAT12 byte 3n holds entry 2n, byte 3n + 1 the
+*              entries 2n and 2n + 1, byte 3n + 2 entry 2n + 1.
+*
+END***************************************************************************/
+int32_t fatfs_diff_FAT_copies(uint32_t copy, uint32_t *entries, uint32_t max_count)
+{
+    const uint8_t *copy_table = NULL; /*copy_table is the copy compared*/
+    uint32_t offset = 0;              /*offset stores the offset of the next differing byte*/
+    uint32_t first = 0;               /*first is the first entry held by the byte*/
+    uint32_t last = 0;                /*last is the last entry held by the byte*/
+    int32_t next = 0;                 /*next is the first entry not counted yet*/
+    int32_t count = 0;                /*count stores the number of differing entries*/
 
-        /*Get entry attribute*/
-        s_dirlist.attribute[i] = buffer[entries_index[i] + 11];
+    if ((NULL == s_fat_copies) || (0 == copy) || (copy >= s_fat_copies_stats.copy_count))
+    {
+        return -1;
+    }
+    else
+    {
+        copy_table = s_fat_copies + (size_t)copy * s_fat_size;
+    }
 
-        offset = entries_index[i] + 26;
+    while (offset < s_fat_size)
+    {
+        offset += fatfs_find_diff(s_fat_copies + offset, copy_table + offset, s_fat_size - offset);
 
-        /*Get entry first logical cluster*/
-        s_dirlist.first_logical_cluster[i] = hex_to_decimal(buffer, offset, 2);
+        if (offset >= s_fat_size)
+        {
+            break;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
 
-        offset = entries_index[i] + 28;
+        if (FATFS_FAT12 == s_fat_width)
+        {
+            first = 2 * (offset / 3) + ((2 == offset % 3) ? 1 : 0);
+            last = 2 * (offset / 3) + ((0 == offset % 3) ? 0 : 1);
+        }
+        else
+        {
+            first = (offset * 8) / s_fat_width;
+            last = first;
+        }
 
-        /*Get entry size*/
-        s_dirlist.entry_size[i] = hex_to_decimal(buffer, offset, 4);
-    }
+        for (; (first <= last) && (first < s_fat_entry_count); first++)
+        {
+            /*The previous byte may hold the same entry*/
+            if ((int32_t)first < next)
+            {
+                continue;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
 
-    /*Free the buffer*/
-    free(buffer);
+            if ((NULL != entries) && ((uint32_t)count < max_count))
+            {
+                entries[count] = first;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
 
-    /*Free the entries_index*/
-    free(entries_index);
+            count++;
+            next = first + 1;
+        }
 
-    /*Free the cluster_chain*/
-    fatfs_clear_cluster_chain();
+        offset++;
+    }
 
-    return s_dirlist;
+    return count;
 }
 
 /*Functions*********************************************************************
 *
-* Function name: fatfs_clear_dir_list.
-* Description: CLear the memory allocate for current entry list(directory list)
+* Function name: fatfs_get_FAT_copies_stats.
+* Description: Copy the result of the comparison done at mount.
 *
 END***************************************************************************/
-void fatfs_clear_dir_list(void)
+int32_t fatfs_get_FAT_copies_stats(fatfs_fat_copies_stats_struct_t *stats)
 {
-    uint32_t i = 0; /*i used for traversaling the list*/
+    int32_t result = -1; /*result stores the result of the function*/
 
-    /*Traversal the entry list name*/
-    for (i = 0; i < s_dirlist.list_count; i++)
+    if (NULL != s_fat_copies)
     {
-        /*Free the field entry_name*/
-        free(s_dirlist.entry_name[i]);
+        *stats = s_fat_copies_stats;
+        result = 0;
+    }
+    else
+    {
+        /*Do nothing*/
     }
 
-    /*Free the field attribute*/
-    free(s_dirlist.attribute);
-
-    /*Free the field entry size*/
-    free(s_dirlist.entry_size);
-
-    /*Free the field first logical cluster*/
-    free(s_dirlist.first_logical_cluster);
-
-    /*Clear the list count*/
-    s_dirlist.list_count = 0;
-
-    return;
+    return result;
 }
 
 /*Functions*********************************************************************
 *
-* Function name: fatfs_read_file.
-* Description: Get the cluster chain of a file. Use the callback function of file
-*              printing to print the file to console.
+* Function name: fatfs_get_FAT_stats.
+* Description: Copy the mount time and the paging counters.
 *
 END***************************************************************************/
-void fatfs_read_file(uint16_t first_logical_cluster)
+int32_t fatfs_get_FAT_stats(fatfs_fat_stats_struct_t *stats)
 {
-    fatfs_node_struct_t *temp = NULL; /*temp is used for traversaling the list*/
-    uint32_t bytes_read = 0;          /*bytes_read is the number of bytes in the file*/
-    uint8_t *file_content = NULL;     /*file_content stores the content of file*/
-    uint16_t chain_length = 0;        /*chain_length stores the length of the chain*/
-    uint32_t offset = 0;              /*offset stores the offset value to move in the file_content*/
+    int32_t result = -1; /*result stores the result of the function*/
 
-    /*Get the cluster chain of file and it's length*/
-    chain_length = fatfs_get_cluster_chain(first_logical_cluster);
+    if (NULL != s_dev)
+    {
+        *stats = s_fat_stats;
+        result = 0;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
 
-    /*Set temp to head node*/
-    temp = s_cluster_chain;
+    return result;
+}
 
-    /*Allocate memory space for file_content*/
-    file_content = (uint8_t *)malloc(sizeof(uint8_t) * s_FAT12Infor.bytes_per_sector);
+/*Functions*********************************************************************
+*
+* Function name: fatfs_get_dentry_cache_stats.
+* Description: Copy the counters of the dentry cache.
+*
+END***************************************************************************/
+int32_t fatfs_get_dentry_cache_stats(fatfs_dentry_stats_struct_t *stats)
+{
+    int32_t result = -1; /*result stores the result of the function*/
 
-    /*Traversal the list*/
-    while (NULL != temp->next)
+    if (NULL != s_dentries)
     {
-        /*Read the sector in the node and store it to file_content*/
-        bytes_read += kmc_read_sector(temp->logical_cluster + FAT12_CLUSTER_OFFSET_FACTOR, file_content);
-
-        /*Print each cluster to console*/
-        print_file_callback(file_content, s_FAT12Infor.bytes_per_sector);
-
-        /*Move to next node(cluster)*/
-        temp = temp->next;
+        *stats = s_dentry_stats;
+        result = 0;
+    }
+    else
+    {
+        /*Do nothing*/
     }
 
-    /*Free the file_content*/
-    free(file_content);
-
-    /*Free the cluster_chain*/
-    fatfs_clear_cluster_chain();
-
-    return;
+    return result;
 }
 
 /*Functions*********************************************************************
@@ -581,8 +4267,65 @@ void fatfs_de_init(void)
 {
     /*Free memory space for s_fat_table*/
     free(s_fat_table);
+    s_fat_table = NULL;
+
+    /*Free the pages of the paged FAT*/
+    free(s_fat_pages);
+    free(s_fat_page_data);
+    free(s_fat_page_of);
+    s_fat_pages = NULL;
+    s_fat_page_data = NULL;
+    s_fat_page_of = NULL;
+
+    /*Free the copies of the FAT*/
+    free(s_fat_copies);
+    s_fat_copies = NULL;
+    s_fat_size = 0;
+
+    /*Free the chain index*/
+    fatfs_clear_index();
+
+    /*Free the entry list of the last fatfs_read_dir*/
+    fatfs_clear_dir_list();
+
+    /*Free the dentry cache*/
+    free(s_dentries);
+    free(s_dentry_buckets);
+    s_dentries = NULL;
+    s_dentry_buckets = NULL;
+    s_dentry_bucket_mask = 0;
+    s_dentry_hand = 0;
+    memset(&s_dentry_stats, 0, sizeof(s_dentry_stats));
+
+    /*Free the marks of the chain walker*/
+    free(s_chain_seen);
+    s_chain_seen = NULL;
+
+    /*Free the extent array of the cluster chain*/
+    free(s_cluster_chain.extents);
+    s_cluster_chain.extents = NULL;
+    s_cluster_chain.extent_capacity = 0;
+
+    /*Free memory space for the expanded table*/
+    free(s_fat_next);
+    s_fat_next = NULL;
+    s_fat_entry_count = 0;
+    s_fat_width = FATFS_FAT12;
+    s_walk_chain = fatfs_walk_chain_packed12;
+
+    memset(&s_geometry, 0, sizeof(s_geometry));
+
+    /*Close the disk image if it was opened by fatfs_init*/
+    if (1 == s_dev_owned)
+    {
+        kmc_close(s_dev);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
 
-    /*De-init the HAL layer*/
-    kmc_de_init();
+    s_dev = NULL;
+    s_dev_owned = 0;
 }
 /*End of file*/
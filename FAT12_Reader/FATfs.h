@@ -13,6 +13,7 @@
  ******************************************************************************/
 
 #include <stdint.h>
+#include "HAL.h"
 
 /*******************************************************************************
  * Header guard
@@ -25,8 +26,35 @@
  * Macro
  ******************************************************************************/
 
-#define ENTRIES_PER_SECTOR 16
-#define FAT12_CLUSTER_OFFSET_FACTOR 31
+/*Maximum number of clusters handed to the HAL in 1 extent list*/
+#define FATFS_IO_BATCH_CLUSTERS 64
+
+/*Buckets of the free run histogram, bucket k counts the runs of 2^k to 2^(k+1) - 1 clusters and
+  the last bucket also counts the longer runs*/
+#define FATFS_FREE_RUN_BUCKETS 16
+
+/*Maximum depth of directories walked by the mount-time indexes*/
+#define FATFS_INDEX_MAX_DEPTH 32
+
+/*Size of a full path buffer, each level is "/" and a name of up to 12 characters*/
+#define FATFS_MAX_PATH (FATFS_INDEX_MAX_DEPTH * 13 + 1)
+
+/*File IDs of the owner map that are not files*/
+#define FATFS_OWNER_NONE 0x0000   /*a free cluster, or a cluster no file reaches*/
+#define FATFS_OWNER_ROOT 0x0001   /*the root directory*/
+#define FATFS_OWNER_SYSTEM 0xFFFF /*the boot sector and the FAT tables*/
+
+/*Size of the 8.3 name of an entry, 8 characters of name and 3 of extension padded with spaces*/
+#define FATFS_NAME_SIZE 11
+
+/*Copies of the FAT loaded by FATFS_OPT_FAT_COPIES, the next copies are ignored*/
+#define FATFS_MAX_FAT_COPIES 8
+
+/*FAT sectors kept by FATFS_OPT_LAZY_FAT when no budget is set*/
+#define FATFS_FAT_PAGE_BUDGET 16
+
+/*Lookups kept by FATFS_OPT_DENTRY_CACHE when no budget is set*/
+#define FATFS_DENTRY_CACHE_BUDGET 1024
 
 /*******************************************************************************
  * Enum
@@ -51,22 +79,75 @@ typedef enum entry_discription
 typedef enum FAT12_base_address
 {
     BOOT_SECTOR_BASE_ADDRESS = 0,
-    ROOT_DIR_12_PHYSC_BASE_INDEX = 19,
     ROOT_DIR_12_LOGICAL_BASE_INDEX = 0,
-    DATA_REGION_12_PHYSC_BASE_INDEX = 33,
-    DATA_REGION_12_LOGICAL_BASE_INDEX = 2,
-    FAT_TABE_PHYSC_BASE_INDEX = 1
+    DATA_REGION_12_LOGICAL_BASE_INDEX = 2
 } fatfs_fat12_enum_base_index_t;
 
+/*Width of the FAT entries, found from the number of clusters of the volume*/
+typedef enum fatfs_fat_width
+{
+    FATFS_FAT12 = 12,
+    FATFS_FAT16 = 16,
+    FATFS_FAT32 = 32
+} fatfs_fat_width_enum_t;
+
+/*Options of the next mount, they can be or-ed together*/
+typedef enum fatfs_mount_option
+{
+    FATFS_OPT_NONE = 0x00,
+    FATFS_OPT_EXPAND_FAT = 0x01,   /*expand a FAT12 into 1 uint16_t per cluster, 1 load per hop of a chain*/
+    FATFS_OPT_CHAIN_INDEX = 0x02,  /*walk the directory tree and keep the chain of every file and directory*/
+    FATFS_OPT_OWNER_MAP = 0x04,    /*map every cluster to the file that owns it*/
+    FATFS_OPT_SPACE_MAP = 0x08,    /*build the free/bad/reserved bitmaps and the allocation summary*/
+    FATFS_OPT_FAT_COPIES = 0x10,   /*load every copy of the FAT so they can be compared*/
+    FATFS_OPT_FAT_REPAIR = 0x20,   /*load every copy and use a FAT merged per sector from the consistent copies*/
+    FATFS_OPT_LAZY_FAT = 0x40,     /*read the FAT sectors when a lookup needs them, the options reading the whole
+                                     FAT (EXPAND_FAT, SPACE_MAP, FAT_COPIES, FAT_REPAIR) are then ignored*/
+    FATFS_OPT_PATH_INDEX = 0x80,   /*map the full path of every file and directory to its entry, a path
+                                     lookup is then 1 hash probe*/
+    FATFS_OPT_DENTRY_CACHE = 0x100 /*keep the last names found (or not found) in a directory while the
+                                     paths are resolved without FATFS_OPT_PATH_INDEX*/
+} fatfs_mount_option_enum_t;
+
+/*State of a cluster in the FAT*/
+typedef enum cluster_state
+{
+    FATFS_CLUSTER_FREE,
+    FATFS_CLUSTER_USED,
+    FATFS_CLUSTER_BAD,
+    FATFS_CLUSTER_RESERVED /*reserved value, or not a data cluster of the volume*/
+} fatfs_cluster_state_enum_t;
+
+/*How the walk of a cluster chain ended*/
+typedef enum chain_status
+{
+    FATFS_CHAIN_OK,          /*the chain ends with an end of chain mark*/
+    FATFS_CHAIN_CYCLIC,      /*the chain comes back to a cluster it already holds*/
+    FATFS_CHAIN_TRUNCATED,   /*the chain ends on a bad or reserved mark*/
+    FATFS_CHAIN_OUT_OF_RANGE /*the chain reaches cluster 0, 1 or a cluster past the volume*/
+} fatfs_chain_status_enum_t;
+
 /*******************************************************************************
  * Struct
  ******************************************************************************/
 
-typedef struct node
+/*A run of "length" clusters that follow each other in the data region*/
+typedef struct cluster_extent
+{
+    uint32_t first_cluster;
+    uint32_t length;
+} fatfs_extent_struct_t;
+
+/*Cluster chain of a file or subdirectory, stored as extents in 1 array. A damaged chain keeps the
+  clusters before the damage*/
+typedef struct cluster_chain
 {
-    uint16_t logical_cluster;
-    struct node *next;
-} fatfs_node_struct_t;
+    fatfs_extent_struct_t *extents;
+    uint32_t extent_count;
+    uint32_t extent_capacity;
+    uint32_t cluster_count;
+    fatfs_chain_status_enum_t status;
+} fatfs_chain_struct_t;
 
 typedef struct boot_sector_t
 {
@@ -76,22 +157,82 @@ typedef struct boot_sector_t
     uint16_t reserved_sectors_quantity;
     uint8_t num_of_FATs;
     uint16_t max_root_dir_entries;
-    uint16_t total_sectors;
-    uint16_t sectors_per_FAT;
+    uint32_t total_sectors;
+    uint32_t sectors_per_FAT;
 
     uint8_t signature;
     uint8_t fat_type[8];
 } fatfs_boot_sector_struct_t;
 
+/*Allocation summary of the data clusters*/
+typedef struct space_stats
+{
+    uint32_t total_clusters;                             /*number of data clusters of the volume*/
+    uint32_t free_clusters;                              /*clusters marked 0*/
+    uint32_t used_clusters;                              /*clusters in a chain (next cluster or end of chain)*/
+    uint32_t bad_clusters;                               /*clusters marked bad (0xFF7 on FAT12)*/
+    uint32_t reserved_clusters;                          /*clusters marked with a reserved value*/
+    uint32_t free_runs;                                  /*number of runs of free clusters*/
+    uint32_t largest_free_run;                           /*length of the longest run of free clusters*/
+    uint32_t largest_free_first;                         /*first cluster of the longest run of free clusters*/
+    uint32_t free_run_histogram[FATFS_FREE_RUN_BUCKETS]; /*number of free runs per length bucket*/
+} fatfs_space_stats_struct_t;
+
+/*Result of the comparison of the FAT copies at mount*/
+typedef struct fat_copies_stats
+{
+    uint32_t copy_count;         /*number of copies loaded*/
+    uint32_t differing_sectors;  /*FAT sectors where the copies do not all agree*/
+    uint32_t unresolved_sectors; /*differing sectors with no majority, the copy with the fewest invalid entries is used*/
+    uint32_t repaired_sectors;   /*sectors of the FAT in use not taken from the first copy (FATFS_OPT_FAT_REPAIR)*/
+} fatfs_fat_copies_stats_struct_t;
+
+/*Cost of the mount and of the FAT lookups*/
+typedef struct fat_stats
+{
+    uint64_t mount_time_us;  /*time taken by fatfs_mount in microseconds*/
+    uint32_t paged;          /*1 if the FAT is paged (FATFS_OPT_LAZY_FAT)*/
+    uint32_t page_budget;    /*FAT sectors that can be kept*/
+    uint32_t resident_pages; /*FAT sectors kept now*/
+    uint64_t page_hits;      /*lookups served by a kept sector*/
+    uint64_t page_loads;     /*FAT sectors read from the disk*/
+    uint64_t page_evictions; /*kept sectors dropped to load another one*/
+} fatfs_fat_stats_struct_t;
+
+/*Counters of the dentry cache (FATFS_OPT_DENTRY_CACHE)*/
+typedef struct dentry_stats
+{
+    uint32_t budget;        /*lookups that can be kept*/
+    uint32_t entries;       /*lookups kept now*/
+    uint64_t hits;          /*names found in the cache*/
+    uint64_t negative_hits; /*hits telling the name is not in the directory*/
+    uint64_t misses;        /*names looked up by reading the directory*/
+    uint64_t evictions;     /*kept lookups dropped to keep another one*/
+} fatfs_dentry_stats_struct_t;
+
+/*Entry list of a directory, 1 column per field. The columns are laid out in 1 block that starts at
+  first_logical_cluster, the 32-bit columns first*/
 typedef struct entry_dir_information
 {
-    uint8_t **entry_name;
-    uint8_t *attribute;
-    uint16_t *first_logical_cluster;
-    uint32_t *entry_size;
-    uint16_t list_count;
+    uint32_t *first_logical_cluster;        /*first cluster of each entry*/
+    uint32_t *entry_size;                   /*size in bytes of each entry*/
+    uint8_t (*entry_name)[FATFS_NAME_SIZE]; /*8.3 name of each entry, as stored on the disk (not terminated)*/
+    uint8_t *attribute;                     /*attribute of each entry*/
+    uint32_t list_count;                    /*number of entries*/
 } fatfs_entry_list_struct_t;
 
+/*1 entry returned by fatfs_readdir*/
+typedef struct dirent
+{
+    uint8_t name[FATFS_NAME_SIZE];  /*8.3 name, as stored on the disk (not terminated)*/
+    uint8_t attribute;              /*attribute of the entry*/
+    uint32_t first_logical_cluster; /*first cluster of the entry*/
+    uint32_t entry_size;            /*size in bytes of the entry*/
+} fatfs_dirent_struct_t;
+
+/*Opaque iterator over the entries of 1 directory, see fatfs_opendir*/
+typedef struct fatfs_dir fatfs_dir_t;
+
 /*******************************************************************************
  * Typedef callback function
  ******************************************************************************/
@@ -116,6 +257,36 @@ typedef void (*callback_print_filecontent)(uint8_t *file_content, uint32_t bytes
 void ResgisterPrint_file_func(callback_print_filecontent func);
 
 
+/**
+ * @brief Set the options used by the next fatfs_init/fatfs_mount (FATFS_OPT_NONE by default).
+ *
+ * @param options is the or-ed fatfs_mount_option_enum_t values.
+ *
+ * @return: This function return nothing.
+ */
+void fatfs_set_mount_options(uint32_t options);
+
+/**
+ * @brief Set the number of FAT sectors kept by the next mount with FATFS_OPT_LAZY_FAT, the least
+ *        recently used sector is dropped to load another one.
+ *
+ * @param pages is the number of sectors, 0 for FATFS_FAT_PAGE_BUDGET.
+ *
+ * @return: This function return nothing.
+ */
+void fatfs_set_FAT_page_budget(uint32_t pages);
+
+/**
+ * @brief Set the number of lookups kept by the next mount with FATFS_OPT_DENTRY_CACHE, a lookup
+ *        not used since the clock hand last passed is dropped to keep another one.
+ *
+ * @param entries is the number of lookups, 0 for FATFS_DENTRY_CACHE_BUDGET.
+ *
+ * @return: This function return nothing.
+ */
+void fatfs_set_dentry_cache_budget(uint32_t entries);
+
+
 /**
  * @brief Call the init function in HAL, read boot sector, allocate space and read FAT table.
  *
@@ -127,13 +298,34 @@ disk_state_enum_t fatfs_init(uint8_t *file_name);
 
 
 /**
- * @brief Get the entry list(directory entries) at the position stored first logical cluster.
+ * @brief Mount a disk image that is already opened with kmc_open, so that the caller can set up
+ *        the handle (sector cache, ...) first. The handle stays owned by the caller.
+ *
+ * @param dev is the handle of the disk image.
+ *
+ * @return the status of the file/disk image.
+ */
+disk_state_enum_t fatfs_mount(kmc_dev_t *dev);
+
+/**
+ * @brief Get the width of the FAT entries of the mounted disk.
+ *
+ * @param: This function has no param.
+ *
+ * @return the width of the entries, FATFS_FAT12 if no disk is mounted.
+ */
+fatfs_fat_width_enum_t fatfs_get_FAT_width(void);
+
+
+/**
+ * @brief Get the entry list(directory entries) at the position stored first logical cluster. The
+ *        list takes 1 allocation, the list of the previous call is cleared first.
  *
  * @param firs_logical_cluster has the value of where the directory started.
  *
  * @return the entry list.
  */
-fatfs_entry_list_struct_t fatfs_read_dir(uint16_t first_logical_cluster);
+fatfs_entry_list_struct_t fatfs_read_dir(uint32_t first_logical_cluster);
 
 
 /**
@@ -146,6 +338,42 @@ fatfs_entry_list_struct_t fatfs_read_dir(uint16_t first_logical_cluster);
 void fatfs_clear_dir_list(void);
 
 
+/**
+ * @brief Open an iterator over the entries of a directory. The directory is read 1 cluster at a
+ *        time (sectors_per_cluster sectors of the FAT12/FAT16 root directory) as fatfs_readdir
+ *        needs it, so the memory taken does not depend on the size of the directory and a caller
+ *        that stops early reads only the clusters it went through.
+ *
+ * @param first_logical_cluster has the value of where the directory started
+ *        (ROOT_DIR_12_LOGICAL_BASE_INDEX for the root directory).
+ *
+ * @return the iterator, NULL if no disk is mounted or the cluster is not a data cluster.
+ */
+fatfs_dir_t *fatfs_opendir(uint32_t first_logical_cluster);
+
+
+/**
+ * @brief Get the next entry of a directory. The deleted and long name entries are skipped, the
+ *        first free entry ends the directory, so does a failed read.
+ *
+ * @param dir is the iterator returned by fatfs_opendir.
+ * @param entry stores the entry.
+ *
+ * @return 1 if an entry was stored, 0 at the end of the directory, -1 if dir is NULL.
+ */
+int32_t fatfs_readdir(fatfs_dir_t *dir, fatfs_dirent_struct_t *entry);
+
+
+/**
+ * @brief Close an iterator opened by fatfs_opendir.
+ *
+ * @param dir is the iterator, may be NULL.
+ *
+ * @return: This function return nothing.
+ */
+void fatfs_closedir(fatfs_dir_t *dir);
+
+
 /**
  * @brief Read a file in the disk.
  *
@@ -153,10 +381,161 @@ void fatfs_clear_dir_list(void);
  *
  * @return: This function return nothing.
  */
-void fatfs_read_file(uint16_t first_logical_cluster);
+void fatfs_read_file(uint32_t first_logical_cluster);
+
+
+/**
+ * @brief Get the entry of a file or directory from its full path, for example "/DOC/CONCEPTS.DOC".
+ *        The path is normalized first: '/' and '\\' both separate the names, the names are
+ *        upper-cased, empty names and "." are dropped and ".." goes up 1 level. The lookup is 1
+ *        hash probe with FATFS_OPT_PATH_INDEX (the index holds FATFS_INDEX_MAX_DEPTH levels, a
+ *        deeper path is read from the directories on a miss), the directories are read level by
+ *        level otherwise, through the dentry cache with FATFS_OPT_DENTRY_CACHE.
+ *
+ * @param path is the full path.
+ * @param entry stores the entry. The root directory has a blank name, the folder attribute and
+ *        the first cluster ROOT_DIR_12_LOGICAL_BASE_INDEX.
+ *
+ * @return 0 if the path was found, -1 if not or if no disk is mounted.
+ */
+int32_t fatfs_stat_path(const uint8_t *path, fatfs_dirent_struct_t *entry);
+
+
+/**
+ * @brief Read a file from its full path (see fatfs_stat_path), the content goes to the print
+ *        callback as with fatfs_read_file.
+ *
+ * @param path is the full path of the file.
+ *
+ * @return 0 if the file was read, -1 if the path was not found or is a directory.
+ */
+int32_t fatfs_open_path(const uint8_t *path);
+
+/**
+ * @brief Walk the cluster chain of a file or subdirectory and tell how it ends. The walk stops at
+ *        the first damage, each cluster is visited once so a cycle ends the walk.
+ *
+ * @param first_logical_cluster is the first logical cluster number of the file/subdirectory.
+ * @param cluster_count stores the number of valid clusters before the end or the damage, may be NULL.
+ *
+ * @return the status of the chain.
+ */
+fatfs_chain_status_enum_t fatfs_check_chain(uint32_t first_logical_cluster, uint32_t *cluster_count);
+
+/**
+ * @brief Get the file owning a cluster (needs FATFS_OPT_OWNER_MAP).
+ *
+ * @param logical_cluster is the logical number of the cluster.
+ *
+ * @return the file ID, FATFS_OWNER_NONE if no file owns the cluster.
+ */
+uint16_t fatfs_get_cluster_owner(uint32_t logical_cluster);
+
+/**
+ * @brief Get the file owning a sector of the disk (needs FATFS_OPT_OWNER_MAP).
+ *
+ * @param sector is the physical sector number.
+ *
+ * @return the file ID, FATFS_OWNER_ROOT for the root directory, FATFS_OWNER_SYSTEM for the boot
+ *         sector and the FAT tables, FATFS_OWNER_NONE if no file owns the sector.
+ */
+uint16_t fatfs_get_sector_owner(uint32_t sector);
+
+/**
+ * @brief Get the files owning the bytes of a range of the disk (needs FATFS_OPT_OWNER_MAP),
+ *        in the order they are met. Each file is listed once, sectors owned by no file are skipped.
+ *
+ * @param offset is the byte offset of the range.
+ * @param length is the byte length of the range.
+ * @param owners stores the file IDs.
+ * @param max_count is the number of entries of owners.
+ *
+ * @return the number of file IDs stored.
+ */
+uint32_t fatfs_get_range_owners(uint64_t offset, uint64_t length, uint16_t *owners, uint32_t max_count);
+
+/**
+ * @brief Get the full path of a file of the owner map, for example "/DOC/CONCEPTS.DOC".
+ *
+ * @param owner is the file ID.
+ *
+ * @return the path, NULL if the ID is not a file.
+ */
+const uint8_t *fatfs_get_owner_path(uint16_t owner);
+
+/**
+ * @brief Get the state of a cluster, from the free/bad/reserved bitmaps if the disk was mounted
+ *        with FATFS_OPT_SPACE_MAP, from the FAT otherwise.
+ *
+ * @param logical_cluster is the logical number of the cluster.
+ *
+ * @return the state of the cluster.
+ */
+fatfs_cluster_state_enum_t fatfs_get_cluster_state(uint32_t logical_cluster);
+
+/**
+ * @brief Get the allocation summary built at mount (needs FATFS_OPT_SPACE_MAP).
+ *
+ * @param stats stores the summary.
+ *
+ * @return 0 on success, -1 if the summary was not built.
+ */
+int32_t fatfs_get_space_stats(fatfs_space_stats_struct_t *stats);
+
+/**
+ * @brief Get the free bitmap built at mount (needs FATFS_OPT_SPACE_MAP). Bit i % 8 of byte i / 8 is
+ *        set if cluster i is free, the bits of the clusters 0, 1 and past the volume are clear.
+ *
+ * @param cluster_count stores the number of bits of the bitmap.
+ *
+ * @return the bitmap, NULL if it was not built.
+ */
+const uint8_t *fatfs_get_free_bitmap(uint32_t *cluster_count);
+
+/**
+ * @brief Compare 1 copy of the FAT with the first copy (needs FATFS_OPT_FAT_COPIES or
+ *        FATFS_OPT_FAT_REPAIR).
+ *
+ * @param copy is the number of the copy, 1 for the second copy.
+ * @param entries stores the numbers of the differing entries in ascending order, may be NULL.
+ * @param max_count is the number of entries of entries.
+ *
+ * @return the number of differing entries (more than max_count may differ), -1 if the copies were
+ *         not loaded or the copy does not exist.
+ */
+int32_t fatfs_diff_FAT_copies(uint32_t copy, uint32_t *entries, uint32_t max_count);
+
+/**
+ * @brief Get the result of the comparison of the FAT copies at mount (needs FATFS_OPT_FAT_COPIES
+ *        or FATFS_OPT_FAT_REPAIR).
+ *
+ * @param stats stores the result.
+ *
+ * @return 0 on success, -1 if the copies were not loaded.
+ */
+int32_t fatfs_get_FAT_copies_stats(fatfs_fat_copies_stats_struct_t *stats);
+
+/**
+ * @brief Get the time taken by the mount and the paging counters of the FAT.
+ *
+ * @param stats stores the counters.
+ *
+ * @return 0 on success, -1 if no disk is mounted.
+ */
+int32_t fatfs_get_FAT_stats(fatfs_fat_stats_struct_t *stats);
+
+/**
+ * @brief Get the counters of the dentry cache.
+ *
+ * @param stats stores the counters.
+ *
+ * @return 0 on success, -1 if the disk was not mounted with FATFS_OPT_DENTRY_CACHE.
+ */
+int32_t fatfs_get_dentry_cache_stats(fatfs_dentry_stats_struct_t *stats);
 
 /**
- * @brief De-initialize the FATfs layer, free the memory allocated for FAT table.
+ * @brief De-initialize the FATfs layer, free the memory allocated for FAT table. The disk image
+ *        is closed only if it was opened by fatfs_init.
  *
  * @param: This function has no param.
  *
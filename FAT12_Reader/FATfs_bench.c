@@ -0,0 +1,208 @@
+/**
+ * @file  : FATfs_bench.c
+ * @author: Nguyen The Anh.
+ * @brief : Microbenchmark of the 12-bit FAT unpacking kernels against the
+ *          entry by entry read_FAT_entry loop. Standalone program, build with
+ *          gcc -O2 FATfs_bench.c FATfs_unpack.c -o fatfs_bench
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "FATfs_unpack.h"
+
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+/*Entries of the benchmarked table, the largest FAT12 has 4084 clusters, a
+  FAT16-sized table is used so the run is not dominated by the call overhead*/
+#define BENCH_ENTRY_COUNT 65536
+
+/*Number of times each kernel unpacks the whole table*/
+#define BENCH_ROUNDS 2000
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief The read_FAT_entry of FATfs.c: 1 entry per call, branch on odd/even.
+ *
+ * @param fat_table is the packed FAT table.
+ * @param logical_cluster is the position we want to read.
+ *
+ * @return the value of the entry.
+ */
+static uint16_t bench_read_FAT_entry(const uint8_t *fat_table, uint16_t logical_cluster);
+
+/**
+ * @brief Time 1 kernel and check its output against the reference.
+ *
+ * @param name is the name printed.
+ * @param kernel is the kernel to time, FATFS_UNPACK_AUTO times the read_FAT_entry loop.
+ * @param packed is the packed FAT table.
+ * @param entries stores the unpacked entries.
+ * @param reference is the expected output.
+ * @param base_time is the time of the read_FAT_entry loop (0 to print no speedup).
+ *
+ * @return the time in seconds.
+ */
+static double bench_run(const char *name, fatfs_unpack_kernel_enum_t kernel, const uint8_t *packed, uint16_t *entries, const uint16_t *reference, double base_time);
+
+/*******************************************************************************
+ * Functions
+ ******************************************************************************/
+
+/*Functions*********************************************************************
+*
+* Function name: bench_read_FAT_entry.
+* Description: Copy of read_FAT_entry working on a given table.
+*
+END***************************************************************************/
+static uint16_t bench_read_FAT_entry(const uint8_t *fat_table, uint16_t logical_cluster)
+{
+    uint16_t FAT_entry = 0; /*FAT_entry stores the value of the entry*/
+
+    /*If the logical number is odd*/
+    if (logical_cluster & 1)
+    {
+        FAT_entry = (fat_table[(3 * logical_cluster) / 2] >> 4) + (fat_table[(3 * logical_cluster) / 2 + 1] << 4);
+    }
+    /*If it's even*/
+    else
+    {
+        FAT_entry = ((fat_table[(3 * logical_cluster) / 2 + 1] & 0x0f) << 8) + fat_table[(3 * logical_cluster) / 2];
+    }
+
+    return FAT_entry;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: bench_run.
+* Description: Unpack the table BENCH_ROUNDS times and print the throughput.
+*
+END***************************************************************************/
+static double bench_run(const char *name, fatfs_unpack_kernel_enum_t kernel, const uint8_t *packed, uint16_t *entries, const uint16_t *reference, double base_time)
+{
+    clock_t start = 0;      /*start stores the time before the rounds*/
+    double seconds = 0;     /*seconds stores the time of the rounds*/
+    uint32_t round = 0;     /*round used for counting the rounds*/
+    uint32_t i = 0;         /*i used for traversaling the entries*/
+    volatile uint16_t sink; /*sink keeps the compiler from dropping the loop*/
+
+    if (FATFS_UNPACK_AUTO != kernel)
+    {
+        if (kernel != fatfs_unpack12_select(kernel))
+        {
+            printf("%-22s not supported by this CPU\n", name);
+            return 0;
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    memset(entries, 0, sizeof(uint16_t) * BENCH_ENTRY_COUNT);
+
+    start = clock();
+
+    for (round = 0; round < BENCH_ROUNDS; round++)
+    {
+        if (FATFS_UNPACK_AUTO == kernel)
+        {
+            for (i = 0; i < BENCH_ENTRY_COUNT; i++)
+            {
+                entries[i] = bench_read_FAT_entry(packed, (uint16_t)i);
+            }
+        }
+        else
+        {
+            fatfs_unpack12(packed, entries, BENCH_ENTRY_COUNT);
+        }
+
+        sink = entries[round % BENCH_ENTRY_COUNT];
+    }
+
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    (void)sink;
+
+    printf("%-22s %8.3f ms/table %10.1f Mentries/s", name, 1000.0 * seconds / BENCH_ROUNDS,
+           (double)BENCH_ENTRY_COUNT * BENCH_ROUNDS / seconds / 1e6);
+
+    if (0 < base_time)
+    {
+        printf("  x%.1f", base_time / seconds);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    printf("  %s\n", (0 == memcmp(entries, reference, sizeof(uint16_t) * BENCH_ENTRY_COUNT)) ? "ok" : "MISMATCH");
+
+    return seconds;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: main.
+* Description: Fill a random packed table and run every kernel on it.
+*
+END***************************************************************************/
+int main(void)
+{
+    uint32_t packed_size = (3 * BENCH_ENTRY_COUNT + 1) / 2; /*packed_size is the size of the packed table*/
+    uint8_t *packed = NULL;                                  /*packed stores the packed table*/
+    uint16_t *entries = NULL;                                /*entries stores the output of a kernel*/
+    uint16_t *reference = NULL;                              /*reference stores the output of read_FAT_entry*/
+    double base_time = 0;                                    /*base_time is the time of the read_FAT_entry loop*/
+    uint32_t i = 0;                                          /*i used for traversaling the tables*/
+
+    packed = (uint8_t *)malloc(packed_size);
+    entries = (uint16_t *)malloc(sizeof(uint16_t) * BENCH_ENTRY_COUNT);
+    reference = (uint16_t *)malloc(sizeof(uint16_t) * BENCH_ENTRY_COUNT);
+
+    if ((NULL == packed) || (NULL == entries) || (NULL == reference))
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    srand(12);
+
+    for (i = 0; i < packed_size; i++)
+    {
+        packed[i] = (uint8_t)rand();
+    }
+
+    for (i = 0; i < BENCH_ENTRY_COUNT; i++)
+    {
+        reference[i] = bench_read_FAT_entry(packed, (uint16_t)i);
+    }
+
+    printf("%u entries, %u rounds\n", BENCH_ENTRY_COUNT, BENCH_ROUNDS);
+
+    base_time = bench_run("read_FAT_entry loop", FATFS_UNPACK_AUTO, packed, entries, reference, 0);
+    bench_run("fatfs_unpack12 scalar", FATFS_UNPACK_SCALAR, packed, entries, reference, base_time);
+    bench_run("fatfs_unpack12 sse4.1", FATFS_UNPACK_SSE41, packed, entries, reference, base_time);
+    bench_run("fatfs_unpack12 avx2", FATFS_UNPACK_AVX2, packed, entries, reference, base_time);
+
+    free(packed);
+    free(entries);
+    free(reference);
+
+    return 0;
+}
+/*End of file*/
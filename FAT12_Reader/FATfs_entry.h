@@ -0,0 +1,167 @@
+/**
+ * @file  : FATfs_entry.h
+ * @author: Nguyen The Anh.
+ * @brief : Decoders of the FAT12, FAT16 and FAT32 entries. They are inline so
+ *          a chain walker built for 1 width has no width test in its loop.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdint.h>
+#include "FATfs.h"
+
+/*******************************************************************************
+ * Header guard
+ ******************************************************************************/
+
+#ifndef _FATFS_ENTRY_H_
+#define _FATFS_ENTRY_H_
+
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+/*Inline even at -O1, a walker passes its width as a constant*/
+#if defined(__GNUC__) || defined(__clang__)
+#define FATFS_ALWAYS_INLINE static inline __attribute__((always_inline))
+#else
+#define FATFS_ALWAYS_INLINE static inline
+#endif
+
+/*******************************************************************************
+ * Inline functions
+ ******************************************************************************/
+
+/**
+ * @brief Get the bits of an entry: 0xFFF, 0xFFFF, or 0x0FFFFFFF (the top 4 bits of a FAT32 entry
+ *        are reserved).
+ *
+ * @param width is the width of the entries.
+ *
+ * @return the mask of the entry.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_entry_mask(fatfs_fat_width_enum_t width)
+{
+    return (FATFS_FAT32 == width) ? 0x0FFFFFFFu : ((FATFS_FAT16 == width) ? 0xFFFFu : 0xFFFu);
+}
+
+/**
+ * @brief Get the first reserved value (0xFF0 for FAT12), the values from it up to the bad mark are
+ *        reserved.
+ *
+ * @param width is the width of the entries.
+ *
+ * @return the first reserved value.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_entry_reserved(fatfs_fat_width_enum_t width)
+{
+    return fatfs_entry_mask(width) - 0x0F;
+}
+
+/**
+ * @brief Get the bad cluster mark (0xFF7 for FAT12).
+ *
+ * @param width is the width of the entries.
+ *
+ * @return the bad cluster mark.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_entry_bad(fatfs_fat_width_enum_t width)
+{
+    return fatfs_entry_mask(width) - 0x08;
+}
+
+/**
+ * @brief Get the first end of chain mark (0xFF8 for FAT12).
+ *
+ * @param width is the width of the entries.
+ *
+ * @return the first end of chain mark.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_entry_eoc(fatfs_fat_width_enum_t width)
+{
+    return fatfs_entry_mask(width) - 0x07;
+}
+
+/**
+ * @brief Get the offset of the first byte of an entry in the FAT.
+ *
+ * @param width is the width of the entries.
+ * @param cluster is the number of the entry.
+ *
+ * @return the offset of the entry.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_entry_offset(fatfs_fat_width_enum_t width, uint32_t cluster)
+{
+    return (FATFS_FAT12 == width) ? (3 * cluster) / 2 : cluster * (width / 8);
+}
+
+/**
+ * @brief Read a FAT12 entry, 2 entries in 3 bytes (little endian).
+ *
+ * @param table is the FAT.
+ * @param cluster is the number of the entry.
+ *
+ * @return the value of the entry.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_decode12(const uint8_t *table, uint32_t cluster)
+{
+    const uint8_t *bytes = table + (3 * cluster) / 2; /*bytes points to the first byte of the entry*/
+
+    return (cluster & 1) ? ((uint32_t)(bytes[0] >> 4) | ((uint32_t)bytes[1] << 4))
+                         : ((uint32_t)bytes[0] | ((uint32_t)(bytes[1] & 0x0F) << 8));
+}
+
+/**
+ * @brief Read a FAT16 entry (little endian).
+ *
+ * @param table is the FAT.
+ * @param cluster is the number of the entry.
+ *
+ * @return the value of the entry.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_decode16(const uint8_t *table, uint32_t cluster)
+{
+    const uint8_t *bytes = table + 2 * cluster; /*bytes points to the first byte of the entry*/
+
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8);
+}
+
+/**
+ * @brief Read a FAT32 entry (little endian) without its 4 reserved bits.
+ *
+ * @param table is the FAT.
+ * @param cluster is the number of the entry.
+ *
+ * @return the value of the entry.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_decode32(const uint8_t *table, uint32_t cluster)
+{
+    const uint8_t *bytes = table + 4 * cluster; /*bytes points to the first byte of the entry*/
+
+    return ((uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24)) & 0x0FFFFFFFu;
+}
+
+/**
+ * @brief Read an entry of any width, the test is folded away when width is a constant.
+ *
+ * @param width is the width of the entries.
+ * @param table is the FAT.
+ * @param cluster is the number of the entry.
+ *
+ * @return the value of the entry.
+ */
+FATFS_ALWAYS_INLINE uint32_t fatfs_decode(fatfs_fat_width_enum_t width, const uint8_t *table, uint32_t cluster)
+{
+    return (FATFS_FAT32 == width) ? fatfs_decode32(table, cluster)
+                                  : ((FATFS_FAT16 == width) ? fatfs_decode16(table, cluster) : fatfs_decode12(table, cluster));
+}
+
+/*Header guard*/
+#endif
+/*End of file*/
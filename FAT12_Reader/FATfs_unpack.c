@@ -0,0 +1,611 @@
+/**
+ * @file  : FATfs_unpack.c
+ * @author: Nguyen The Anh.
+ * @brief : Definition of the FAT table kernels: 12-bit entry unpacking, entry
+ *          classification and comparison of FAT copies.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "FATfs_unpack.h"
+
+/*The vector kernels are built with the target attribute and selected at run time*/
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FATFS_UNPACK_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+/*******************************************************************************
+ * Typedef
+ ******************************************************************************/
+
+typedef uint32_t (*fatfs_unpack_func)(const uint8_t *packed, uint16_t *entries, uint32_t count);
+
+typedef uint32_t (*fatfs_classify_func)(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                                        uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits);
+
+typedef uint32_t (*fatfs_diff_func)(const uint8_t *a, const uint8_t *b, uint32_t size);
+
+/*******************************************************************************
+ * Static function prototype
+ ******************************************************************************/
+
+/**
+ * @brief Unpack the entries 2 by 2.
+ *
+ * @param packed is the packed FAT table.
+ * @param entries stores the unpacked entries.
+ * @param count is the number of entries to unpack.
+ *
+ * @return the number of entries unpacked (count).
+ */
+static uint32_t fatfs_unpack12_scalar(const uint8_t *packed, uint16_t *entries, uint32_t count);
+
+/**
+ * @brief Classify the entries 8 by 8, 1 byte of each bitmap per step.
+ *
+ * @param entries is the unpacked FAT table.
+ * @param count is the number of entries.
+ * @param bad_value is the bad cluster mark.
+ * @param free_bits stores the free bitmap.
+ * @param bad_bits stores the bad bitmap.
+ * @param reserved_bits stores the reserved bitmap.
+ *
+ * @return the number of entries classified (count).
+ */
+static uint32_t fatfs_classify16_scalar(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                                        uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits);
+
+/**
+ * @brief Find the first differing byte of 2 buffers, 8 bytes per step.
+ *
+ * @param a is the first buffer.
+ * @param b is the second buffer.
+ * @param size is the size of the buffers.
+ *
+ * @return the offset of the first differing byte, size if the buffers are equal.
+ */
+static uint32_t fatfs_diff_scalar(const uint8_t *a, const uint8_t *b, uint32_t size);
+
+#if defined(FATFS_UNPACK_HAVE_X86)
+/**
+ * @brief Unpack the entries 8 by 8 with SSE4.1, the tail is left to the scalar kernel.
+ *
+ * @param packed is the packed FAT table.
+ * @param entries stores the unpacked entries.
+ * @param count is the number of entries to unpack.
+ *
+ * @return the number of entries unpacked (even, at most count).
+ */
+static uint32_t fatfs_unpack12_sse41(const uint8_t *packed, uint16_t *entries, uint32_t count);
+
+/**
+ * @brief Unpack the entries 16 by 16 with AVX2, the tail is left to the SSE4.1 kernel.
+ *
+ * @param packed is the packed FAT table.
+ * @param entries stores the unpacked entries.
+ * @param count is the number of entries to unpack.
+ *
+ * @return the number of entries unpacked (even, at most count).
+ */
+static uint32_t fatfs_unpack12_avx2(const uint8_t *packed, uint16_t *entries, uint32_t count);
+
+/**
+ * @brief Classify the entries 16 by 16 with SSE2, the tail is left to the scalar kernel.
+ *
+ * @param entries is the unpacked FAT table.
+ * @param count is the number of entries.
+ * @param bad_value is the bad cluster mark.
+ * @param free_bits stores the free bitmap.
+ * @param bad_bits stores the bad bitmap.
+ * @param reserved_bits stores the reserved bitmap.
+ *
+ * @return the number of entries classified (a multiple of 8, at most count).
+ */
+static uint32_t fatfs_classify16_sse2(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                                      uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits);
+
+/**
+ * @brief Classify the entries 32 by 32 with AVX2, the tail is left to the SSE2 kernel.
+ *
+ * @param entries is the unpacked FAT table.
+ * @param count is the number of entries.
+ * @param bad_value is the bad cluster mark.
+ * @param free_bits stores the free bitmap.
+ * @param bad_bits stores the bad bitmap.
+ * @param reserved_bits stores the reserved bitmap.
+ *
+ * @return the number of entries classified (a multiple of 8, at most count).
+ */
+static uint32_t fatfs_classify16_avx2(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                                      uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits);
+
+/**
+ * @brief Find the first differing byte of 2 buffers, 16 bytes per step with SSE2.
+ *
+ * @param a is the first buffer.
+ * @param b is the second buffer.
+ * @param size is the size of the buffers.
+ *
+ * @return the offset of the first differing byte, size if the buffers are equal.
+ */
+static uint32_t fatfs_diff_sse2(const uint8_t *a, const uint8_t *b, uint32_t size);
+
+/**
+ * @brief Find the first differing byte of 2 buffers, 32 bytes per step with AVX2.
+ *
+ * @param a is the first buffer.
+ * @param b is the second buffer.
+ * @param size is the size of the buffers.
+ *
+ * @return the offset of the first differing byte, size if the buffers are equal.
+ */
+static uint32_t fatfs_diff_avx2(const uint8_t *a, const uint8_t *b, uint32_t size);
+#endif
+
+/*******************************************************************************
+ * Variable
+ ******************************************************************************/
+
+/*This variable stores the selected unpacking kernel, NULL until the first selection*/
+static fatfs_unpack_func s_unpack = NULL;
+
+/*This variable stores the selected classification kernel, NULL until the first selection*/
+static fatfs_classify_func s_classify = NULL;
+
+/*This variable stores the selected comparison kernel, NULL until the first selection*/
+static fatfs_diff_func s_diff = NULL;
+
+/*******************************************************************************
+ * Static functions
+ ******************************************************************************/
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_unpack12_scalar.
+* Description: 3 bytes hold 2 entries: the low 12 bits are the even entry, the
+*              high 12 bits the odd one.
+*
+END***************************************************************************/
+static uint32_t fatfs_unpack12_scalar(const uint8_t *packed, uint16_t *entries, uint32_t count)
+{
+    uint32_t i = 0; /*i used for traversaling the entries*/
+
+    for (i = 0; i + 1 < count; i += 2)
+    {
+        entries[i] = packed[0] | ((packed[1] & 0x0f) << 8);
+        entries[i + 1] = (packed[1] >> 4) | (packed[2] << 4);
+
+        packed += 3;
+    }
+
+    /*The table may end with a half pair*/
+    if (i < count)
+    {
+        entries[i] = packed[0] | ((packed[1] & 0x0f) << 8);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return count;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_classify16_scalar.
+* Description: An entry is free if it is 0, bad if it is the bad mark, and
+*              reserved if it is one of the 7 values below the bad mark.
+*
+END***************************************************************************/
+static uint32_t fatfs_classify16_scalar(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                                        uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits)
+{
+    uint8_t free_byte = 0;     /*free_byte stores the free bits of 8 entries*/
+    uint8_t bad_byte = 0;      /*bad_byte stores the bad bits of 8 entries*/
+    uint8_t reserved_byte = 0; /*reserved_byte stores the reserved bits of 8 entries*/
+    uint16_t entry = 0;        /*entry stores the current entry*/
+    uint32_t i = 0;            /*i used for traversaling the entries*/
+
+    for (i = 0; i < count; i++)
+    {
+        entry = entries[i];
+
+        free_byte |= (0 == entry) << (i & 7);
+        bad_byte |= (bad_value == entry) << (i & 7);
+        reserved_byte |= (((entry & 0xFFF8) == (bad_value & 0xFFF8)) && (bad_value != entry)) << (i & 7);
+
+        /*Store the bytes when they are full, or at the end of the table*/
+        if ((7 == (i & 7)) || (i + 1 == count))
+        {
+            free_bits[i / 8] = free_byte;
+            bad_bits[i / 8] = bad_byte;
+            reserved_bits[i / 8] = reserved_byte;
+
+            free_byte = 0;
+            bad_byte = 0;
+            reserved_byte = 0;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    return count;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_diff_scalar.
+* Description: Skip the equal 8-byte words, then find the byte.
+*
+END***************************************************************************/
+static uint32_t fatfs_diff_scalar(const uint8_t *a, const uint8_t *b, uint32_t size)
+{
+    uint64_t word_a = 0; /*word_a stores 8 bytes of a*/
+    uint64_t word_b = 0; /*word_b stores 8 bytes of b*/
+    uint32_t i = 0;      /*i used for traversaling the buffers*/
+
+    for (i = 0; i + 8 <= size; i += 8)
+    {
+        memcpy(&word_a, a + i, 8);
+        memcpy(&word_b, b + i, 8);
+
+        if (word_a != word_b)
+        {
+            break;
+        }
+    }
+
+    while ((i < size) && (a[i] == b[i]))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+#if defined(FATFS_UNPACK_HAVE_X86)
+/*Static functions*************************************************************
+*
+* Function name: fatfs_unpack12_sse41.
+* Description: Load 16 bytes, shuffle the 2 bytes that hold each of the 8
+*              entries into its 16-bit lane, then keep the low 12 bits of the
+*              even lanes and shift the odd lanes right by 4.
+*
+END***************************************************************************/
+__attribute__((target("sse4.1"))) static uint32_t fatfs_unpack12_sse41(const uint8_t *packed, uint16_t *entries, uint32_t count)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11); /*shuffle moves the bytes of each entry to its lane*/
+    const __m128i low_mask = _mm_set1_epi16(0x0FFF);                                          /*low_mask keeps the even entries*/
+    uint32_t packed_size = (3 * count + 1) / 2;                                                /*packed_size is the number of bytes that may be read*/
+    uint32_t i = 0;                                                                            /*i used for traversaling the entries*/
+    __m128i bytes;                                                                             /*bytes stores the loaded bytes, then the shuffled pairs*/
+
+    /*Each step reads 16 bytes for the 12 it uses*/
+    for (i = 0; (i + 8 <= count) && ((3 * i) / 2 + 16 <= packed_size); i += 8)
+    {
+        bytes = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(packed + (3 * i) / 2)), shuffle);
+
+        _mm_storeu_si128((__m128i *)(entries + i), _mm_blend_epi16(_mm_and_si128(bytes, low_mask), _mm_srli_epi16(bytes, 4), 0xAA));
+    }
+
+    return i;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_unpack12_avx2.
+* Description: Same as the SSE4.1 kernel, with 12 bytes loaded in each 128-bit
+*              lane since the byte shuffle does not cross lanes.
+*
+END***************************************************************************/
+__attribute__((target("avx2"))) static uint32_t fatfs_unpack12_avx2(const uint8_t *packed, uint16_t *entries, uint32_t count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11,
+                                             0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11); /*shuffle moves the bytes of each entry to its lane*/
+    const __m256i low_mask = _mm256_set1_epi16(0x0FFF);                                         /*low_mask keeps the even entries*/
+    uint32_t packed_size = (3 * count + 1) / 2;                                                  /*packed_size is the number of bytes that may be read*/
+    uint32_t i = 0;                                                                              /*i used for traversaling the entries*/
+    const uint8_t *src = NULL;                                                                   /*src points to the bytes of the current step*/
+    __m256i bytes;                                                                               /*bytes stores the loaded bytes, then the shuffled pairs*/
+
+    /*Each step reads 28 bytes for the 24 it uses*/
+    for (i = 0; (i + 16 <= count) && ((3 * i) / 2 + 28 <= packed_size); i += 16)
+    {
+        src = packed + (3 * i) / 2;
+
+        bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)src)), _mm_loadu_si128((const __m128i *)(src + 12)), 1);
+        bytes = _mm256_shuffle_epi8(bytes, shuffle);
+
+        _mm256_storeu_si256((__m256i *)(entries + i), _mm256_blend_epi16(_mm256_and_si256(bytes, low_mask), _mm256_srli_epi16(bytes, 4), 0xAA));
+    }
+
+    /*Finish with 8 entries per step*/
+    return i + fatfs_unpack12_sse41(packed + (3 * i) / 2, entries + i, count - i);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_classify16_sse2.
+* Description: Compare 16 entries with 0, the bad mark and the reserved range,
+*              pack the 16-bit masks to bytes and take their sign bits.
+*
+END***************************************************************************/
+__attribute__((target("sse2"))) static uint32_t fatfs_classify16_sse2(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                                                                      uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits)
+{
+    const __m128i zero = _mm_setzero_si128();                          /*zero is the free mark*/
+    const __m128i bad = _mm_set1_epi16((short)bad_value);              /*bad is the bad mark*/
+    const __m128i range_mask = _mm_set1_epi16((short)0xFFF8);          /*range_mask drops the 3 low bits*/
+    const __m128i range = _mm_set1_epi16((short)(bad_value & 0xFFF8)); /*range is the reserved range with the 3 low bits dropped*/
+    __m128i low;                                                       /*low stores the first 8 entries*/
+    __m128i high;                                                      /*high stores the last 8 entries*/
+    __m128i bad_low;                                                   /*bad_low stores the bad mask of low*/
+    __m128i bad_high;                                                  /*bad_high stores the bad mask of high*/
+    uint32_t mask = 0;                                                 /*mask stores the 16 bits of 1 bitmap*/
+    uint32_t i = 0;                                                    /*i used for traversaling the entries*/
+
+    for (i = 0; i + 16 <= count; i += 16)
+    {
+        low = _mm_loadu_si128((const __m128i *)(entries + i));
+        high = _mm_loadu_si128((const __m128i *)(entries + i + 8));
+
+        mask = _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(low, zero), _mm_cmpeq_epi16(high, zero)));
+        free_bits[i / 8] = (uint8_t)mask;
+        free_bits[i / 8 + 1] = (uint8_t)(mask >> 8);
+
+        bad_low = _mm_cmpeq_epi16(low, bad);
+        bad_high = _mm_cmpeq_epi16(high, bad);
+
+        mask = _mm_movemask_epi8(_mm_packs_epi16(bad_low, bad_high));
+        bad_bits[i / 8] = (uint8_t)mask;
+        bad_bits[i / 8 + 1] = (uint8_t)(mask >> 8);
+
+        mask = _mm_movemask_epi8(_mm_packs_epi16(_mm_andnot_si128(bad_low, _mm_cmpeq_epi16(_mm_and_si128(low, range_mask), range)),
+                                                 _mm_andnot_si128(bad_high, _mm_cmpeq_epi16(_mm_and_si128(high, range_mask), range))));
+        reserved_bits[i / 8] = (uint8_t)mask;
+        reserved_bits[i / 8 + 1] = (uint8_t)(mask >> 8);
+    }
+
+    return i;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_classify16_avx2.
+* Description: Same as the SSE2 kernel with 32 entries per step. The byte pack
+*              works per 128-bit lane, the 64-bit quarters are put back in
+*              order before the sign bits are taken.
+*
+END***************************************************************************/
+__attribute__((target("avx2"))) static uint32_t fatfs_classify16_avx2(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                                                                      uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits)
+{
+    const __m256i zero = _mm256_setzero_si256();                          /*zero is the free mark*/
+    const __m256i bad = _mm256_set1_epi16((short)bad_value);              /*bad is the bad mark*/
+    const __m256i range_mask = _mm256_set1_epi16((short)0xFFF8);          /*range_mask drops the 3 low bits*/
+    const __m256i range = _mm256_set1_epi16((short)(bad_value & 0xFFF8)); /*range is the reserved range with the 3 low bits dropped*/
+    __m256i low;                                                          /*low stores the first 16 entries*/
+    __m256i high;                                                         /*high stores the last 16 entries*/
+    __m256i bad_low;                                                      /*bad_low stores the bad mask of low*/
+    __m256i bad_high;                                                     /*bad_high stores the bad mask of high*/
+    uint32_t mask = 0;                                                    /*mask stores the 32 bits of 1 bitmap*/
+    uint32_t i = 0;                                                       /*i used for traversaling the entries*/
+
+    for (i = 0; i + 32 <= count; i += 32)
+    {
+        low = _mm256_loadu_si256((const __m256i *)(entries + i));
+        high = _mm256_loadu_si256((const __m256i *)(entries + i + 16));
+
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi16(_mm256_cmpeq_epi16(low, zero), _mm256_cmpeq_epi16(high, zero)), 0xD8));
+        memcpy(free_bits + i / 8, &mask, 4);
+
+        bad_low = _mm256_cmpeq_epi16(low, bad);
+        bad_high = _mm256_cmpeq_epi16(high, bad);
+
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi16(bad_low, bad_high), 0xD8));
+        memcpy(bad_bits + i / 8, &mask, 4);
+
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi16(_mm256_andnot_si256(bad_low, _mm256_cmpeq_epi16(_mm256_and_si256(low, range_mask), range)),
+                                                                                          _mm256_andnot_si256(bad_high, _mm256_cmpeq_epi16(_mm256_and_si256(high, range_mask), range))), 0xD8));
+        memcpy(reserved_bits + i / 8, &mask, 4);
+    }
+
+    /*Finish with 16 entries per step*/
+    return i + fatfs_classify16_sse2(entries + i, count - i, bad_value, free_bits + i / 8, bad_bits + i / 8, reserved_bits + i / 8);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_diff_sse2.
+* Description: Compare 16 bytes at once, the first clear bit of the equality
+*              mask is the first differing byte.
+*
+END***************************************************************************/
+__attribute__((target("sse2"))) static uint32_t fatfs_diff_sse2(const uint8_t *a, const uint8_t *b, uint32_t size)
+{
+    uint32_t mask = 0; /*mask stores the equality mask of 16 bytes*/
+    uint32_t i = 0;    /*i used for traversaling the buffers*/
+
+    for (i = 0; i + 16 <= size; i += 16)
+    {
+        mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
+
+        if (0xFFFF != mask)
+        {
+            return i + (uint32_t)__builtin_ctz(~mask);
+        }
+    }
+
+    return i + fatfs_diff_scalar(a + i, b + i, size - i);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: fatfs_diff_avx2.
+* Description: Same as the SSE2 kernel with 32 bytes per step.
+*
+END***************************************************************************/
+__attribute__((target("avx2"))) static uint32_t fatfs_diff_avx2(const uint8_t *a, const uint8_t *b, uint32_t size)
+{
+    uint32_t mask = 0; /*mask stores the equality mask of 32 bytes*/
+    uint32_t i = 0;    /*i used for traversaling the buffers*/
+
+    for (i = 0; i + 32 <= size; i += 32)
+    {
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i))));
+
+        if (0xFFFFFFFFu != mask)
+        {
+            return i + (uint32_t)__builtin_ctz(~mask);
+        }
+    }
+
+    return i + fatfs_diff_sse2(a + i, b + i, size - i);
+}
+#endif
+
+/*******************************************************************************
+ * Functions
+ ******************************************************************************/
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_unpack12_select.
+* Description: Check the CPU and fall back to a narrower kernel if the one
+*              asked is not supported.
+*
+END***************************************************************************/
+fatfs_unpack_kernel_enum_t fatfs_unpack12_select(fatfs_unpack_kernel_enum_t kernel)
+{
+    fatfs_unpack_kernel_enum_t selected = FATFS_UNPACK_SCALAR; /*selected stores the kernel used from now on*/
+
+    s_unpack = fatfs_unpack12_scalar;
+    s_classify = fatfs_classify16_scalar;
+    s_diff = fatfs_diff_scalar;
+
+#if defined(FATFS_UNPACK_HAVE_X86)
+    __builtin_cpu_init();
+
+    if (((FATFS_UNPACK_AUTO == kernel) || (FATFS_UNPACK_AVX2 == kernel)) && __builtin_cpu_supports("avx2"))
+    {
+        s_unpack = fatfs_unpack12_avx2;
+        s_classify = fatfs_classify16_avx2;
+        s_diff = fatfs_diff_avx2;
+        selected = FATFS_UNPACK_AVX2;
+    }
+    else if ((FATFS_UNPACK_SCALAR != kernel) && __builtin_cpu_supports("sse4.1"))
+    {
+        s_unpack = fatfs_unpack12_sse41;
+        s_classify = fatfs_classify16_sse2;
+        s_diff = fatfs_diff_sse2;
+        selected = FATFS_UNPACK_SSE41;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+#endif
+
+    return selected;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: fatfs_unpack12.
+* Description: Run the selected kernel, then unpack the entries it left with
+*              the scalar kernel.
+*
+END***************************************************************************/
+void fatfs_unpack12(const uint8_t *packed, uint16_t *entries, uint32_t count)
+{
+    uint32_t done = 0; /*done is the number of entries unpacked by the vector kernel*/
+
+    if (NULL == s_unpack)
+    {
+        fatfs_unpack12_select(FATFS_UNPACK_AUTO);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    done = s_unpack(packed, entries, count);
+
+    if (done < count)
+    {
+        fatfs_unpack12_scalar(packed + (3 * done) / 2, entries + done, count - done);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+/*Functions*********************************************************************
+*
+* Function name: fatfs_classify16.
+* Description: Run the selected kernel, then classify the entries it left with
+*              the scalar kernel.
+*
+END***************************************************************************/
+void fatfs_classify16(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                      uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits)
+{
+    uint32_t done = 0; /*done is the number of entries classified by the vector kernel*/
+
+    if (NULL == s_classify)
+    {
+        fatfs_unpack12_select(FATFS_UNPACK_AUTO);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    done = s_classify(entries, count, bad_value, free_bits, bad_bits, reserved_bits);
+
+    if (done < count)
+    {
+        fatfs_classify16_scalar(entries + done, count - done, bad_value, free_bits + done / 8, bad_bits + done / 8, reserved_bits + done / 8);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+/*Functions*********************************************************************
+*
+* Function name: fatfs_find_diff.
+* Description: Run the selected comparison kernel.
+*
+END***************************************************************************/
+uint32_t fatfs_find_diff(const uint8_t *a, const uint8_t *b, uint32_t size)
+{
+    if (NULL == s_diff)
+    {
+        fatfs_unpack12_select(FATFS_UNPACK_AUTO);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return s_diff(a, b, size);
+}
+/*End of file*/
@@ -0,0 +1,93 @@
+/**
+ * @file  : FATfs_unpack.h
+ * @author: Nguyen The Anh.
+ * @brief : Declare struct, typedef and function using in FATfs_unpack.c.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdint.h>
+
+/*******************************************************************************
+ * Header guard
+ ******************************************************************************/
+
+#ifndef _FATFS_UNPACK_H_
+#define _FATFS_UNPACK_H_
+
+/*******************************************************************************
+ * Enum
+ ******************************************************************************/
+
+/*Kernels that unpack, classify and compare the FAT entries*/
+typedef enum fatfs_unpack_kernel
+{
+    FATFS_UNPACK_AUTO,   /*the fastest kernel the CPU supports*/
+    FATFS_UNPACK_SCALAR, /*2 entries from 3 bytes per step, any CPU*/
+    FATFS_UNPACK_SSE41,  /*8 entries per step with pshufb and pblendw, 16 per step for classification*/
+    FATFS_UNPACK_AVX2    /*16 entries per step, 32 per step for classification*/
+} fatfs_unpack_kernel_enum_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Unpack packed 12-bit FAT entries (2 entries in 3 bytes, little endian) into 16-bit values.
+ *        Only the (3 * count + 1) / 2 bytes that hold the entries are read.
+ *
+ * @param packed is the packed FAT table.
+ * @param entries stores the unpacked entries.
+ * @param count is the number of entries to unpack.
+ *
+ * @return: This function return nothing.
+ */
+void fatfs_unpack12(const uint8_t *packed, uint16_t *entries, uint32_t count);
+
+/**
+ * @brief Classify unpacked FAT entries into bitmaps, bit i (bit i % 8 of byte i / 8) is entry i.
+ *        Each bitmap has (count + 7) / 8 bytes.
+ *
+ * @param entries is the unpacked FAT table.
+ * @param count is the number of entries.
+ * @param bad_value is the bad cluster mark (0xFF7 for FAT12), the 7 values below it are reserved.
+ * @param free_bits stores the bitmap of the free entries (0).
+ * @param bad_bits stores the bitmap of the bad entries.
+ * @param reserved_bits stores the bitmap of the reserved entries.
+ *
+ * @return: This function return nothing.
+ */
+void fatfs_classify16(const uint16_t *entries, uint32_t count, uint16_t bad_value,
+                      uint8_t *free_bits, uint8_t *bad_bits, uint8_t *reserved_bits);
+
+/**
+ * @brief Find the first differing byte of 2 buffers (2 copies of the FAT).
+ *
+ * @param a is the first buffer.
+ * @param b is the second buffer.
+ * @param size is the size of the buffers.
+ *
+ * @return the offset of the first differing byte, size if the buffers are equal.
+ */
+uint32_t fatfs_find_diff(const uint8_t *a, const uint8_t *b, uint32_t size);
+
+/**
+ * @brief Select the kernels used by fatfs_unpack12, fatfs_classify16 and fatfs_find_diff
+ *        (FATFS_UNPACK_SSE41 uses the SSE2 classification and comparison kernels). The kernels
+ *        are selected with FATFS_UNPACK_AUTO on the first call if this function was never called.
+ *
+ * @param kernel is the kernel to use.
+ *
+ * @return the kernel selected, FATFS_UNPACK_SCALAR if the CPU does not support the one asked.
+ */
+fatfs_unpack_kernel_enum_t fatfs_unpack12_select(fatfs_unpack_kernel_enum_t kernel);
+
+/*Header guard*/
+#endif
+/*End of file*/
@@ -14,98 +14,1282 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "HAL.h"
+#include "HAL_priv.h"
 
 /*******************************************************************************
- * Variable
+ * Macro
  ******************************************************************************/
 
-static FILE *s_file_img = NULL;
-static uint16_t s_sector_size = 0;
+/*Maximum number of buffers passed to 1 vector read (IOV_MAX is 1024 on Linux)*/
+#define HAL_MAX_IOV 1024
+
+/*Multiplicative hash of a sector index for the sector cache*/
+#define HAL_CACHE_HASH(index) ((uint32_t)((index) * 2654435761u) >> 7)
+
+/*First readahead window in sectors when a pattern is detected*/
+#define HAL_RA_INITIAL_WINDOW 4
+
+/*Number of sectors read at once when kmc_is_zero_extent has to check the content*/
+#define HAL_ZERO_SCAN_SECTORS 64
+
+/*A handle has a usable sector cache*/
+#define HAL_CACHE_ACTIVE(dev) ((0 < (dev)->cache.stats.capacity) && (NULL == (dev)->ops->map))
+
+/*******************************************************************************
+ * Static function prototype
+ ******************************************************************************/
+
+/**
+ * @brief Read a byte range of the image straight from the backend, without the cache.
+ *
+ * @param dev the handle of the disk image.
+ * @param buff the buffer that stores the bytes.
+ * @param length the number of bytes to read.
+ * @param offset the byte offset in the image.
+ *
+ * @return the number of bytes read succesfully.
+ */
+static size_t hal_read_raw(kmc_dev_t *dev, uint8_t *buff, size_t length, uint64_t offset);
+
+/**
+ * @brief Check that every byte of a buffer is zero.
+ *
+ * @param buff the buffer.
+ * @param length the number of bytes.
+ *
+ * @return 1 if every byte is zero, 0 otherwise.
+ */
+static uint8_t hal_is_zero(const uint8_t *buff, size_t length);
+
+/**
+ * @brief (Re)allocate the sector cache for the current budget and sector size, drop its content.
+ *
+ * @param dev the handle of the disk image.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_cache_setup(kmc_dev_t *dev);
+
+/**
+ * @brief Free the memory of the sector cache.
+ *
+ * @param cache the sector cache.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_cache_free(hal_cache_struct_t *cache);
+
+/**
+ * @brief Find the slot that holds a sector, without touching its CLOCK bit.
+ *
+ * @param cache the sector cache.
+ * @param index the sector index.
+ *
+ * @return the slot, -1 if the sector is not cached.
+ */
+static int32_t hal_cache_find(const hal_cache_struct_t *cache, uint32_t index);
+
+/**
+ * @brief Find a sector in the cache and mark it as referenced.
+ *
+ * @param dev the handle of the disk image.
+ * @param index the sector index.
+ *
+ * @return the cached content of the sector, NULL if it is not cached.
+ */
+static const uint8_t *hal_cache_lookup(kmc_dev_t *dev, uint32_t index);
+
+/**
+ * @brief Store a sector in the cache, evict a slot with CLOCK if the cache is full.
+ *
+ * @param dev the handle of the disk image.
+ * @param index the sector index.
+ * @param data the content of the sector.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_cache_insert(kmc_dev_t *dev, uint32_t index, const uint8_t *data);
+
+/**
+ * @brief Read "num" sectors through the cache, the missing runs are read from the image and cached.
+ *
+ * @param dev the handle of the disk image.
+ * @param index the first sector.
+ * @param num the amount of sector to read.
+ * @param buff the buffer that stores the sectors.
+ *
+ * @return the number of bytes read succesfully.
+ */
+static size_t hal_cache_read(kmc_dev_t *dev, uint32_t index, uint32_t num, uint8_t *buff);
+
+/**
+ * @brief Check that none of the sectors of a list of extents is in the cache.
+ *
+ * @param dev the handle of the disk image.
+ * @param extents the list of extents.
+ * @param count the number of extents.
+ *
+ * @return 1 if no sector is cached, 0 otherwise.
+ */
+static uint8_t hal_cache_run_is_cold(kmc_dev_t *dev, const kmc_extent_struct_t *extents, uint32_t count);
+
+/**
+ * @brief Read the sectors of a range that are not in the cache and cache them.
+ *
+ * @param dev the handle of the disk image.
+ * @param index the first sector.
+ * @param num the amount of sector.
+ * @param buffer a buffer of at least "num" sectors.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_cache_fill(kmc_dev_t *dev, uint32_t index, uint32_t num, uint8_t *buffer);
+
+/**
+ * @brief Prefetch "count" reads of "num" sectors spaced by "stride" (0 for 1 contiguous range).
+ *
+ * @param dev the handle of the disk image.
+ * @param index the first sector of the first read.
+ * @param num the amount of sector of 1 read.
+ * @param stride the distance between 2 reads in sectors, 0 if the reads follow each other.
+ * @param count the number of reads.
+ *
+ * @return the number of reads prefetched.
+ */
+static uint32_t hal_prefetch(kmc_dev_t *dev, uint32_t index, uint32_t num, int64_t stride, uint32_t count);
+
+/**
+ * @brief Check if a read was entirely prefetched by one of the tracked prefetches.
+ *
+ * @param ra the readahead engine.
+ * @param index the first sector of the read.
+ * @param num the amount of sector of the read.
+ *
+ * @return 1 if the read was prefetched, 0 otherwise.
+ */
+static uint8_t hal_readahead_covered(const hal_readahead_struct_t *ra, uint32_t index, uint32_t num);
+
+/**
+ * @brief Feed a read to the readahead engine, which may prefetch the next window.
+ *
+ * @param dev the handle of the disk image.
+ * @param index the first sector of the read.
+ * @param num the amount of sector of the read.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_readahead(kmc_dev_t *dev, uint32_t index, uint32_t num);
+
+/**
+ * @brief Compute the next readahead window.
+ *
+ * @param dev the handle of the disk image.
+ * @param num the amount of sector of the current read.
+ *
+ * @return the next window in sectors.
+ */
+static uint32_t hal_readahead_grow(const kmc_dev_t *dev, uint32_t num);
+
+/*******************************************************************************
+ * Static functions
+ ******************************************************************************/
+
+/*Static functions*************************************************************
+*
+* Function name: hal_read_raw.
+* Description: Read a byte range straight from the backend as 1 buffer.
+*
+END***************************************************************************/
+static size_t hal_read_raw(kmc_dev_t *dev, uint8_t *buff, size_t length, uint64_t offset)
+{
+    struct iovec iov; /*iov describes the buffer*/
+
+    iov.iov_base = buff;
+    iov.iov_len = length;
+
+    return dev->ops->read(dev->ctx, &iov, 1, offset);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_is_zero.
+* Description: The first byte is zero and every byte equals the next one, so
+*              the check runs at memcmp speed.
+*
+END***************************************************************************/
+static uint8_t hal_is_zero(const uint8_t *buff, size_t length)
+{
+    return ((0 == length) || ((0 == buff[0]) && (0 == memcmp(buff, buff + 1, length - 1)))) ? 1 : 0;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cache_setup.
+* Description: Free the current cache and allocate a new one that holds as many
+*              sectors as the budget allows. A mapped or in-memory image gets
+*              no cache, its sectors are read from memory. The counters are
+*              kept.
+*
+END***************************************************************************/
+static void hal_cache_setup(kmc_dev_t *dev)
+{
+    hal_cache_struct_t *cache = &dev->cache; /*cache is the sector cache of the handle*/
+    uint32_t capacity = 0;                   /*capacity stores the number of slots*/
+    uint32_t bucket_count = 1;               /*bucket_count stores the number of hash buckets*/
+    uint32_t i = 0;                          /*i used for traversaling the buckets*/
+
+    hal_cache_free(cache);
+
+    capacity = (NULL == dev->ops->map) ? cache->budget / dev->sector_size : 0;
+
+    if (0 < capacity)
+    {
+        /*Keep the load factor of the hash table at most 1*/
+        while (bucket_count < capacity)
+        {
+            bucket_count <<= 1;
+        }
+
+        cache->sector = (uint32_t *)malloc(sizeof(uint32_t) * capacity);
+        cache->next = (int32_t *)malloc(sizeof(int32_t) * capacity);
+        cache->bucket = (int32_t *)malloc(sizeof(int32_t) * bucket_count);
+        cache->referenced = (uint8_t *)calloc(capacity, sizeof(uint8_t));
+        cache->data = (uint8_t *)malloc((size_t)capacity * dev->sector_size);
+
+        if ((NULL == cache->sector) || (NULL == cache->next) || (NULL == cache->bucket) || (NULL == cache->referenced) || (NULL == cache->data))
+        {
+            hal_cache_free(cache);
+        }
+        else
+        {
+            for (i = 0; i < bucket_count; i++)
+            {
+                cache->bucket[i] = -1;
+            }
+
+            cache->bucket_mask = bucket_count - 1;
+            cache->stats.capacity = capacity;
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cache_free.
+* Description: Free the memory of the sector cache and mark it as empty.
+*
+END***************************************************************************/
+static void hal_cache_free(hal_cache_struct_t *cache)
+{
+    free(cache->sector);
+    free(cache->next);
+    free(cache->bucket);
+    free(cache->referenced);
+    free(cache->data);
+
+    cache->sector = NULL;
+    cache->next = NULL;
+    cache->bucket = NULL;
+    cache->referenced = NULL;
+    cache->data = NULL;
+    cache->hand = 0;
+    cache->bucket_mask = 0;
+    cache->stats.capacity = 0;
+    cache->stats.used = 0;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cache_find.
+* Description: Walk the bucket of the sector and return its slot, -1 on a miss.
+*
+END***************************************************************************/
+static int32_t hal_cache_find(const hal_cache_struct_t *cache, uint32_t index)
+{
+    int32_t slot = 0; /*slot is used for traversaling the bucket*/
+
+    slot = cache->bucket[HAL_CACHE_HASH(index) & cache->bucket_mask];
+
+    while ((0 <= slot) && (cache->sector[slot] != index))
+    {
+        slot = cache->next[slot];
+    }
+
+    return slot;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cache_lookup.
+* Description: Walk the bucket of the sector, set the CLOCK bit of the slot and
+*              return its content. Return NULL on a miss.
+*
+END***************************************************************************/
+static const uint8_t *hal_cache_lookup(kmc_dev_t *dev, uint32_t index)
+{
+    hal_cache_struct_t *cache = &dev->cache; /*cache is the sector cache of the handle*/
+    const uint8_t *data = NULL;              /*data points to the cached sector*/
+    int32_t slot = 0;                        /*slot is used for traversaling the bucket*/
+
+    slot = hal_cache_find(cache, index);
+
+    if (0 <= slot)
+    {
+        cache->referenced[slot] = 1;
+        data = cache->data + (size_t)slot * dev->sector_size;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return data;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cache_insert.
+* Description: Take a free slot, or the first slot the CLOCK hand finds without
+*              its reference bit, unlink it from its bucket and store the sector.
+*
+END***************************************************************************/
+static void hal_cache_insert(kmc_dev_t *dev, uint32_t index, const uint8_t *data)
+{
+    hal_cache_struct_t *cache = &dev->cache; /*cache is the sector cache of the handle*/
+    uint32_t slot = 0;                       /*slot is the slot that receives the sector*/
+    int32_t *link = NULL;                    /*link is used for unlinking the evicted slot*/
+    uint32_t bucket = 0;                     /*bucket is the hash bucket of the sector*/
+
+    /*Use the free slots first*/
+    if (cache->stats.used < cache->stats.capacity)
+    {
+        slot = cache->stats.used++;
+    }
+    else
+    {
+        /*Give a second chance to the referenced slots*/
+        while (0 != cache->referenced[cache->hand])
+        {
+            cache->referenced[cache->hand] = 0;
+            cache->hand = (cache->hand + 1) % cache->stats.capacity;
+        }
+
+        slot = cache->hand;
+        cache->hand = (cache->hand + 1) % cache->stats.capacity;
+
+        /*Unlink the evicted slot from its bucket*/
+        link = &cache->bucket[HAL_CACHE_HASH(cache->sector[slot]) & cache->bucket_mask];
+
+        while (*link != (int32_t)slot)
+        {
+            link = &cache->next[*link];
+        }
+
+        *link = cache->next[slot];
+
+        cache->stats.evictions++;
+    }
+
+    /*Store the sector and link the slot to its bucket*/
+    bucket = HAL_CACHE_HASH(index) & cache->bucket_mask;
+
+    cache->sector[slot] = index;
+    cache->referenced[slot] = 0;
+    cache->next[slot] = cache->bucket[bucket];
+    cache->bucket[bucket] = (int32_t)slot;
+
+    memcpy(cache->data + (size_t)slot * dev->sector_size, data, dev->sector_size);
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cache_read.
+* Description: Copy the cached sectors to buff. Each run of missing sectors is
+*              read from the image with 1 read and then cached. Return the total
+*              bytes read.
+*
+END***************************************************************************/
+static size_t hal_cache_read(kmc_dev_t *dev, uint32_t index, uint32_t num, uint8_t *buff)
+{
+    const uint8_t *data = NULL; /*data points to a cached sector*/
+    size_t total_bytes = 0;     /*total_bytes stores the num of bytes read successfully*/
+    size_t run_bytes = 0;       /*run_bytes stores the bytes read for a run of missing sectors*/
+    uint32_t i = 0;             /*i is used for traversaling the sectors*/
+    uint32_t run_end = 0;       /*run_end is the sector after the current run of missing sectors*/
+
+    while (i < num)
+    {
+        data = hal_cache_lookup(dev, index + i);
+
+        if (NULL != data)
+        {
+            dev->cache.stats.hits++;
+
+            memcpy(buff + (size_t)i * dev->sector_size, data, dev->sector_size);
+            total_bytes += dev->sector_size;
+            i++;
+        }
+        else
+        {
+            /*Find the end of the run of missing sectors*/
+            run_end = i + 1;
+
+            while ((run_end < num) && (NULL == hal_cache_lookup(dev, index + run_end)))
+            {
+                run_end++;
+            }
+
+            dev->cache.stats.misses += run_end - i;
+
+            run_bytes = hal_read_raw(dev, buff + (size_t)i * dev->sector_size, (size_t)(run_end - i) * dev->sector_size, (uint64_t)(index + i) * dev->sector_size);
+            total_bytes += run_bytes;
+
+            /*Cache the whole sectors read*/
+            for (; (i < run_end) && (run_bytes >= dev->sector_size); i++)
+            {
+                hal_cache_insert(dev, index + i, buff + (size_t)i * dev->sector_size);
+                run_bytes -= dev->sector_size;
+            }
+
+            /*Stop at the end of the image*/
+            if (i < run_end)
+            {
+                break;
+            }
+        }
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cache_run_is_cold.
+* Description: Return 1 if none of the sectors of the extents is cached.
+*
+END***************************************************************************/
+static uint8_t hal_cache_run_is_cold(kmc_dev_t *dev, const kmc_extent_struct_t *extents, uint32_t count)
+{
+    hal_cache_struct_t *cache = &dev->cache; /*cache is the sector cache of the handle*/
+    uint8_t is_cold = 1;                     /*is_cold stores the result*/
+    uint32_t i = 0;                          /*i used for traversaling the extents*/
+    uint32_t j = 0;                          /*j used for traversaling the sectors of 1 extent*/
+
+    for (i = 0; (i < count) && (1 == is_cold); i++)
+    {
+        for (j = 0; (j < extents[i].num) && (1 == is_cold); j++)
+        {
+            /*Look the sector up without touching its CLOCK bit*/
+            is_cold = (0 <= hal_cache_find(cache, extents[i].index + j)) ? 0 : 1;
+        }
+    }
+
+    return is_cold;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cache_fill.
+* Description: Read the sectors of the range that are not cached yet, 1 read per
+*              missing run, and store them in the cache. The cache counters are
+*              not touched.
+*
+END***************************************************************************/
+static void hal_cache_fill(kmc_dev_t *dev, uint32_t index, uint32_t num, uint8_t *buffer)
+{
+    size_t run_bytes = 0;   /*run_bytes stores the bytes read for a missing run*/
+    uint32_t i = 0;         /*i is used for traversaling the sectors*/
+    uint32_t j = 0;         /*j is used for traversaling the sectors of a missing run*/
+    uint32_t run_start = 0; /*run_start is the first sector of the current missing run*/
+
+    while (i < num)
+    {
+        if (0 <= hal_cache_find(&dev->cache, index + i))
+        {
+            i++;
+        }
+        else
+        {
+            /*Find the end of the run of missing sectors*/
+            run_start = i;
+            i++;
+
+            while ((i < num) && (0 > hal_cache_find(&dev->cache, index + i)))
+            {
+                i++;
+            }
+
+            run_bytes = hal_read_raw(dev, buffer, (size_t)(i - run_start) * dev->sector_size, (uint64_t)(index + run_start) * dev->sector_size);
+
+            /*Cache the whole sectors read*/
+            for (j = 0; (j < i - run_start) && ((size_t)(j + 1) * dev->sector_size <= run_bytes); j++)
+            {
+                hal_cache_insert(dev, index + run_start + j, buffer + (size_t)j * dev->sector_size);
+            }
+        }
+    }
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_prefetch.
+* Description: Bring "count" reads of "num" sectors spaced by "stride" in ahead
+*              of time (stride 0 means 1 contiguous range): into the sector cache
+*              if the handle has one, otherwise hint the backend.
+*              The prefetch is remembered to count the readahead hits. Return
+*              the number of reads actually prefetched.
+*
+END***************************************************************************/
+static uint32_t hal_prefetch(kmc_dev_t *dev, uint32_t index, uint32_t num, int64_t stride, uint32_t count)
+{
+    hal_readahead_struct_t *ra = &dev->ra; /*ra is the readahead engine of the handle*/
+    hal_ra_range_struct_t *range = NULL;   /*range is the tracked slot of this prefetch*/
+    uint8_t *buffer = NULL;                /*buffer is the new prefetch buffer*/
+    uint64_t offset = 0;                   /*offset stores the byte offset of 1 read*/
+    uint64_t length = 0;                   /*length stores the byte length of 1 read*/
+    uint32_t i = 0;                        /*i used for traversaling the reads*/
+
+    if (0 == stride)
+    {
+        /*1 contiguous range of num * count sectors*/
+        num = num * count;
+        count = 1;
+    }
+
+    if (HAL_CACHE_ACTIVE(dev))
+    {
+        /*Never prefetch more than half of the cache, it would evict itself*/
+        while ((1 < count) && ((uint64_t)num * count > dev->cache.stats.capacity / 2))
+        {
+            count--;
+        }
+
+        if (num > dev->cache.stats.capacity / 2)
+        {
+            num = dev->cache.stats.capacity / 2;
+        }
+
+        if (ra->buffer_size < (size_t)num * dev->sector_size)
+        {
+            buffer = (uint8_t *)realloc(ra->buffer, (size_t)num * dev->sector_size);
+
+            if (NULL != buffer)
+            {
+                ra->buffer = buffer;
+                ra->buffer_size = (size_t)num * dev->sector_size;
+            }
+            else
+            {
+                count = 0;
+            }
+        }
+    }
+
+    for (i = 0; (i < count) && (0 < num); i++)
+    {
+        offset = (uint64_t)(index + stride * i) * dev->sector_size;
+        length = (uint64_t)num * dev->sector_size;
+
+        if (HAL_CACHE_ACTIVE(dev))
+        {
+            hal_cache_fill(dev, (uint32_t)(index + stride * i), num, ra->buffer);
+        }
+        else if (NULL != dev->ops->advise)
+        {
+            dev->ops->advise(dev->ctx, offset, length);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    if ((0 < count) && (0 < num))
+    {
+        range = &ra->ranges[ra->range_next];
+        range->index = index;
+        range->num = num;
+        range->stride = stride;
+        range->count = count;
+
+        ra->range_next = (ra->range_next + 1) % HAL_RA_TRACKED_RANGES;
+
+        ra->stats.prefetches++;
+        ra->stats.prefetched_sectors += (uint64_t)num * count;
+    }
+    else
+    {
+        count = 0;
+    }
+
+    return count;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_readahead_covered.
+* Description: Return 1 if a tracked prefetch holds the whole read.
+*
+END***************************************************************************/
+static uint8_t hal_readahead_covered(const hal_readahead_struct_t *ra, uint32_t index, uint32_t num)
+{
+    const hal_ra_range_struct_t *range = NULL; /*range is the current tracked prefetch*/
+    uint8_t covered = 0;                       /*covered stores the result*/
+    int64_t delta = 0;                         /*delta is the distance from the first prefetched read*/
+    uint32_t i = 0;                            /*i used for traversaling the tracked prefetches*/
+
+    for (i = 0; (i < HAL_RA_TRACKED_RANGES) && (0 == covered); i++)
+    {
+        range = &ra->ranges[i];
+        delta = (int64_t)index - (int64_t)range->index;
+
+        if (0 == range->count)
+        {
+            /*Do nothing*/
+        }
+        else if (0 == range->stride)
+        {
+            covered = ((0 <= delta) && (delta + num <= range->num)) ? 1 : 0;
+        }
+        else
+        {
+            covered = ((0 == delta % range->stride) && (0 <= delta / range->stride) && (delta / range->stride < range->count) && (num <= range->num)) ? 1 : 0;
+        }
+    }
+
+    return covered;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_readahead.
+* Description: Count the read as a hit if it was prefetched, then compare it to
+*              the previous read. While the reads stay sequential (or keep the
+*              same stride) the window doubles each time the prefetched part
+*              ahead of the reads drops under half a window.
+*
+END***************************************************************************/
+static void hal_readahead(kmc_dev_t *dev, uint32_t index, uint32_t num)
+{
+    hal_readahead_struct_t *ra = &dev->ra; /*ra is the readahead engine of the handle*/
+    int64_t delta = 0;                     /*delta is the distance from the previous read*/
+    int64_t ahead = 0;                     /*ahead is the prefetched part ahead of this read*/
+    int64_t last_chunk = 0;                /*last_chunk is the last strided read inside the image range*/
+    uint8_t sequential = 0;                /*sequential tells if the read follows the previous one*/
+    uint8_t strided = 0;                   /*strided tells if the read keeps the previous stride*/
+    uint32_t chunks = 0;                   /*chunks is the number of strided reads in the window*/
+
+    ra->stats.requests++;
+
+    if (1 == hal_readahead_covered(ra, index, num))
+    {
+        ra->stats.hits++;
+    }
+
+    delta = (int64_t)index - (int64_t)ra->last_index;
+    sequential = ((0 != ra->last_num) && (delta == (int64_t)ra->last_num)) ? 1 : 0;
+    strided = ((0 == sequential) && (0 != delta) && (delta == ra->stride)) ? 1 : 0;
+
+    /*A new pattern starts from this read*/
+    if ((sequential != ra->sequential) || ((0 == sequential) && (0 == strided)))
+    {
+        ra->frontier = (1 == sequential) ? (int64_t)index + num : (int64_t)index;
+        ra->stats.window = 0;
+    }
+
+    if (1 == sequential)
+    {
+        if (ra->frontier < (int64_t)index + num)
+        {
+            ra->frontier = (int64_t)index + num;
+        }
+
+        ahead = ra->frontier - ((int64_t)index + num);
+
+        if ((ahead <= (int64_t)(ra->stats.window / 2)) && (ra->frontier <= (int64_t)UINT32_MAX))
+        {
+            ra->stats.window = hal_readahead_grow(dev, num);
+
+            ra->frontier += hal_prefetch(dev, (uint32_t)ra->frontier, ra->stats.window, 0, 1) * (int64_t)ra->stats.window;
+        }
+    }
+    else if (1 == strided)
+    {
+        ahead = (ra->frontier - (int64_t)index) / delta;
+        ahead = (ahead < 0) ? 0 : ahead;
+        chunks = (ra->stats.window / num > 0) ? ra->stats.window / num : 1;
+
+        if (ahead <= (int64_t)(chunks / 2))
+        {
+            ra->stats.window = hal_readahead_grow(dev, num);
+            chunks = (ra->stats.window / num > 0) ? ra->stats.window / num : 1;
+
+            /*Stay inside the sector numbers*/
+            last_chunk = (int64_t)index + delta * chunks;
+
+            while ((chunks > (uint32_t)ahead) && ((last_chunk < 0) || (last_chunk > (int64_t)UINT32_MAX - num)))
+            {
+                chunks--;
+                last_chunk -= delta;
+            }
+
+            /*Prefetch the next strided reads after the ones already prefetched*/
+            if (chunks > (uint32_t)ahead)
+            {
+                ra->frontier = (int64_t)index + delta * (ahead + hal_prefetch(dev, (uint32_t)((int64_t)index + delta * (ahead + 1)), num, delta, chunks - (uint32_t)ahead));
+            }
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    ra->sequential = sequential;
+    ra->stride = delta;
+    ra->last_index = index;
+    ra->last_num = num;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_readahead_grow.
+* Description: Return the next window: twice the read (at least
+*              HAL_RA_INITIAL_WINDOW) when a pattern starts, then double it up to
+*              the maximum window. With a cache the window stays under half of
+*              the cache.
+*
+END***************************************************************************/
+static uint32_t hal_readahead_grow(const kmc_dev_t *dev, uint32_t num)
+{
+    uint64_t window = 0;                            /*window stores the next window*/
+    uint64_t max_window = dev->ra.stats.max_window; /*max_window stores the upper bound of the window*/
+
+    if (HAL_CACHE_ACTIVE(dev) && (max_window > dev->cache.stats.capacity / 2))
+    {
+        max_window = dev->cache.stats.capacity / 2;
+    }
+
+    if (0 == dev->ra.stats.window)
+    {
+        window = ((uint64_t)num * 2 > HAL_RA_INITIAL_WINDOW) ? (uint64_t)num * 2 : HAL_RA_INITIAL_WINDOW;
+    }
+    else
+    {
+        window = (uint64_t)dev->ra.stats.window * 2;
+    }
+
+    if (window > max_window)
+    {
+        window = max_window;
+    }
+
+    return (uint32_t)window;
+}
 
 /*******************************************************************************
  * Functions
  ******************************************************************************/
 
+/*Functions*********************************************************************
+*
+* Function name: kmc_map_sectors.
+* Description: Return a pointer to "num" sectors starting at "index" inside the
+*              image viewed by the backend. Return NULL if the backend can not
+*              view the image in place or the range is out of the image.
+*
+END***************************************************************************/
+const uint8_t *kmc_map_sectors(kmc_dev_t *dev, uint32_t index, uint32_t num)
+{
+    const uint8_t *view = NULL; /*view points to the first byte of the sector range*/
+
+    /*Check if the backend can view the image in place*/
+    if ((NULL != dev) && (NULL != dev->ops->map))
+    {
+        view = dev->ops->map(dev->ctx, (uint64_t)index * dev->sector_size, (size_t)num * dev->sector_size);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return view;
+}
+
 /*Functions*********************************************************************
 *
 * Function name: kmc_read_sector.
 * Description: Read 1 sector in file from the position "index" and store it to buff.
 *
 END***************************************************************************/
-int32_t kmc_read_sector(uint32_t index, uint8_t *buff)
+int32_t kmc_read_sector(kmc_dev_t *dev, uint32_t index, uint8_t *buff)
+{
+    return kmc_read_multi_sector(dev, index, 1, buff);
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_read_multi_sector.
+* Description: Read multiple sector in file from the position "index" and store to buff.
+*
+END***************************************************************************/
+int32_t kmc_read_multi_sector(kmc_dev_t *dev, uint32_t index, uint32_t num, uint8_t *buff)
 {
-    uint32_t bytes_read = 0; /*bytes_read stores the total bytes read successfully*/
+    size_t total_bytes = 0; /*total_bytes stores the num of bytes read successfully*/
+    uint64_t offset = 0;    /*offset stores the byte offset of the first sector*/
 
-    /*Check if file open successfully*/
-    if (NULL != s_file_img)
+    /*Check if the handle is valid*/
+    if (NULL != dev)
     {
-        /*Set the position of the cursor in the file to the index*/
-        fseek(s_file_img, index * s_sector_size, SEEK_SET);
+        offset = (uint64_t)index * dev->sector_size;
+        total_bytes = (size_t)num * dev->sector_size;
 
-        /*Read 1 sector and get the num of bytes read*/
-        bytes_read = fread(buff, 1, s_sector_size, s_file_img);
+        /*Let the readahead engine see the read*/
+        if (0 < dev->ra.stats.max_window)
+        {
+            hal_readahead(dev, index, num);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        /*Serve the sectors from the cache if the handle has one*/
+        if (HAL_CACHE_ACTIVE(dev))
+        {
+            total_bytes = hal_cache_read(dev, index, num, buff);
+        }
+        else
+        {
+            /*Read num of sector at their position and get the total of bytes read*/
+            total_bytes = hal_read_raw(dev, buff, total_bytes, offset);
+        }
     }
     else
     {
         /*Do nothing*/
     }
 
-    return bytes_read;
+    return (int32_t)total_bytes;
 }
 
 /*Functions*********************************************************************
 *
-* Function name: kmc_read_multi_sector.
-* Description: Read multiple sector in file from the position "index" and store to buff.
+* Function name: kmc_read_extents.
+* Description: Read a list of extents into the caller buffers. Each group of
+*              extents that are contiguous on the disk is read with 1 vector
+*              read. Return the total bytes read.
 *
 END***************************************************************************/
-int32_t kmc_read_multi_sector(uint32_t index, uint32_t num, uint8_t *buff)
+int32_t kmc_read_extents(kmc_dev_t *dev, const kmc_extent_struct_t *extents, uint32_t count, const struct iovec *iov)
 {
-    uint32_t total_bytes = 0; /*total_bytes stores the num of bytes read successfully =*/
+    size_t total_bytes = 0; /*total_bytes stores the num of bytes read successfully*/
+    size_t length = 0;      /*length stores the bytes of 1 extent*/
+    size_t run_bytes = 0;   /*run_bytes stores the bytes read for the current run*/
+    size_t i = 0;           /*i used for traversaling the sectors of an extent*/
+    uint64_t offset = 0;    /*offset stores the byte offset of the current run*/
+    uint32_t first = 0;     /*first is the first extent of the current run*/
+    uint32_t last = 0;      /*last is the extent after the current run*/
 
-    /*Check if the file opened succesfully*/
-    if (NULL != s_file_img)
+    /*Check if the handle is valid*/
+    if (NULL != dev)
     {
-        /*Set the cursor position to index*/
-        fseek(s_file_img, index * s_sector_size, SEEK_SET);
+        while (first < count)
+        {
+            /*Grow the run while the next extent starts where the previous one ends
+              and the previous buffer takes the whole extent*/
+            last = first + 1;
+
+            while ((last < count) && ((last - first) < HAL_MAX_IOV) &&
+                   (extents[last].index == extents[last - 1].index + extents[last - 1].num) &&
+                   (iov[last - 1].iov_len == (size_t)extents[last - 1].num * dev->sector_size))
+            {
+                last++;
+            }
+
+            offset = (uint64_t)extents[first].index * dev->sector_size;
+
+            /*Let the readahead engine see the whole run as 1 read*/
+            if (0 < dev->ra.stats.max_window)
+            {
+                hal_readahead(dev, extents[first].index, extents[last - 1].index + extents[last - 1].num - extents[first].index);
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+
+            /*With a cache, the run is read in 1 go only if none of its sectors is cached*/
+            if (HAL_CACHE_ACTIVE(dev) && hal_cache_run_is_cold(dev, &extents[first], last - first))
+            {
+                run_bytes = dev->ops->read(dev->ctx, &iov[first], last - first, offset);
+                total_bytes += run_bytes;
 
-        /*Read num of sector and get the total of bytes read*/
-        total_bytes = fread(buff, 1, num * s_sector_size, s_file_img);
+                /*Cache the whole sectors read, extent by extent*/
+                for (; (first < last) && (0 < run_bytes); first++)
+                {
+                    length = (iov[first].iov_len < run_bytes) ? iov[first].iov_len : run_bytes;
+                    run_bytes -= length;
+
+                    dev->cache.stats.misses += extents[first].num;
+
+                    for (i = 0; (i + 1) * (size_t)dev->sector_size <= length; i++)
+                    {
+                        hal_cache_insert(dev, extents[first].index + i, (uint8_t *)iov[first].iov_base + i * dev->sector_size);
+                    }
+                }
+            }
+            else if (HAL_CACHE_ACTIVE(dev))
+            {
+                for (; first < last; first++)
+                {
+                    /*Whole extents go through the cache, a partial one is read straight*/
+                    if (iov[first].iov_len == (size_t)extents[first].num * dev->sector_size)
+                    {
+                        total_bytes += hal_cache_read(dev, extents[first].index, extents[first].num, (uint8_t *)iov[first].iov_base);
+                    }
+                    else
+                    {
+                        total_bytes += hal_read_raw(dev, (uint8_t *)iov[first].iov_base, iov[first].iov_len, (uint64_t)extents[first].index * dev->sector_size);
+                    }
+                }
+            }
+            else
+            {
+                total_bytes += dev->ops->read(dev->ctx, &iov[first], last - first, offset);
+            }
+
+            first = last;
+        }
     }
     else
     {
         /*Do nothing*/
     }
 
-    return total_bytes;
+    return (int32_t)total_bytes;
 }
 
 /*Functions*********************************************************************
 *
-* Function name: kmc_init.
-* Description: Initial the HAL layer, set sector size to default value(512).
-*              Return a FILE pointer points to the current opened file.
+* Function name: kmc_open.
+* Description: Open the image with the file backend (mmap backend in mmap mode)
+*              and return a new handle with the sector size set to the default
+*              value(512). Return NULL if the image failed to open.
 *
 END***************************************************************************/
-FILE *kmc_init(uint8_t *file_name)
+kmc_dev_t *kmc_open(const uint8_t *file_name, kmc_access_mode_enum_t mode)
 {
-    /*Open the file in "file_name"*/
-    s_file_img = fopen(file_name, "rb+");
+    const kmc_backend_ops_struct_t *ops = NULL; /*ops stores the operations of the backend*/
+    kmc_dev_t *dev = NULL;                      /*dev stores the new handle*/
+    void *ctx = NULL;                           /*ctx stores the state of the backend*/
+
+    ops = hal_backend_open_file(file_name, mode, &ctx);
 
     /*Check if the file opened succesfully*/
-    if (NULL != s_file_img)
+    if (NULL != ops)
+    {
+        dev = kmc_open_backend(ops, ctx);
+
+        if (NULL == dev)
+        {
+            ops->close(ctx);
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return dev;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_open_memory.
+* Description: Wrap the caller buffer with the memory backend and return a new
+*              handle. Return NULL if the handle can not be allocated.
+*
+END***************************************************************************/
+kmc_dev_t *kmc_open_memory(const uint8_t *image, size_t size)
+{
+    const kmc_backend_ops_struct_t *ops = NULL; /*ops stores the operations of the backend*/
+    kmc_dev_t *dev = NULL;                      /*dev stores the new handle*/
+    void *ctx = NULL;                           /*ctx stores the state of the backend*/
+
+    ops = hal_backend_open_memory(image, size, &ctx);
+
+    if (NULL != ops)
+    {
+        dev = kmc_open_backend(ops, ctx);
+
+        if (NULL == dev)
+        {
+            ops->close(ctx);
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return dev;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_open_backend.
+* Description: Return a new handle on the backend with the sector size set to
+*              the default value(512). Return NULL if the backend lacks a
+*              mandatory operation or the handle can not be allocated.
+*
+END***************************************************************************/
+kmc_dev_t *kmc_open_backend(const kmc_backend_ops_struct_t *ops, void *ctx)
+{
+    kmc_dev_t *dev = NULL; /*dev stores the new handle*/
+
+    /*Check if the backend can serve the reads*/
+    if ((NULL != ops) && (NULL != ops->read) && (NULL != ops->get_size))
+    {
+        dev = (kmc_dev_t *)calloc(1, sizeof(kmc_dev_t));
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL != dev)
     {
+        dev->ops = ops;
+        dev->ctx = ctx;
+        dev->refs = 1;
+
         /*Set sector size to default value*/
-        s_sector_size = KMC_DEFAULT_SECTOR_SIZE;
+        dev->sector_size = KMC_DEFAULT_SECTOR_SIZE;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return dev;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_open_region.
+* Description: Clamp the region at the end of the image, wrap it with the
+*              region backend and return a new handle on it.
+*
+END***************************************************************************/
+kmc_dev_t *kmc_open_region(kmc_dev_t *dev, uint64_t base_offset, uint64_t length)
+{
+    const kmc_backend_ops_struct_t *ops = NULL; /*ops stores the operations of the backend*/
+    kmc_dev_t *region = NULL;                   /*region stores the new handle*/
+    void *ctx = NULL;                           /*ctx stores the state of the backend*/
+    uint64_t size = 0;                          /*size stores the size of the whole image*/
+
+    if (NULL != dev)
+    {
+        size = kmc_get_size(dev);
+
+        /*Check if the region starts inside the image*/
+        if (base_offset < size)
+        {
+            if (length > size - base_offset)
+            {
+                length = size - base_offset;
+            }
+
+            ops = hal_backend_open_region(dev, base_offset, length, &ctx);
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL != ops)
+    {
+        region = kmc_open_backend(ops, ctx);
+
+        if (NULL == region)
+        {
+            ops->close(ctx);
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return region;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_get_size.
+* Description: Return the size of the image in bytes.
+*
+END***************************************************************************/
+uint64_t kmc_get_size(kmc_dev_t *dev)
+{
+    uint64_t size = 0; /*size stores the size of the image*/
+
+    if (NULL != dev)
+    {
+        size = dev->ops->get_size(dev->ctx);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return size;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_is_zero_extent.
+* Description: Ask the backend first, a known hole needs no read. Otherwise look
+*              at the view of the range if the backend has one, or read the
+*              range (without the cache) until a non zero byte is found.
+*
+END***************************************************************************/
+uint8_t kmc_is_zero_extent(kmc_dev_t *dev, uint32_t index, uint32_t num)
+{
+    const uint8_t *view = NULL; /*view points to the range viewed in place*/
+    uint8_t *buffer = NULL;     /*buffer receives the sectors read*/
+    uint8_t is_zero = 0;        /*is_zero stores the result*/
+    uint64_t offset = 0;        /*offset stores the byte offset of the range*/
+    uint64_t length = 0;        /*length stores the byte length of the range*/
+    size_t chunk = 0;           /*chunk stores the bytes of 1 read*/
+
+    if ((NULL != dev) && (0 < num))
+    {
+        offset = (uint64_t)index * dev->sector_size;
+        length = (uint64_t)num * dev->sector_size;
+        view = kmc_map_sectors(dev, index, num);
+
+        if ((NULL != dev->ops->is_zero) && (1 == dev->ops->is_zero(dev->ctx, offset, length)))
+        {
+            is_zero = 1;
+        }
+        else if (NULL != view)
+        {
+            is_zero = hal_is_zero(view, (size_t)length);
+        }
+        else
+        {
+            buffer = (uint8_t *)malloc((size_t)HAL_ZERO_SCAN_SECTORS * dev->sector_size);
+            is_zero = (NULL != buffer) ? 1 : 0;
+
+            while ((1 == is_zero) && (0 < length))
+            {
+                chunk = (length < (uint64_t)HAL_ZERO_SCAN_SECTORS * dev->sector_size) ? (size_t)length : (size_t)HAL_ZERO_SCAN_SECTORS * dev->sector_size;
+
+                /*A short read means the range is out of the image*/
+                is_zero = ((chunk == hal_read_raw(dev, buffer, chunk, offset)) && hal_is_zero(buffer, chunk)) ? 1 : 0;
+
+                offset += chunk;
+                length -= chunk;
+            }
+
+            free(buffer);
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return is_zero;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_write_multi_sector.
+* Description: Write multiple sector to the image from the position "index",
+*              then refresh the cached copies of the sectors written. Return
+*              the bytes written, -1 if the backend is read only.
+*
+END***************************************************************************/
+int32_t kmc_write_multi_sector(kmc_dev_t *dev, uint32_t index, uint32_t num, const uint8_t *buff)
+{
+    int32_t total_bytes = -1; /*total_bytes stores the num of bytes written successfully*/
+    int32_t slot = 0;         /*slot is the cache slot of a written sector*/
+    uint32_t i = 0;           /*i used for traversaling the written sectors*/
+
+    /*Check if the backend can write*/
+    if ((NULL != dev) && (NULL != dev->ops->write))
+    {
+        total_bytes = (int32_t)dev->ops->write(dev->ctx, buff, (size_t)num * dev->sector_size, (uint64_t)index * dev->sector_size);
+
+        /*Keep the cache coherent with the image*/
+        if (HAL_CACHE_ACTIVE(dev))
+        {
+            for (i = 0; ((size_t)(i + 1) * dev->sector_size) <= (size_t)total_bytes; i++)
+            {
+                slot = hal_cache_find(&dev->cache, index + i);
+
+                if (0 <= slot)
+                {
+                    memcpy(dev->cache.data + (size_t)slot * dev->sector_size, buff + (size_t)i * dev->sector_size, dev->sector_size);
+                }
+            }
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return total_bytes;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_flush.
+* Description: Flush the written sectors of the image. A backend without flush
+*              has nothing to flush.
+*
+END***************************************************************************/
+int32_t kmc_flush(kmc_dev_t *dev)
+{
+    int32_t result = -1; /*result stores the result of the flush*/
+
+    if (NULL != dev)
+    {
+        result = (NULL != dev->ops->flush) ? dev->ops->flush(dev->ctx) : 0;
     }
     else
     {
         /*Do nothing*/
     }
 
-    return s_file_img;
+    return result;
 }
+
 /*Functions*********************************************************************
 *
 * Function name: kmc_update_sector_size.
@@ -114,32 +1298,165 @@ FILE *kmc_init(uint8_t *file_name)
 *              after updated.
 *
 END***************************************************************************/
-uint32_t kmc_update_sector_size(uint16_t bytes_per_sector)
+uint32_t kmc_update_sector_size(kmc_dev_t *dev, uint16_t bytes_per_sector)
 {
     /*Check if the field bytes per sector is valid*/
     if ((0 < bytes_per_sector) && (0 == (bytes_per_sector % KMC_DEFAULT_SECTOR_SIZE)) && (KMC_DEFAULT_SECTOR_SIZE != bytes_per_sector))
     {
         /*Update the sector size*/
-        s_sector_size = bytes_per_sector;
+        dev->sector_size = bytes_per_sector;
+
+        /*The cached sectors have the old size, rebuild the cache*/
+        if (0 < dev->cache.budget)
+        {
+            hal_cache_setup(dev);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return dev->sector_size;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_cache_enable.
+* Description: Set the memory budget of the sector cache and rebuild it empty.
+*              Return the number of sectors the cache can hold, 0 on a mapped
+*              or in-memory image.
+*
+END***************************************************************************/
+uint32_t kmc_cache_enable(kmc_dev_t *dev, uint32_t budget_bytes)
+{
+    uint32_t capacity = 0; /*capacity stores the number of sectors the cache holds*/
+
+    if (NULL != dev)
+    {
+        dev->cache.budget = budget_bytes;
+
+        hal_cache_setup(dev);
+
+        capacity = dev->cache.stats.capacity;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return capacity;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_get_cache_stats.
+* Description: Copy the counters of the sector cache of the handle to stats.
+*
+END***************************************************************************/
+void kmc_get_cache_stats(kmc_dev_t *dev, kmc_cache_stats_struct_t *stats)
+{
+    if ((NULL != dev) && (NULL != stats))
+    {
+        *stats = dev->cache.stats;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_readahead_enable.
+* Description: Set the maximum window of the readahead engine and restart its
+*              pattern detection. 0 disables readahead.
+*
+END***************************************************************************/
+void kmc_readahead_enable(kmc_dev_t *dev, uint32_t max_window)
+{
+    if (NULL != dev)
+    {
+        free(dev->ra.buffer);
+
+        memset(&dev->ra, 0, sizeof(hal_readahead_struct_t));
+
+        dev->ra.stats.max_window = max_window;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_get_readahead_stats.
+* Description: Copy the counters of the readahead engine of the handle to stats.
+*
+END***************************************************************************/
+void kmc_get_readahead_stats(kmc_dev_t *dev, kmc_readahead_stats_struct_t *stats)
+{
+    if ((NULL != dev) && (NULL != stats))
+    {
+        *stats = dev->ra.stats;
     }
     else
     {
         /*Do nothing*/
     }
 
-    return s_sector_size;
+    return;
 }
 
 /*Functions*********************************************************************
 *
-* Function name: kmc_de_init.
-* Description: De-initial the HAL layer, close the file stream.
+* Function name: kmc_close.
+* Description: Drop 1 reference on the handle. The last reference closes the
+*              backend and frees the handle.
 *
 END***************************************************************************/
-void kmc_de_init(void)
+void kmc_close(kmc_dev_t *dev)
 {
-    /*Close the file*/
-    fclose(s_file_img);
+    /*A region still reads through the handle, it is closed with the region*/
+    if ((NULL != dev) && (1 < dev->refs))
+    {
+        dev->refs--;
+
+        /*The cached sectors are not needed by the regions*/
+        hal_cache_free(&dev->cache);
+        dev->cache.budget = 0;
+    }
+    else if (NULL != dev)
+    {
+        /*Free the sector cache and the readahead buffer*/
+        hal_cache_free(&dev->cache);
+        free(dev->ra.buffer);
+
+        /*Close the backend*/
+        if (NULL != dev->ops->close)
+        {
+            dev->ops->close(dev->ctx);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        free(dev);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
 
     return;
 }
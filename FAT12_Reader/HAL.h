@@ -13,7 +13,11 @@
  ******************************************************************************/
 
 #include <stdint.h>
-#include <stdio.h>
+#include <stddef.h>
+
+#if !defined(_WIN32)
+#include <sys/uio.h>
+#endif
 
 /*******************************************************************************
  * Header guard
@@ -28,6 +32,89 @@
 
 #define KMC_DEFAULT_SECTOR_SIZE 512
 
+/*******************************************************************************
+ * Enum
+ ******************************************************************************/
+
+typedef enum kmc_access_mode
+{
+    KMC_ACCESS_PREAD,
+    KMC_ACCESS_MMAP
+} kmc_access_mode_enum_t;
+
+/*******************************************************************************
+ * Typedef
+ ******************************************************************************/
+
+/*Opaque handle of an opened disk image, every read goes through a handle*/
+typedef struct kmc_dev kmc_dev_t;
+
+#if defined(_WIN32)
+/*Same layout as the POSIX struct iovec*/
+struct iovec
+{
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
+
+/*******************************************************************************
+ * Struct
+ ******************************************************************************/
+
+/*Counters of the sector cache of 1 handle*/
+typedef struct kmc_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint32_t capacity;
+    uint32_t used;
+} kmc_cache_stats_struct_t;
+
+/*Counters of the readahead engine of 1 handle*/
+typedef struct kmc_readahead_stats
+{
+    uint64_t requests;           /*reads seen by the engine*/
+    uint64_t hits;               /*reads that were entirely prefetched before*/
+    uint64_t prefetches;         /*prefetch operations issued*/
+    uint64_t prefetched_sectors; /*sectors covered by the prefetch operations*/
+    uint32_t window;             /*current window in sectors, 0 if no pattern is detected*/
+    uint32_t max_window;         /*upper bound of the window in sectors*/
+} kmc_readahead_stats_struct_t;
+
+/*Operations of an image backend, "ctx" is the state given to kmc_open_backend.
+  read and get_size are mandatory, the other operations may be NULL*/
+typedef struct kmc_backend_ops
+{
+    /*Read consecutive bytes at byte "offset" into the buffers in order, return the bytes read*/
+    size_t (*read)(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+    /*Return the size of the image in bytes*/
+    uint64_t (*get_size)(void *ctx);
+    /*Write "length" bytes at byte "offset", return the bytes written (NULL: read only image)*/
+    size_t (*write)(void *ctx, const uint8_t *buff, size_t length, uint64_t offset);
+    /*Make the written bytes durable, return 0 on success*/
+    int32_t (*flush)(void *ctx);
+    /*Return a read only view of a byte range, NULL if the range can not be viewed in place*/
+    const uint8_t *(*map)(void *ctx, uint64_t offset, size_t length);
+    /*Hint that a byte range will be read soon*/
+    void (*advise)(void *ctx, uint64_t offset, uint64_t length);
+    /*Return a descriptor usable for asynchronous positional reads, -1 if there is none, and store
+      the byte offset of the image inside that descriptor in base_offset*/
+    int (*get_fd)(void *ctx, uint64_t *base_offset);
+    /*Release the backend state*/
+    void (*close)(void *ctx);
+    /*Return 1 if the byte range is known to be all zero without reading it (a hole), 0 otherwise*/
+    uint8_t (*is_zero)(void *ctx, uint64_t offset, uint64_t length);
+} kmc_backend_ops_struct_t;
+
+/*A run of "num" physically contiguous sectors starting at sector "index"*/
+typedef struct kmc_extent
+{
+    uint32_t index;
+    uint32_t num;
+} kmc_extent_struct_t;
+
 /*******************************************************************************
  * Variable
  ******************************************************************************/
@@ -39,51 +126,215 @@
 /**
  * @brief Read a sector in the disk image starting with the "index" position and store it to buffer.
  *
+ * @param dev the handle of the disk image.
  * @param index the position to read in the disk image.
  * @param buff the buffer that stores the sector.
  *
  * @return the number of bytes read succesfully.
  */
-int32_t kmc_read_sector(uint32_t index, uint8_t *buff);
+int32_t kmc_read_sector(kmc_dev_t *dev, uint32_t index, uint8_t *buff);
 
 
 /**
  * @brief Read multiple sector in the disk image starting with the index position and store it to buffer.
  *
+ * @param dev the handle of the disk image.
  * @param index the position to read in the disk image.
  * @param num the amount of sector to read.
  * @param buff a buffer that stores the sectors.
  *
  * @return: the number of bytes read succesfully.
  */
-int32_t kmc_read_multi_sector(uint32_t index, uint32_t num, uint8_t *buff);
+int32_t kmc_read_multi_sector(kmc_dev_t *dev, uint32_t index, uint32_t num, uint8_t *buff);
+
+/**
+ * @brief Read a list of sector extents into caller-provided buffers. Extents that follow each other
+ *        on the disk are merged and read with a single positional vector read (preadv).
+ *
+ * @param dev the handle of the disk image.
+ * @param extents the list of extents to read, in the order of the buffers.
+ * @param count the number of extents (and buffers).
+ * @param iov the buffers, iov[i] receives the first iov[i].iov_len bytes of extents[i].
+ *
+ * @return the total number of bytes read succesfully.
+ */
+int32_t kmc_read_extents(kmc_dev_t *dev, const kmc_extent_struct_t *extents, uint32_t count, const struct iovec *iov);
 
 /**
- * @brief Open the disk image and set the size of sector to the default value (512).
+ * @brief Open the disk image with the requested access mode and set the size of sector to the
+ *        default value (512). Reads use positional I/O, so several handles can be used at once
+ *        from different threads. In KMC_ACCESS_MMAP mode the whole image is mapped once; if the
+ *        mapping fails the handle falls back to positional reads. The image is opened for
+ *        writing when the file allows it, read only otherwise. The holes of a sparse image are
+ *        found once (SEEK_DATA/SEEK_HOLE) and reads inside them are answered without I/O.
  *
  * @param file_name the name of the image.
+ * @param mode the access mode (KMC_ACCESS_PREAD/KMC_ACCESS_MMAP).
+ *
+ * @return the handle of the disk image, NULL if it failed to open.
+ */
+kmc_dev_t *kmc_open(const uint8_t *file_name, kmc_access_mode_enum_t mode);
+
+/**
+ * @brief Open a disk image served by a caller-provided backend. The handle owns "ctx" once it is
+ *        opened: kmc_close calls ops->close.
+ *
+ * @param ops the operations of the backend, must stay valid until kmc_close.
+ * @param ctx the state of the backend passed to every operation.
+ *
+ * @return the handle of the disk image, NULL if ops lacks read/get_size or the handle can not be
+ *         allocated (ctx is then left to the caller).
+ */
+kmc_dev_t *kmc_open_backend(const kmc_backend_ops_struct_t *ops, void *ctx);
+
+/**
+ * @brief Open a disk image that is already in memory. Reads are plain copies and kmc_map_sectors
+ *        returns views into the buffer, no I/O is done at all. The image is read only.
+ *
+ * @param image the content of the image, must stay valid until kmc_close (it is not copied).
+ * @param size the size of the image in bytes.
+ *
+ * @return the handle of the disk image, NULL if it failed to open.
+ */
+kmc_dev_t *kmc_open_memory(const uint8_t *image, size_t size);
+
+/**
+ * @brief Open a volume that starts partway into the image of another handle, for example a
+ *        partition of a whole-disk image. Sector 0 of the new handle is the byte "base_offset" of
+ *        the image and reads stop at "length" bytes. The new handle shares the backend of "dev"
+ *        (reference counted) but has its own sector size, cache and readahead; "dev" may be closed
+ *        before it.
+ *
+ * @param dev the handle of the whole image.
+ * @param base_offset the byte offset of the volume in the image.
+ * @param length the byte length of the volume, clamped at the end of the image.
+ *
+ * @return the handle of the volume, NULL if the volume starts after the end of the image or the
+ *         handle can not be allocated.
+ */
+kmc_dev_t *kmc_open_region(kmc_dev_t *dev, uint64_t base_offset, uint64_t length);
+
+/**
+ * @brief Get the size of the disk image.
+ *
+ * @param dev the handle of the disk image.
  *
- * @return the FILE pointer points to the file/disk image.
+ * @return the size of the image in bytes, 0 if the handle is NULL.
  */
-FILE *kmc_init(uint8_t *file_name);
+uint64_t kmc_get_size(kmc_dev_t *dev);
+
+/**
+ * @brief Get a read-only view of "num" sectors starting at "index" directly inside the mapped image.
+ *
+ * @param dev the handle of the disk image.
+ * @param index the position of the first sector in the disk image.
+ * @param num the amount of sector in the view.
+ *
+ * @return pointer to the first byte of the sector range, NULL if the backend can not view the
+ *         image in place (not mapped) or the range is out of the image.
+ */
+const uint8_t *kmc_map_sectors(kmc_dev_t *dev, uint32_t index, uint32_t num);
+
+/**
+ * @brief Tell if "num" sectors starting at "index" are all zero. Ranges the backend knows to be
+ *        holes (sparse file holes, zero chunks of a compressed image) are answered without reading
+ *        the image, the other ranges are read and checked.
+ *
+ * @param dev the handle of the disk image.
+ * @param index the position of the first sector in the disk image.
+ * @param num the amount of sector to check.
+ *
+ * @return 1 if every byte of the sectors is zero, 0 otherwise (or if the range is out of the image).
+ */
+uint8_t kmc_is_zero_extent(kmc_dev_t *dev, uint32_t index, uint32_t num);
+
+/**
+ * @brief Write multiple sector to the disk image starting with the index position. The cached copies
+ *        of the written sectors are refreshed.
+ *
+ * @param dev the handle of the disk image.
+ * @param index the position to write in the disk image.
+ * @param num the amount of sector to write.
+ * @param buff a buffer that stores the sectors.
+ *
+ * @return the number of bytes written succesfully, -1 if the image is read only.
+ */
+int32_t kmc_write_multi_sector(kmc_dev_t *dev, uint32_t index, uint32_t num, const uint8_t *buff);
+
+/**
+ * @brief Make the sectors written to the disk image durable.
+ *
+ * @param dev the handle of the disk image.
+ *
+ * @return 0 on success (or if the backend has nothing to flush), -1 on error.
+ */
+int32_t kmc_flush(kmc_dev_t *dev);
 
 /**
  * @brief Update size of the sector.
  *
+ * @param dev the handle of the disk image.
  * @param byte_per_sector the total bytes in 1 sector.
  *
  * @return return the size of sector after updated.
  */
-uint32_t kmc_update_sector_size(uint16_t bytes_per_sector);
+uint32_t kmc_update_sector_size(kmc_dev_t *dev, uint16_t bytes_per_sector);
+
+/**
+ * @brief Enable (or resize) the sector cache of a handle. Cached sectors are served by
+ *        kmc_read_sector/kmc_read_multi_sector/kmc_read_extents without touching the image,
+ *        the least recently referenced ones are evicted (CLOCK) once the budget is full.
+ *        No cache is allocated on a mapped or in-memory image. A handle with a cache must not be
+ *        used by several threads at once.
+ *
+ * @param dev the handle of the disk image.
+ * @param budget_bytes the memory budget of the cached sectors, 0 disables the cache.
+ *
+ * @return the number of sectors the cache can hold, 0 on a mapped or in-memory image.
+ */
+uint32_t kmc_cache_enable(kmc_dev_t *dev, uint32_t budget_bytes);
+
+/**
+ * @brief Get the hit/miss/eviction counters of the sector cache of a handle.
+ *
+ * @param dev the handle of the disk image.
+ * @param stats stores the counters.
+ *
+ * @return: This function return nothing
+ */
+void kmc_get_cache_stats(kmc_dev_t *dev, kmc_cache_stats_struct_t *stats);
+
+/**
+ * @brief Enable the readahead engine of a handle. It watches the reads for sequential or strided
+ *        patterns and prefetches a window that doubles while the pattern holds: into the sector cache
+ *        if the handle has one, with posix_fadvise(WILLNEED)/posix_madvise(WILLNEED) otherwise.
+ *
+ * @param dev the handle of the disk image.
+ * @param max_window the upper bound of the window in sectors, 0 disables readahead.
+ *
+ * @return: This function return nothing
+ */
+void kmc_readahead_enable(kmc_dev_t *dev, uint32_t max_window);
+
+/**
+ * @brief Get the window and the hit counters of the readahead engine of a handle.
+ *
+ * @param dev the handle of the disk image.
+ * @param stats stores the counters.
+ *
+ * @return: This function return nothing
+ */
+void kmc_get_readahead_stats(kmc_dev_t *dev, kmc_readahead_stats_struct_t *stats);
 
 /**
- * @brief Close the current stream.
+ * @brief Close the disk image and free the handle. The backend is closed once the last handle
+ *        sharing it (see kmc_open_region) is closed.
  *
- * @param: This function has no param.
+ * @param dev the handle of the disk image.
  *
  * @return: This function return nothing
  */
-void kmc_de_init(void);
+void kmc_close(kmc_dev_t *dev);
 
 /*Header guard*/
 #endif
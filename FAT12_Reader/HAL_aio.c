@@ -0,0 +1,684 @@
+/**
+ * @file  : HAL_aio.c
+ * @author: Nguyen The Anh.
+ * @brief : Definition of function using in file HAL_aio.c
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+/*syscall() and MAP_POPULATE are GNU extensions*/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "HAL.h"
+#include "HAL_priv.h"
+#include "HAL_aio.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAL_AIO_HAVE_URING 1
+#endif
+#endif
+
+#if defined(HAL_AIO_HAVE_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*******************************************************************************
+ * Enum
+ ******************************************************************************/
+
+typedef enum hal_aio_state
+{
+    HAL_AIO_FREE,
+    HAL_AIO_QUEUED,
+    HAL_AIO_IN_FLIGHT,
+    HAL_AIO_DONE
+} hal_aio_state_enum_t;
+
+/*******************************************************************************
+ * Struct
+ ******************************************************************************/
+
+typedef struct hal_aio_request
+{
+    uint32_t index;                 /*index is the first sector to read*/
+    uint32_t num;                   /*num is the amount of sector to read*/
+    struct iovec iov;               /*iov is the destination buffer*/
+    callback_aio_complete callback; /*callback is called at completion*/
+    void *user_data;                /*user_data is passed back to the callback*/
+    int32_t result;                 /*result stores the bytes read (fallback mode)*/
+    hal_aio_state_enum_t state;     /*state stores the state of the request*/
+} hal_aio_request_struct_t;
+
+#if defined(HAL_AIO_HAVE_URING)
+typedef struct hal_uring
+{
+    int ring_fd;                  /*ring_fd is the descriptor of the io_uring instance*/
+    uint8_t *sq_ring;             /*sq_ring is the mapping of the submission ring*/
+    uint8_t *cq_ring;             /*cq_ring is the mapping of the completion ring*/
+    size_t sq_ring_size;          /*sq_ring_size is the size of the submission ring mapping*/
+    size_t cq_ring_size;          /*cq_ring_size is the size of the completion ring mapping*/
+    struct io_uring_sqe *sqes;    /*sqes is the array of submission entries*/
+    size_t sqes_size;             /*sqes_size is the size of the submission entries mapping*/
+    uint32_t *sq_head;            /*sq_head is the head of the submission ring (kernel side)*/
+    uint32_t *sq_tail;            /*sq_tail is the tail of the submission ring (our side)*/
+    uint32_t *sq_mask;            /*sq_mask is the index mask of the submission ring*/
+    uint32_t *sq_array;           /*sq_array maps ring slots to submission entries*/
+    uint32_t *cq_head;            /*cq_head is the head of the completion ring (our side)*/
+    uint32_t *cq_tail;            /*cq_tail is the tail of the completion ring (kernel side)*/
+    uint32_t *cq_mask;            /*cq_mask is the index mask of the completion ring*/
+    struct io_uring_cqe *cqes;    /*cqes is the array of completion entries*/
+} hal_uring_struct_t;
+#endif
+
+struct kmc_aio
+{
+    kmc_dev_t *dev;                     /*dev is the handle the requests read from*/
+    int fd;                             /*fd is the descriptor given by the backend, -1 if there is none*/
+    uint64_t base;                      /*base is the byte offset of the image inside fd*/
+    uint32_t depth;                     /*depth is the number of request slots*/
+    hal_aio_request_struct_t *requests; /*requests stores the request slots*/
+    uint32_t *queued;                   /*queued stores the slots waiting for submit, in order*/
+    uint32_t queued_count;              /*queued_count is the number of slots in queued*/
+    uint32_t in_flight;                 /*in_flight is the number of submitted, not reported slots*/
+    uint8_t is_async;                   /*is_async tells if io_uring is used*/
+#if defined(HAL_AIO_HAVE_URING)
+    hal_uring_struct_t ring;            /*ring is the io_uring instance*/
+#endif
+};
+
+/*******************************************************************************
+ * Static function prototype
+ ******************************************************************************/
+
+#if defined(HAL_AIO_HAVE_URING)
+/**
+ * @brief Set up an io_uring instance with "depth" entries and map its rings.
+ *
+ * @param ring stores the instance.
+ * @param depth the number of entries.
+ *
+ * @return 0 if io_uring is usable, -1 otherwise.
+ */
+static int32_t hal_uring_setup(hal_uring_struct_t *ring, uint32_t depth);
+
+/**
+ * @brief Unmap the rings and close the io_uring instance.
+ *
+ * @param ring the instance.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_uring_release(hal_uring_struct_t *ring);
+
+/**
+ * @brief Reap the completion ring, call the callbacks and free the slots.
+ *
+ * @param aio the queue.
+ *
+ * @return the number of completions reaped.
+ */
+static int32_t hal_uring_reap(kmc_aio_t *aio);
+#endif
+
+/**
+ * @brief Serve the queued requests with blocking reads (no io_uring).
+ *
+ * @param aio the queue.
+ *
+ * @return the number of requests served.
+ */
+static int32_t hal_aio_submit_blocking(kmc_aio_t *aio);
+
+/**
+ * @brief Report the requests served by the blocking fallback.
+ *
+ * @param aio the queue.
+ *
+ * @return the number of completions reported.
+ */
+static int32_t hal_aio_reap_blocking(kmc_aio_t *aio);
+
+/*******************************************************************************
+ * Static functions
+ ******************************************************************************/
+
+#if defined(HAL_AIO_HAVE_URING)
+/*Static functions*************************************************************
+*
+* Function name: hal_uring_setup.
+* Description: Create the io_uring instance with the raw system calls and map
+*              the submission ring, the completion ring and the entries.
+*
+END***************************************************************************/
+static int32_t hal_uring_setup(hal_uring_struct_t *ring, uint32_t depth)
+{
+    struct io_uring_params params; /*params stores the parameters filled by the kernel*/
+    int32_t status = -1;           /*status stores the result*/
+
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(hal_uring_struct_t));
+
+    ring->ring_fd = (int)syscall(__NR_io_uring_setup, depth, &params);
+
+    if (0 <= ring->ring_fd)
+    {
+        ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+        /*Both rings share 1 mapping on recent kernels*/
+        if (0 != (params.features & IORING_FEAT_SINGLE_MMAP))
+        {
+            if (ring->cq_ring_size > ring->sq_ring_size)
+            {
+                ring->sq_ring_size = ring->cq_ring_size;
+            }
+
+            ring->cq_ring_size = 0;
+        }
+
+        ring->sq_ring = (uint8_t *)mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+
+        if (0 == ring->cq_ring_size)
+        {
+            ring->cq_ring = ring->sq_ring;
+        }
+        else
+        {
+            ring->cq_ring = (uint8_t *)mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+        }
+
+        ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+
+        if ((MAP_FAILED == (void *)ring->sq_ring) || (MAP_FAILED == (void *)ring->cq_ring) || (MAP_FAILED == (void *)ring->sqes))
+        {
+            hal_uring_release(ring);
+        }
+        else
+        {
+            ring->sq_head = (uint32_t *)(ring->sq_ring + params.sq_off.head);
+            ring->sq_tail = (uint32_t *)(ring->sq_ring + params.sq_off.tail);
+            ring->sq_mask = (uint32_t *)(ring->sq_ring + params.sq_off.ring_mask);
+            ring->sq_array = (uint32_t *)(ring->sq_ring + params.sq_off.array);
+            ring->cq_head = (uint32_t *)(ring->cq_ring + params.cq_off.head);
+            ring->cq_tail = (uint32_t *)(ring->cq_ring + params.cq_off.tail);
+            ring->cq_mask = (uint32_t *)(ring->cq_ring + params.cq_off.ring_mask);
+            ring->cqes = (struct io_uring_cqe *)(ring->cq_ring + params.cq_off.cqes);
+
+            status = 0;
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return status;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_uring_release.
+* Description: Unmap whatever part of the rings is mapped and close the ring.
+*
+END***************************************************************************/
+static void hal_uring_release(hal_uring_struct_t *ring)
+{
+    if ((NULL != ring->sqes) && (MAP_FAILED != (void *)ring->sqes))
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+
+    if ((0 != ring->cq_ring_size) && (NULL != ring->cq_ring) && (MAP_FAILED != (void *)ring->cq_ring))
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+
+    if ((NULL != ring->sq_ring) && (MAP_FAILED != (void *)ring->sq_ring))
+    {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+
+    if (0 <= ring->ring_fd)
+    {
+        close(ring->ring_fd);
+    }
+
+    memset(ring, 0, sizeof(hal_uring_struct_t));
+    ring->ring_fd = -1;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_uring_reap.
+* Description: Walk the completion ring from our head to the kernel tail, call
+*              the callback of each request and give its slot back.
+*
+END***************************************************************************/
+static int32_t hal_uring_reap(kmc_aio_t *aio)
+{
+    hal_uring_struct_t *ring = &aio->ring;     /*ring is the io_uring instance*/
+    hal_aio_request_struct_t *request = NULL;  /*request is the completed request*/
+    struct io_uring_cqe *cqe = NULL;           /*cqe is the current completion entry*/
+    uint32_t head = 0;                         /*head is our position in the completion ring*/
+    int32_t completed = 0;                     /*completed stores the number of completions reaped*/
+
+    head = *ring->cq_head;
+
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        cqe = &ring->cqes[head & *ring->cq_mask];
+        request = &aio->requests[cqe->user_data];
+
+        request->state = HAL_AIO_FREE;
+        aio->in_flight--;
+        completed++;
+
+        if (NULL != request->callback)
+        {
+            request->callback(request->user_data, (uint8_t *)request->iov.iov_base, cqe->res);
+        }
+
+        head++;
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    return completed;
+}
+#endif
+
+/*Static functions*************************************************************
+*
+* Function name: hal_aio_submit_blocking.
+* Description: Read every queued request now with the synchronous HAL and keep
+*              the results for the next poll.
+*
+END***************************************************************************/
+static int32_t hal_aio_submit_blocking(kmc_aio_t *aio)
+{
+    hal_aio_request_struct_t *request = NULL; /*request is the current request*/
+    uint32_t i = 0;                           /*i used for traversaling the queued requests*/
+
+    for (i = 0; i < aio->queued_count; i++)
+    {
+        request = &aio->requests[aio->queued[i]];
+
+        request->result = kmc_read_multi_sector(aio->dev, request->index, request->num, (uint8_t *)request->iov.iov_base);
+        request->state = HAL_AIO_DONE;
+    }
+
+    return (int32_t)aio->queued_count;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_aio_reap_blocking.
+* Description: Report the requests already served by the blocking fallback.
+*
+END***************************************************************************/
+static int32_t hal_aio_reap_blocking(kmc_aio_t *aio)
+{
+    hal_aio_request_struct_t *request = NULL; /*request is the current request*/
+    uint32_t i = 0;                           /*i used for traversaling the request slots*/
+    int32_t completed = 0;                    /*completed stores the number of completions reported*/
+
+    for (i = 0; i < aio->depth; i++)
+    {
+        request = &aio->requests[i];
+
+        if (HAL_AIO_DONE == request->state)
+        {
+            request->state = HAL_AIO_FREE;
+            aio->in_flight--;
+            completed++;
+
+            if (NULL != request->callback)
+            {
+                request->callback(request->user_data, (uint8_t *)request->iov.iov_base, request->result);
+            }
+        }
+    }
+
+    return completed;
+}
+
+/*******************************************************************************
+ * Functions
+ ******************************************************************************/
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_aio_create.
+* Description: Allocate the request slots and try to set up io_uring. Handles
+*              whose backend has no descriptor and non-Linux handles use the
+*              blocking fallback.
+*
+END***************************************************************************/
+kmc_aio_t *kmc_aio_create(kmc_dev_t *dev, uint32_t queue_depth)
+{
+    kmc_aio_t *aio = NULL; /*aio stores the new queue*/
+
+    if (0 == queue_depth)
+    {
+        queue_depth = KMC_AIO_DEFAULT_DEPTH;
+    }
+
+    if (NULL != dev)
+    {
+        aio = (kmc_aio_t *)calloc(1, sizeof(kmc_aio_t));
+    }
+
+    if (NULL != aio)
+    {
+        aio->dev = dev;
+        aio->fd = (NULL != dev->ops->get_fd) ? dev->ops->get_fd(dev->ctx, &aio->base) : -1;
+        aio->depth = queue_depth;
+        aio->requests = (hal_aio_request_struct_t *)calloc(queue_depth, sizeof(hal_aio_request_struct_t));
+        aio->queued = (uint32_t *)malloc(sizeof(uint32_t) * queue_depth);
+
+        if ((NULL == aio->requests) || (NULL == aio->queued))
+        {
+            free(aio->requests);
+            free(aio->queued);
+            free(aio);
+            aio = NULL;
+        }
+#if defined(HAL_AIO_HAVE_URING)
+        /*Only a backend with a descriptor can be read by the kernel (not a mapped or in-memory image)*/
+        else if ((0 <= aio->fd) && (0 == hal_uring_setup(&aio->ring, queue_depth)))
+        {
+            aio->is_async = 1;
+        }
+#endif
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    return aio;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_aio_queue.
+* Description: Take a free slot and append it to the queued requests.
+*
+END***************************************************************************/
+int32_t kmc_aio_queue(kmc_aio_t *aio, uint32_t index, uint32_t num, uint8_t *buff, callback_aio_complete callback, void *user_data)
+{
+    hal_aio_request_struct_t *request = NULL; /*request is the slot of the new request*/
+    int32_t status = -1;                      /*status stores the result*/
+    uint64_t size = 0;                        /*size stores the size of the image*/
+    uint64_t offset = 0;                      /*offset stores the byte offset of the read*/
+    uint32_t i = 0;                           /*i used for finding a free slot*/
+
+    if ((NULL != aio) && ((aio->queued_count + aio->in_flight) < aio->depth))
+    {
+        while (HAL_AIO_FREE != aio->requests[i].state)
+        {
+            i++;
+        }
+
+        request = &aio->requests[i];
+        request->index = index;
+        request->num = num;
+        request->iov.iov_base = buff;
+        request->iov.iov_len = (size_t)num * aio->dev->sector_size;
+
+        /*The kernel reads past the end of a region, stop the read at its end*/
+        size = kmc_get_size(aio->dev);
+        offset = (uint64_t)index * aio->dev->sector_size;
+
+        if (offset >= size)
+        {
+            request->iov.iov_len = 0;
+        }
+        else if (request->iov.iov_len > size - offset)
+        {
+            request->iov.iov_len = (size_t)(size - offset);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+        request->callback = callback;
+        request->user_data = user_data;
+        request->result = 0;
+        request->state = HAL_AIO_QUEUED;
+
+        aio->queued[aio->queued_count++] = i;
+
+        status = 0;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return status;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_aio_submit.
+* Description: Put every queued request in the submission ring and hand them to
+*              the kernel with 1 io_uring_enter call.
+*
+END***************************************************************************/
+int32_t kmc_aio_submit(kmc_aio_t *aio)
+{
+    int32_t submitted = 0; /*submitted stores the number of requests submitted*/
+
+    if (NULL == aio)
+    {
+        submitted = -EINVAL;
+    }
+#if defined(HAL_AIO_HAVE_URING)
+    else if (1 == aio->is_async)
+    {
+        hal_uring_struct_t *ring = &aio->ring;     /*ring is the io_uring instance*/
+        hal_aio_request_struct_t *request = NULL;  /*request is the current request*/
+        struct io_uring_sqe *sqe = NULL;           /*sqe is the current submission entry*/
+        uint32_t tail = *ring->sq_tail;            /*tail is our position in the submission ring*/
+        uint32_t slot = 0;                         /*slot is the ring slot of the current entry*/
+        uint32_t i = 0;                            /*i used for traversaling the queued requests*/
+        uint32_t remaining = 0;                    /*remaining stores the entries not taken by the kernel yet*/
+        int ret = 0;                               /*ret stores the result of io_uring_enter*/
+
+        for (i = 0; i < aio->queued_count; i++)
+        {
+            request = &aio->requests[aio->queued[i]];
+            slot = tail & *ring->sq_mask;
+            sqe = &ring->sqes[slot];
+
+            memset(sqe, 0, sizeof(struct io_uring_sqe));
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = aio->fd;
+            sqe->off = aio->base + (uint64_t)request->index * aio->dev->sector_size;
+            sqe->addr = (uint64_t)(uintptr_t)&request->iov;
+            sqe->len = 1;
+            sqe->user_data = aio->queued[i];
+
+            ring->sq_array[slot] = slot;
+            request->state = HAL_AIO_IN_FLIGHT;
+            tail++;
+        }
+
+        __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+        /*Hand the whole batch to the kernel, retry if it takes only a part of it*/
+        remaining = aio->queued_count;
+
+        while (0 < remaining)
+        {
+            ret = (int)syscall(__NR_io_uring_enter, ring->ring_fd, remaining, 0, 0, NULL, 0);
+
+            if ((ret < 0) && (EINTR == errno))
+            {
+                continue;
+            }
+            else if (ret <= 0)
+            {
+                submitted = (ret < 0) ? -errno : -EAGAIN;
+                break;
+            }
+            else
+            {
+                remaining -= (uint32_t)ret;
+            }
+        }
+
+        /*Take back the entries the kernel did not consume, they stay queued*/
+        if (0 < remaining)
+        {
+            __atomic_store_n(ring->sq_tail, tail - remaining, __ATOMIC_RELEASE);
+
+            for (i = 0; i < remaining; i++)
+            {
+                aio->queued[i] = aio->queued[aio->queued_count - remaining + i];
+                aio->requests[aio->queued[i]].state = HAL_AIO_QUEUED;
+            }
+        }
+        else
+        {
+            submitted = (int32_t)aio->queued_count;
+        }
+
+        aio->in_flight += aio->queued_count - remaining;
+        aio->queued_count = remaining;
+    }
+#endif
+    else
+    {
+        submitted = hal_aio_submit_blocking(aio);
+        aio->in_flight += aio->queued_count;
+        aio->queued_count = 0;
+    }
+
+    return submitted;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_aio_poll.
+* Description: Reap the completions, wait for at least min_complete of them if
+*              asked, and call the callbacks. Return the number reaped.
+*
+END***************************************************************************/
+int32_t kmc_aio_poll(kmc_aio_t *aio, uint32_t min_complete)
+{
+    int32_t completed = 0; /*completed stores the number of completions reported*/
+
+    if (NULL == aio)
+    {
+        /*Do nothing*/
+    }
+#if defined(HAL_AIO_HAVE_URING)
+    else if (1 == aio->is_async)
+    {
+        uint32_t wanted = 0; /*wanted stores the completions still to wait for*/
+
+        if (min_complete > aio->in_flight)
+        {
+            min_complete = aio->in_flight;
+        }
+
+        completed = hal_uring_reap(aio);
+
+        while ((uint32_t)completed < min_complete)
+        {
+            wanted = min_complete - (uint32_t)completed;
+
+            if ((syscall(__NR_io_uring_enter, aio->ring.ring_fd, 0, wanted, IORING_ENTER_GETEVENTS, NULL, 0) < 0) && (EINTR != errno))
+            {
+                break;
+            }
+
+            completed += hal_uring_reap(aio);
+        }
+    }
+#endif
+    else
+    {
+        /*Every submitted request is already served*/
+        (void)min_complete;
+        completed = hal_aio_reap_blocking(aio);
+    }
+
+    return completed;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_aio_in_flight.
+* Description: Return the number of requests submitted and not yet reported.
+*
+END***************************************************************************/
+uint32_t kmc_aio_in_flight(kmc_aio_t *aio)
+{
+    return (NULL != aio) ? aio->in_flight : 0;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_aio_is_async.
+* Description: Return 1 if the queue runs on io_uring.
+*
+END***************************************************************************/
+uint8_t kmc_aio_is_async(kmc_aio_t *aio)
+{
+    return (NULL != aio) ? aio->is_async : 0;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_aio_destroy.
+* Description: Drain the requests in flight (their callbacks are called), then
+*              release io_uring and free the queue.
+*
+END***************************************************************************/
+void kmc_aio_destroy(kmc_aio_t *aio)
+{
+    if (NULL != aio)
+    {
+        /*The kernel may still write into the buffers of the requests in flight*/
+        kmc_aio_poll(aio, aio->in_flight);
+
+#if defined(HAL_AIO_HAVE_URING)
+        if (1 == aio->is_async)
+        {
+            hal_uring_release(&aio->ring);
+        }
+#endif
+
+        free(aio->requests);
+        free(aio->queued);
+        free(aio);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+/*End of file*/
@@ -0,0 +1,123 @@
+/**
+ * @file  : HAL_aio.h
+ * @author: Nguyen The Anh.
+ * @brief : Declare struct, typedef and function using in HAL_aio.c.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdint.h>
+#include "HAL.h"
+
+/*******************************************************************************
+ * Header guard
+ ******************************************************************************/
+
+#ifndef _HAL_AIO_H_
+#define _HAL_AIO_H_
+
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+#define KMC_AIO_DEFAULT_DEPTH 64
+
+/*******************************************************************************
+ * Typedef
+ ******************************************************************************/
+
+/*Opaque asynchronous read queue bound to 1 disk image handle*/
+typedef struct kmc_aio kmc_aio_t;
+
+/*******************************************************************************
+ * Typedef callback function
+ ******************************************************************************/
+
+/*Called once per completed request, bytes_read is negative (-errno) on error*/
+typedef void (*callback_aio_complete)(void *user_data, uint8_t *buff, int32_t bytes_read);
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Create an asynchronous read queue on a disk image handle. io_uring is used when the kernel
+ *        provides it and the backend of the handle has a descriptor (get_fd), otherwise the requests
+ *        are served with blocking reads at submit time and reported by the next poll.
+ *
+ * @param dev the handle of the disk image.
+ * @param queue_depth the maximum number of requests queued or in flight (0 uses KMC_AIO_DEFAULT_DEPTH).
+ *
+ * @return the queue, NULL if it could not be allocated.
+ */
+kmc_aio_t *kmc_aio_create(kmc_dev_t *dev, uint32_t queue_depth);
+
+/**
+ * @brief Queue a read of "num" sectors starting at "index". Nothing is sent before kmc_aio_submit.
+ *
+ * @param aio the queue.
+ * @param index the first sector to read.
+ * @param num the amount of sector to read.
+ * @param buff the buffer that stores the sectors, it must stay valid until the completion.
+ * @param callback the function called when the read completes.
+ * @param user_data passed back to the callback.
+ *
+ * @return 0 if the request is queued, -1 if the queue is full.
+ */
+int32_t kmc_aio_queue(kmc_aio_t *aio, uint32_t index, uint32_t num, uint8_t *buff, callback_aio_complete callback, void *user_data);
+
+/**
+ * @brief Submit every queued request in 1 batch.
+ *
+ * @param aio the queue.
+ *
+ * @return the number of requests submitted, negative (-errno) on error.
+ */
+int32_t kmc_aio_submit(kmc_aio_t *aio);
+
+/**
+ * @brief Reap the completed requests and call their callbacks.
+ *
+ * @param aio the queue.
+ * @param min_complete the number of completions to wait for (0 does not block).
+ *
+ * @return the number of requests completed by this call.
+ */
+int32_t kmc_aio_poll(kmc_aio_t *aio, uint32_t min_complete);
+
+/**
+ * @brief Get the number of requests submitted and not yet reported by kmc_aio_poll.
+ *
+ * @param aio the queue.
+ *
+ * @return the number of requests in flight.
+ */
+uint32_t kmc_aio_in_flight(kmc_aio_t *aio);
+
+/**
+ * @brief Tell if the queue runs on io_uring or on the blocking fallback.
+ *
+ * @param aio the queue.
+ *
+ * @return 1 if io_uring is used, 0 otherwise.
+ */
+uint8_t kmc_aio_is_async(kmc_aio_t *aio);
+
+/**
+ * @brief Wait for the requests in flight, then free the queue. The handle stays open.
+ *
+ * @param aio the queue.
+ *
+ * @return: This function return nothing
+ */
+void kmc_aio_destroy(kmc_aio_t *aio);
+
+/*Header guard*/
+#endif
+/*End of file*/
@@ -0,0 +1,1593 @@
+/**
+ * @file  : HAL_backend.c
+ * @author: Nguyen The Anh.
+ * @brief : Definition of the built-in image backends (file, mmap, memory) of the HAL.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+/*pread(), preadv(), pwrite() and fsync() are not part of strict ISO C*/
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+/*64 bits off_t for the whole-disk images over 2 GB on 32 bits systems*/
+#if !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
+/*SEEK_DATA and SEEK_HOLE are GNU extensions on Linux*/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include "HAL.h"
+#include "HAL_priv.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+/*Size of the shared zero page returned for the views inside a hole*/
+#define HAL_ZERO_PAGE_SIZE 4096
+
+/*******************************************************************************
+ * Struct
+ ******************************************************************************/
+
+/*State of the file and mmap backends*/
+typedef struct hal_file_backend
+{
+    int fd;               /*fd is the descriptor of the image*/
+    uint8_t *map_base;    /*map_base is the base address of the mapped image, NULL with positional reads*/
+    size_t map_size;      /*map_size is the size of the mapping*/
+    uint64_t size;        /*size is the size of the image in bytes*/
+    uint64_t *data_start; /*data_start stores the first byte of each data region, in order*/
+    uint64_t *data_end;   /*data_end stores the byte after each data region*/
+    uint32_t data_count;  /*data_count is the number of data regions*/
+    uint8_t sparse;       /*sparse tells if the image has at least 1 hole*/
+} hal_file_backend_struct_t;
+
+/*State of the memory backend*/
+typedef struct hal_memory_backend
+{
+    const uint8_t *image; /*image is the content of the image*/
+    size_t size;          /*size is the size of the image in bytes*/
+} hal_memory_backend_struct_t;
+
+/*State of the region backend*/
+typedef struct hal_region_backend
+{
+    kmc_backend_ops_struct_t ops; /*ops are the operations the whole image supports*/
+    kmc_dev_t *dev;               /*dev is the handle of the whole image, referenced*/
+    uint64_t base;                /*base is the byte offset of the region in the image*/
+    uint64_t length;              /*length is the byte length of the region*/
+} hal_region_backend_struct_t;
+
+/*******************************************************************************
+ * Static function prototype
+ ******************************************************************************/
+
+/**
+ * @brief Read "length" bytes at byte "offset" of the image without moving any shared cursor.
+ *
+ * @param fd the descriptor of the image.
+ * @param buff the buffer that stores the bytes.
+ * @param length the number of bytes to read.
+ * @param offset the byte offset in the image.
+ *
+ * @return the number of bytes read succesfully.
+ */
+static size_t hal_pread(int fd, uint8_t *buff, size_t length, uint64_t offset);
+
+/**
+ * @brief Read consecutive bytes at byte "offset" of the image into a list of buffers.
+ *
+ * @param fd the descriptor of the image.
+ * @param iov the buffers to fill in order.
+ * @param iov_count the number of buffers.
+ * @param offset the byte offset in the image.
+ *
+ * @return the number of bytes read succesfully.
+ */
+static size_t hal_preadv(int fd, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+
+/**
+ * @brief Write "length" bytes at byte "offset" of the image without moving any shared cursor.
+ *
+ * @param fd the descriptor of the image.
+ * @param buff the bytes to write.
+ * @param length the number of bytes to write.
+ * @param offset the byte offset in the image.
+ *
+ * @return the number of bytes written succesfully.
+ */
+static size_t hal_pwrite(int fd, const uint8_t *buff, size_t length, uint64_t offset);
+
+/**
+ * @brief Copy consecutive bytes of an image in memory into a list of buffers, clamped at the end of the image.
+ *
+ * @param base the first byte of the image.
+ * @param size the size of the image.
+ * @param iov the buffers to fill in order.
+ * @param iov_count the number of buffers.
+ * @param offset the byte offset in the image.
+ *
+ * @return the number of bytes copied.
+ */
+static size_t hal_copy_iov(const uint8_t *base, size_t size, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+
+/**
+ * @brief Build the map of the data regions of the image with SEEK_DATA/SEEK_HOLE. Without them
+ *        (or on error) the whole image is 1 data region.
+ *
+ * @param file the state of the backend.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_file_build_map(hal_file_backend_struct_t *file);
+
+/**
+ * @brief Find the first data region that ends after "offset".
+ *
+ * @param file the state of the backend.
+ * @param offset the byte offset in the image.
+ *
+ * @return the data region, data_count if there is none.
+ */
+static uint32_t hal_file_find_data(const hal_file_backend_struct_t *file, uint64_t offset);
+
+/**
+ * @brief Add a written byte range to the map of the data regions, the regions it touches are
+ *        merged with it. The map is built again if the arrays can not grow.
+ *
+ * @param file the state of the backend.
+ * @param offset the byte offset of the range in the image.
+ * @param length the byte length of the range.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_file_merge_data(hal_file_backend_struct_t *file, uint64_t offset, uint64_t length);
+
+/**
+ * @brief Check that a byte range of the image does not touch any data region.
+ *
+ * @param file the state of the backend.
+ * @param offset the byte offset in the image.
+ * @param length the byte length of the range.
+ *
+ * @return 1 if the range is inside the image and in holes only, 0 otherwise.
+ */
+static uint8_t hal_file_in_hole(const hal_file_backend_struct_t *file, uint64_t offset, uint64_t length);
+
+/**
+ * @brief Read a byte range that crosses holes: the holes are zeroed, the data regions are read
+ *        (copied from the mapping in mmap mode).
+ *
+ * @param file the state of the backend.
+ * @param iov the buffers to fill in order.
+ * @param iov_count the number of buffers.
+ * @param offset the byte offset in the image.
+ *
+ * @return the number of bytes read succesfully.
+ */
+static size_t hal_file_read_sparse(hal_file_backend_struct_t *file, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+
+/**
+ * @brief Map the whole opened image into memory (read only).
+ *
+ * @param fd the descriptor of the image.
+ * @param map_size stores the size of the mapping.
+ *
+ * @return the base address of the mapping, NULL if the image can not be mapped.
+ */
+static uint8_t *hal_map_file(int fd, size_t *map_size);
+
+/**
+ * @brief Release a mapping created by hal_map_file.
+ *
+ * @param base the base address of the mapping.
+ * @param map_size the size of the mapping.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_unmap_file(uint8_t *base, size_t map_size);
+
+/*File backend operations, see kmc_backend_ops_struct_t*/
+static size_t hal_file_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+static uint64_t hal_file_get_size(void *ctx);
+static size_t hal_file_write(void *ctx, const uint8_t *buff, size_t length, uint64_t offset);
+static int32_t hal_file_flush(void *ctx);
+static void hal_file_advise(void *ctx, uint64_t offset, uint64_t length);
+static int hal_file_get_fd(void *ctx, uint64_t *base_offset);
+static void hal_file_close(void *ctx);
+static uint8_t hal_file_is_zero(void *ctx, uint64_t offset, uint64_t length);
+
+/*Mmap backend operations, the other ones are shared with the file backend*/
+static size_t hal_mmap_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+static const uint8_t *hal_mmap_map(void *ctx, uint64_t offset, size_t length);
+static void hal_mmap_advise(void *ctx, uint64_t offset, uint64_t length);
+
+/*Memory backend operations*/
+static size_t hal_memory_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+static uint64_t hal_memory_get_size(void *ctx);
+static const uint8_t *hal_memory_map(void *ctx, uint64_t offset, size_t length);
+static void hal_memory_close(void *ctx);
+
+/*Region backend operations, an operation is used only if the whole image has it*/
+static size_t hal_region_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+static uint64_t hal_region_get_size(void *ctx);
+static size_t hal_region_write(void *ctx, const uint8_t *buff, size_t length, uint64_t offset);
+static int32_t hal_region_flush(void *ctx);
+static const uint8_t *hal_region_map(void *ctx, uint64_t offset, size_t length);
+static void hal_region_advise(void *ctx, uint64_t offset, uint64_t length);
+static int hal_region_get_fd(void *ctx, uint64_t *base_offset);
+static void hal_region_close(void *ctx);
+static uint8_t hal_region_is_zero(void *ctx, uint64_t offset, uint64_t length);
+
+/*******************************************************************************
+ * Variable
+ ******************************************************************************/
+
+/*Shared read only zero page, viewed in place of the holes of a mapped image*/
+static const uint8_t s_zero_page[HAL_ZERO_PAGE_SIZE];
+
+/*Positional reads on the image file*/
+static const kmc_backend_ops_struct_t s_file_ops =
+{
+    hal_file_read,
+    hal_file_get_size,
+    hal_file_write,
+    hal_file_flush,
+    NULL,
+    hal_file_advise,
+    hal_file_get_fd,
+    hal_file_close,
+    hal_file_is_zero
+};
+
+/*Copies out of the mapped image file, the writes still go to the file*/
+static const kmc_backend_ops_struct_t s_mmap_ops =
+{
+    hal_mmap_read,
+    hal_file_get_size,
+    hal_file_write,
+    hal_file_flush,
+    hal_mmap_map,
+    hal_mmap_advise,
+    NULL,
+    hal_file_close,
+    hal_file_is_zero
+};
+
+/*Copies out of a caller buffer, read only*/
+static const kmc_backend_ops_struct_t s_memory_ops =
+{
+    hal_memory_read,
+    hal_memory_get_size,
+    NULL,
+    NULL,
+    hal_memory_map,
+    NULL,
+    NULL,
+    hal_memory_close,
+    NULL
+};
+
+/*******************************************************************************
+ * Static functions
+ ******************************************************************************/
+
+/*Static functions*************************************************************
+*
+* Function name: hal_pread.
+* Description: Positional read of "length" bytes at "offset". Short reads are
+*              retried until the end of the image.
+*
+END***************************************************************************/
+static size_t hal_pread(int fd, uint8_t *buff, size_t length, uint64_t offset)
+{
+    size_t total_bytes = 0; /*total_bytes stores the num of bytes read successfully*/
+
+#if defined(_WIN32)
+    HANDLE file_handle = (HANDLE)_get_osfhandle(fd); /*file_handle is the OS handle of the image*/
+    OVERLAPPED position;                            /*position carries the offset of the read*/
+    DWORD bytes_read = 0;                           /*bytes_read stores the bytes of 1 ReadFile call*/
+
+    while (total_bytes < length)
+    {
+        memset(&position, 0, sizeof(position));
+        position.Offset = (DWORD)((offset + total_bytes) & 0xFFFFFFFFu);
+        position.OffsetHigh = (DWORD)((offset + total_bytes) >> 32);
+
+        if (!ReadFile(file_handle, buff + total_bytes, (DWORD)(length - total_bytes), &bytes_read, &position) || (0 == bytes_read))
+        {
+            break;
+        }
+
+        total_bytes += bytes_read;
+    }
+#else
+    ssize_t bytes_read = 0; /*bytes_read stores the bytes of 1 pread call*/
+
+    while (total_bytes < length)
+    {
+        bytes_read = pread(fd, buff + total_bytes, length - total_bytes, (off_t)(offset + total_bytes));
+
+        if ((bytes_read < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        else if (bytes_read <= 0)
+        {
+            break;
+        }
+        else
+        {
+            total_bytes += (size_t)bytes_read;
+        }
+    }
+#endif
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_preadv.
+* Description: Positional vector read into "iov_count" buffers. If the vector
+*              read comes back short, the rest is completed buffer by buffer.
+*
+END***************************************************************************/
+static size_t hal_preadv(int fd, const struct iovec *iov, uint32_t iov_count, uint64_t offset)
+{
+    size_t total_bytes = 0; /*total_bytes stores the num of bytes read successfully*/
+    size_t done = 0;        /*done stores the bytes already in the current buffer*/
+    size_t bytes_read = 0;  /*bytes_read stores the bytes of 1 buffer completion*/
+    uint32_t i = 0;         /*i used for traversaling the buffers*/
+
+#if !defined(_WIN32)
+    ssize_t vector_bytes = 0; /*vector_bytes stores the result of the vector read*/
+
+    do
+    {
+        vector_bytes = preadv(fd, iov, (int)iov_count, (off_t)offset);
+    } while ((vector_bytes < 0) && (EINTR == errno));
+
+    if (0 < vector_bytes)
+    {
+        total_bytes = (size_t)vector_bytes;
+    }
+#endif
+
+    /*Complete the buffers the vector read did not fill*/
+    done = total_bytes;
+
+    for (i = 0; i < iov_count; i++)
+    {
+        if (done >= iov[i].iov_len)
+        {
+            done -= iov[i].iov_len;
+        }
+        else
+        {
+            bytes_read = hal_pread(fd, (uint8_t *)iov[i].iov_base + done, iov[i].iov_len - done, offset + total_bytes);
+            total_bytes += bytes_read;
+
+            /*Stop at the end of the image*/
+            if (bytes_read < iov[i].iov_len - done)
+            {
+                break;
+            }
+
+            done = 0;
+        }
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_pwrite.
+* Description: Positional write of "length" bytes at "offset". Short writes are
+*              retried until an error.
+*
+END***************************************************************************/
+static size_t hal_pwrite(int fd, const uint8_t *buff, size_t length, uint64_t offset)
+{
+    size_t total_bytes = 0; /*total_bytes stores the num of bytes written successfully*/
+
+#if defined(_WIN32)
+    HANDLE file_handle = (HANDLE)_get_osfhandle(fd); /*file_handle is the OS handle of the image*/
+    OVERLAPPED position;                            /*position carries the offset of the write*/
+    DWORD bytes_written = 0;                        /*bytes_written stores the bytes of 1 WriteFile call*/
+
+    while (total_bytes < length)
+    {
+        memset(&position, 0, sizeof(position));
+        position.Offset = (DWORD)((offset + total_bytes) & 0xFFFFFFFFu);
+        position.OffsetHigh = (DWORD)((offset + total_bytes) >> 32);
+
+        if (!WriteFile(file_handle, buff + total_bytes, (DWORD)(length - total_bytes), &bytes_written, &position) || (0 == bytes_written))
+        {
+            break;
+        }
+
+        total_bytes += bytes_written;
+    }
+#else
+    ssize_t bytes_written = 0; /*bytes_written stores the bytes of 1 pwrite call*/
+
+    while (total_bytes < length)
+    {
+        bytes_written = pwrite(fd, buff + total_bytes, length - total_bytes, (off_t)(offset + total_bytes));
+
+        if ((bytes_written < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        else if (bytes_written <= 0)
+        {
+            break;
+        }
+        else
+        {
+            total_bytes += (size_t)bytes_written;
+        }
+    }
+#endif
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_copy_iov.
+* Description: Copy the bytes at "offset" of an image in memory to the buffers
+*              in order, stop at the end of the image like a read does.
+*
+END***************************************************************************/
+static size_t hal_copy_iov(const uint8_t *base, size_t size, const struct iovec *iov, uint32_t iov_count, uint64_t offset)
+{
+    size_t total_bytes = 0; /*total_bytes stores the num of bytes copied*/
+    size_t length = 0;      /*length stores the bytes copied to 1 buffer*/
+    uint32_t i = 0;         /*i used for traversaling the buffers*/
+
+    for (i = 0; (i < iov_count) && (offset < size); i++)
+    {
+        /*Clamp the copy at the end of the image*/
+        length = (iov[i].iov_len < size - offset) ? iov[i].iov_len : (size_t)(size - offset);
+
+        memcpy(iov[i].iov_base, base + offset, length);
+
+        total_bytes += length;
+        offset += length;
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_build_map.
+* Description: Walk the image with SEEK_DATA/SEEK_HOLE and store every data
+*              region. A filesystem without hole support reports the whole
+*              image as data, which is also the fallback on any error.
+*
+END***************************************************************************/
+static void hal_file_build_map(hal_file_backend_struct_t *file)
+{
+    uint64_t *start = NULL; /*start is the grown data_start array*/
+    uint64_t *end = NULL;   /*end is the grown data_end array*/
+    uint32_t capacity = 0;  /*capacity is the number of regions the arrays hold*/
+    uint8_t failed = 0;     /*failed tells if the holes can not be found*/
+
+    free(file->data_start);
+    free(file->data_end);
+
+    file->data_start = NULL;
+    file->data_end = NULL;
+    file->data_count = 0;
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    {
+        off_t data = 0; /*data is the first byte of the next data region*/
+        off_t hole = 0; /*hole is the first byte of the hole after it*/
+
+        while ((0 == failed) && ((uint64_t)hole < file->size))
+        {
+            data = lseek(file->fd, hole, SEEK_DATA);
+
+            /*ENXIO: no data after "hole", the rest of the image is a hole*/
+            if (0 > data)
+            {
+                failed = (ENXIO == errno) ? 0 : 1;
+                break;
+            }
+
+            hole = lseek(file->fd, data, SEEK_HOLE);
+
+            if (hole <= data)
+            {
+                failed = 1;
+                break;
+            }
+
+            if (file->data_count == capacity)
+            {
+                capacity = (0 == capacity) ? 16 : capacity * 2;
+                start = (uint64_t *)realloc(file->data_start, sizeof(uint64_t) * capacity);
+
+                if (NULL != start)
+                {
+                    file->data_start = start;
+                }
+
+                end = (uint64_t *)realloc(file->data_end, sizeof(uint64_t) * capacity);
+
+                if (NULL != end)
+                {
+                    file->data_end = end;
+                }
+
+                failed = ((NULL == start) || (NULL == end)) ? 1 : 0;
+            }
+
+            if (0 == failed)
+            {
+                file->data_start[file->data_count] = (uint64_t)data;
+                file->data_end[file->data_count] = ((uint64_t)hole < file->size) ? (uint64_t)hole : file->size;
+                file->data_count++;
+            }
+        }
+    }
+#else
+    failed = 1;
+#endif
+
+    /*Fall back to 1 data region over the whole image*/
+    if (0 != failed)
+    {
+        free(file->data_start);
+        free(file->data_end);
+
+        file->data_start = (uint64_t *)malloc(sizeof(uint64_t));
+        file->data_end = (uint64_t *)malloc(sizeof(uint64_t));
+        file->data_count = 0;
+
+        if ((NULL != file->data_start) && (NULL != file->data_end))
+        {
+            file->data_start[0] = 0;
+            file->data_end[0] = file->size;
+            file->data_count = 1;
+        }
+
+        /*Every byte is read*/
+        file->sparse = 0;
+    }
+    else
+    {
+        file->sparse = ((1 == file->data_count) && (0 == file->data_start[0]) && (file->size == file->data_end[0])) ? 0 : 1;
+    }
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_find_data.
+* Description: Binary search of the first data region that ends after "offset".
+*
+END***************************************************************************/
+static uint32_t hal_file_find_data(const hal_file_backend_struct_t *file, uint64_t offset)
+{
+    uint32_t low = 0;                 /*low is the first candidate region*/
+    uint32_t high = file->data_count; /*high is the region after the last candidate*/
+    uint32_t middle = 0;              /*middle is the region compared*/
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+
+        if (file->data_end[middle] <= offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_merge_data.
+* Description: Replace the data regions that overlap or touch the range with
+*              1 region covering them all, or insert the range in order if it
+*              touches none.
+*
+END***************************************************************************/
+static void hal_file_merge_data(hal_file_backend_struct_t *file, uint64_t offset, uint64_t length)
+{
+    uint64_t *start = NULL;                              /*start is the grown data_start array*/
+    uint64_t *end = NULL;                                /*end is the grown data_end array*/
+    uint64_t range_end = offset + length;                /*range_end is the byte after the range*/
+    uint32_t first = hal_file_find_data(file, offset);   /*first is the first region merged*/
+    uint32_t last = 0;                                   /*last is the region after the last region merged*/
+
+    /*A region ending right at the range is merged too*/
+    if ((0 < first) && (file->data_end[first - 1] == offset))
+    {
+        first--;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    for (last = first; (last < file->data_count) && (file->data_start[last] <= range_end); last++)
+    {
+        /*Do nothing*/
+    }
+
+    if (last == first)
+    {
+        start = (uint64_t *)realloc(file->data_start, sizeof(uint64_t) * (file->data_count + 1));
+
+        if (NULL != start)
+        {
+            file->data_start = start;
+        }
+
+        end = (uint64_t *)realloc(file->data_end, sizeof(uint64_t) * (file->data_count + 1));
+
+        if (NULL != end)
+        {
+            file->data_end = end;
+        }
+
+        if ((NULL == start) || (NULL == end))
+        {
+            hal_file_build_map(file);
+            return;
+        }
+
+        memmove(file->data_start + first + 1, file->data_start + first, sizeof(uint64_t) * (file->data_count - first));
+        memmove(file->data_end + first + 1, file->data_end + first, sizeof(uint64_t) * (file->data_count - first));
+        file->data_start[first] = offset;
+        file->data_end[first] = range_end;
+        file->data_count++;
+    }
+    else
+    {
+        file->data_start[first] = (file->data_start[first] < offset) ? file->data_start[first] : offset;
+        file->data_end[first] = (file->data_end[last - 1] > range_end) ? file->data_end[last - 1] : range_end;
+
+        memmove(file->data_start + first + 1, file->data_start + last, sizeof(uint64_t) * (file->data_count - last));
+        memmove(file->data_end + first + 1, file->data_end + last, sizeof(uint64_t) * (file->data_count - last));
+        file->data_count -= last - first - 1;
+    }
+
+    file->sparse = ((1 == file->data_count) && (0 == file->data_start[0]) && (file->size == file->data_end[0])) ? 0 : 1;
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_in_hole.
+* Description: Return 1 if the range is inside the image and the first data
+*              region after its start begins after its end.
+*
+END***************************************************************************/
+static uint8_t hal_file_in_hole(const hal_file_backend_struct_t *file, uint64_t offset, uint64_t length)
+{
+    uint8_t in_hole = 0; /*in_hole stores the result*/
+    uint32_t region = 0; /*region is the first data region ending after offset*/
+
+    if ((1 == file->sparse) && (offset <= file->size) && (length <= file->size - offset))
+    {
+        region = hal_file_find_data(file, offset);
+        in_hole = ((region == file->data_count) || (file->data_start[region] >= offset + length)) ? 1 : 0;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return in_hole;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_read_sparse.
+* Description: Cut the range at the boundaries of the data regions, zero the
+*              pieces in holes and read the pieces in data regions. Stop at the
+*              end of the image or at the first short read.
+*
+END***************************************************************************/
+static size_t hal_file_read_sparse(hal_file_backend_struct_t *file, const struct iovec *iov, uint32_t iov_count, uint64_t offset)
+{
+    struct iovec piece;     /*piece describes 1 part of a buffer inside a data region*/
+    uint8_t *buff = NULL;   /*buff is the current buffer*/
+    size_t total_bytes = 0; /*total_bytes stores the num of bytes read successfully*/
+    size_t done = 0;        /*done stores the bytes already in the current buffer*/
+    size_t length = 0;      /*length stores the bytes of 1 piece*/
+    size_t bytes_read = 0;  /*bytes_read stores the bytes read for 1 data piece*/
+    uint64_t piece_end = 0; /*piece_end is the end of the hole or data region at offset*/
+    uint32_t region = 0;    /*region is the first data region ending after offset*/
+    uint8_t is_data = 0;    /*is_data tells if offset is inside a data region*/
+    uint8_t short_read = 0; /*short_read tells if a data piece came back short*/
+    uint32_t i = 0;         /*i used for traversaling the buffers*/
+
+    for (i = 0; (i < iov_count) && (0 == short_read); i++)
+    {
+        buff = (uint8_t *)iov[i].iov_base;
+
+        for (done = 0; (done < iov[i].iov_len) && (offset < file->size) && (0 == short_read); done += length)
+        {
+            region = hal_file_find_data(file, offset);
+            is_data = ((region < file->data_count) && (file->data_start[region] <= offset)) ? 1 : 0;
+
+            if (1 == is_data)
+            {
+                piece_end = file->data_end[region];
+            }
+            else
+            {
+                piece_end = (region < file->data_count) ? file->data_start[region] : file->size;
+            }
+
+            length = ((uint64_t)(iov[i].iov_len - done) < piece_end - offset) ? iov[i].iov_len - done : (size_t)(piece_end - offset);
+
+            if (0 == is_data)
+            {
+                memset(buff + done, 0, length);
+            }
+            else if (NULL != file->map_base)
+            {
+                piece.iov_base = buff + done;
+                piece.iov_len = length;
+
+                bytes_read = hal_copy_iov(file->map_base, file->map_size, &piece, 1, offset);
+                short_read = (bytes_read < length) ? 1 : 0;
+                length = bytes_read;
+            }
+            else
+            {
+                bytes_read = hal_pread(file->fd, buff + done, length, offset);
+                short_read = (bytes_read < length) ? 1 : 0;
+                length = bytes_read;
+            }
+
+            offset += length;
+            total_bytes += length;
+        }
+
+        /*Stop at the end of the image*/
+        if (done < iov[i].iov_len)
+        {
+            break;
+        }
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_map_file.
+* Description: Map the whole image read only and return the base address.
+*
+END***************************************************************************/
+static uint8_t *hal_map_file(int fd, size_t *map_size)
+{
+    uint8_t *base = NULL; /*base stores the base address of the mapping*/
+
+#if defined(_WIN32)
+    HANDLE file_handle = (HANDLE)_get_osfhandle(fd); /*file_handle is the OS handle of the image*/
+    HANDLE map_handle = NULL;                       /*map_handle is the file mapping object*/
+    LARGE_INTEGER file_size;                        /*file_size stores the size of the image*/
+
+    if ((INVALID_HANDLE_VALUE != file_handle) && GetFileSizeEx(file_handle, &file_size) && (0 < file_size.QuadPart) && ((uint64_t)file_size.QuadPart <= (uint64_t)SIZE_MAX))
+    {
+        map_handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (NULL != map_handle)
+        {
+            base = (uint8_t *)MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);
+
+            /*The view keeps the mapping object alive*/
+            CloseHandle(map_handle);
+
+            *map_size = (size_t)file_size.QuadPart;
+        }
+    }
+#else
+    struct stat file_stat; /*file_stat stores the status of the image*/
+
+    /*An image larger than the address space stays on positional reads*/
+    if ((0 == fstat(fd, &file_stat)) && (0 < file_stat.st_size) && ((uint64_t)file_stat.st_size <= (uint64_t)SIZE_MAX))
+    {
+        base = (uint8_t *)mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (MAP_FAILED == (void *)base)
+        {
+            base = NULL;
+        }
+        else
+        {
+            *map_size = (size_t)file_stat.st_size;
+        }
+    }
+#endif
+
+    return base;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_unmap_file.
+* Description: Release the mapping of the image.
+*
+END***************************************************************************/
+static void hal_unmap_file(uint8_t *base, size_t map_size)
+{
+#if defined(_WIN32)
+    (void)map_size;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, map_size);
+#endif
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_read.
+* Description: Read the buffers with 1 positional vector read, unless the range
+*              touches a hole of a sparse image.
+*
+END***************************************************************************/
+static size_t hal_file_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset)
+{
+    hal_file_backend_struct_t *file = (hal_file_backend_struct_t *)ctx; /*file is the state of the backend*/
+    size_t total_bytes = 0;                                            /*total_bytes stores the num of bytes read successfully*/
+    uint64_t length = 0;                                               /*length stores the byte length of the range*/
+    uint32_t region = 0;                                               /*region is the data region holding offset*/
+    uint32_t i = 0;                                                    /*i used for traversaling the buffers*/
+
+    if (1 == file->sparse)
+    {
+        for (i = 0; i < iov_count; i++)
+        {
+            length += iov[i].iov_len;
+        }
+
+        region = hal_file_find_data(file, offset);
+    }
+
+    /*Fast path: the range lies in 1 data region*/
+    if ((0 == file->sparse) || ((region < file->data_count) && (file->data_start[region] <= offset) && (offset + length <= file->data_end[region])))
+    {
+        total_bytes = hal_preadv(file->fd, iov, iov_count, offset);
+    }
+    else
+    {
+        total_bytes = hal_file_read_sparse(file, iov, iov_count, offset);
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_get_size.
+* Description: Return the size of the image taken when it was opened.
+*
+END***************************************************************************/
+static uint64_t hal_file_get_size(void *ctx)
+{
+    return ((hal_file_backend_struct_t *)ctx)->size;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_write.
+* Description: Write the bytes with a positional write. A mapped image is mapped
+*              shared, so the view sees the new bytes.
+*
+END***************************************************************************/
+static size_t hal_file_write(void *ctx, const uint8_t *buff, size_t length, uint64_t offset)
+{
+    hal_file_backend_struct_t *file = (hal_file_backend_struct_t *)ctx; /*file is the state of the backend*/
+    size_t total_bytes = 0;                                            /*total_bytes stores the num of bytes written successfully*/
+
+    total_bytes = hal_pwrite(file->fd, buff, length, offset);
+
+    /*The image may have grown*/
+    if (offset + total_bytes > file->size)
+    {
+        file->size = offset + total_bytes;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    /*The write may have filled a hole*/
+    if ((1 == file->sparse) && (0 < total_bytes))
+    {
+        hal_file_merge_data(file, offset, total_bytes);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_flush.
+* Description: Flush the written bytes of the image to the disk.
+*
+END***************************************************************************/
+static int32_t hal_file_flush(void *ctx)
+{
+    int32_t result = 0; /*result stores the result of the flush*/
+
+#if defined(_WIN32)
+    result = (0 == _commit(((hal_file_backend_struct_t *)ctx)->fd)) ? 0 : -1;
+#else
+    result = (0 == fsync(((hal_file_backend_struct_t *)ctx)->fd)) ? 0 : -1;
+#endif
+
+    return result;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_advise.
+* Description: Hint the kernel with POSIX_FADV_WILLNEED when it is available.
+*
+END***************************************************************************/
+static void hal_file_advise(void *ctx, uint64_t offset, uint64_t length)
+{
+#if defined(POSIX_FADV_WILLNEED)
+    posix_fadvise(((hal_file_backend_struct_t *)ctx)->fd, (off_t)offset, (off_t)length, POSIX_FADV_WILLNEED);
+#else
+    (void)ctx;
+    (void)offset;
+    (void)length;
+#endif
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_get_fd.
+* Description: Return the descriptor of the image, the image starts at byte 0.
+*
+END***************************************************************************/
+static int hal_file_get_fd(void *ctx, uint64_t *base_offset)
+{
+    *base_offset = 0;
+
+    return ((hal_file_backend_struct_t *)ctx)->fd;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_close.
+* Description: Unmap the image, close the descriptor and free the state.
+*
+END***************************************************************************/
+static void hal_file_close(void *ctx)
+{
+    hal_file_backend_struct_t *file = (hal_file_backend_struct_t *)ctx; /*file is the state of the backend*/
+
+    free(file->data_start);
+    free(file->data_end);
+
+    /*Release the mapping*/
+    if (NULL != file->map_base)
+    {
+        hal_unmap_file(file->map_base, file->map_size);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    /*Close the file*/
+#if defined(_WIN32)
+    _close(file->fd);
+#else
+    close(file->fd);
+#endif
+
+    free(file);
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_file_is_zero.
+* Description: Return 1 if the range lies in the holes of the image.
+*
+END***************************************************************************/
+static uint8_t hal_file_is_zero(void *ctx, uint64_t offset, uint64_t length)
+{
+    return hal_file_in_hole((hal_file_backend_struct_t *)ctx, offset, length);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_mmap_read.
+* Description: Copy the bytes out of the mapping, the holes of a sparse image
+*              are zeroed without touching their pages.
+*
+END***************************************************************************/
+static size_t hal_mmap_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset)
+{
+    hal_file_backend_struct_t *file = (hal_file_backend_struct_t *)ctx; /*file is the state of the backend*/
+    size_t total_bytes = 0;                                            /*total_bytes stores the num of bytes read successfully*/
+
+    if (1 == file->sparse)
+    {
+        total_bytes = hal_file_read_sparse(file, iov, iov_count, offset);
+    }
+    else
+    {
+        total_bytes = hal_copy_iov(file->map_base, file->map_size, iov, iov_count, offset);
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_mmap_map.
+* Description: Return the address of the range inside the mapping, NULL if the
+*              range is out of the mapping. A range inside a hole is viewed in
+*              the shared zero page so its pages are never faulted in.
+*
+END***************************************************************************/
+static const uint8_t *hal_mmap_map(void *ctx, uint64_t offset, size_t length)
+{
+    hal_file_backend_struct_t *file = (hal_file_backend_struct_t *)ctx; /*file is the state of the backend*/
+    const uint8_t *view = NULL;                                        /*view points to the first byte of the range*/
+
+    if ((HAL_ZERO_PAGE_SIZE >= length) && (1 == hal_file_in_hole(file, offset, length)))
+    {
+        view = s_zero_page;
+    }
+    else if ((offset <= file->map_size) && (length <= file->map_size - offset))
+    {
+        view = file->map_base + offset;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return view;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_mmap_advise.
+* Description: Hint the kernel with POSIX_MADV_WILLNEED on the pages of the
+*              range, clamped at the end of the mapping.
+*
+END***************************************************************************/
+static void hal_mmap_advise(void *ctx, uint64_t offset, uint64_t length)
+{
+#if defined(POSIX_MADV_WILLNEED)
+    hal_file_backend_struct_t *file = (hal_file_backend_struct_t *)ctx;  /*file is the state of the backend*/
+    uint64_t page_offset = offset % (uint64_t)sysconf(_SC_PAGESIZE); /*page_offset aligns the hint on a page*/
+
+    if (offset < file->map_size)
+    {
+        if (length > file->map_size - offset)
+        {
+            length = file->map_size - offset;
+        }
+
+        posix_madvise(file->map_base + offset - page_offset, (size_t)(length + page_offset), POSIX_MADV_WILLNEED);
+    }
+#else
+    (void)ctx;
+    (void)offset;
+    (void)length;
+#endif
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_memory_read.
+* Description: Copy the bytes out of the caller buffer.
+*
+END***************************************************************************/
+static size_t hal_memory_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset)
+{
+    hal_memory_backend_struct_t *memory = (hal_memory_backend_struct_t *)ctx; /*memory is the state of the backend*/
+
+    return hal_copy_iov(memory->image, memory->size, iov, iov_count, offset);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_memory_get_size.
+* Description: Return the size of the caller buffer.
+*
+END***************************************************************************/
+static uint64_t hal_memory_get_size(void *ctx)
+{
+    return ((hal_memory_backend_struct_t *)ctx)->size;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_memory_map.
+* Description: Return the address of the range inside the caller buffer, NULL if
+*              the range is out of the image.
+*
+END***************************************************************************/
+static const uint8_t *hal_memory_map(void *ctx, uint64_t offset, size_t length)
+{
+    hal_memory_backend_struct_t *memory = (hal_memory_backend_struct_t *)ctx; /*memory is the state of the backend*/
+    const uint8_t *view = NULL;                                              /*view points to the first byte of the range*/
+
+    if ((offset <= memory->size) && (length <= memory->size - offset))
+    {
+        view = memory->image + offset;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return view;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_memory_close.
+* Description: Free the state, the caller buffer is left to the caller.
+*
+END***************************************************************************/
+static void hal_memory_close(void *ctx)
+{
+    free(ctx);
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_read.
+* Description: Read the range from the whole image, shifted by the base of the
+*              region. The buffers are cut at the end of the region.
+*
+END***************************************************************************/
+static size_t hal_region_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset)
+{
+    hal_region_backend_struct_t *region = (hal_region_backend_struct_t *)ctx; /*region is the state of the backend*/
+    struct iovec *clamped = NULL;                                            /*clamped is the copy of the buffers cut at the end*/
+    size_t total_bytes = 0;                                                  /*total_bytes stores the num of bytes read successfully*/
+    uint64_t left = 0;                                                       /*left is the bytes of the region after offset*/
+    uint64_t length = 0;                                                     /*length stores the byte length of the buffers*/
+    uint32_t i = 0;                                                          /*i used for traversaling the buffers*/
+
+    if (offset < region->length)
+    {
+        left = region->length - offset;
+
+        for (i = 0; i < iov_count; i++)
+        {
+            length += iov[i].iov_len;
+        }
+
+        if (length <= left)
+        {
+            total_bytes = region->dev->ops->read(region->dev->ctx, iov, iov_count, region->base + offset);
+        }
+        else
+        {
+            clamped = (struct iovec *)malloc(sizeof(struct iovec) * iov_count);
+
+            if (NULL != clamped)
+            {
+                /*Keep the buffers that start before the end, cut the last one*/
+                for (i = 0; (i < iov_count) && (0 < left); i++)
+                {
+                    clamped[i] = iov[i];
+
+                    if (clamped[i].iov_len > left)
+                    {
+                        clamped[i].iov_len = (size_t)left;
+                    }
+
+                    left -= clamped[i].iov_len;
+                }
+
+                total_bytes = region->dev->ops->read(region->dev->ctx, clamped, i, region->base + offset);
+
+                free(clamped);
+            }
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_get_size.
+* Description: Return the length of the region.
+*
+END***************************************************************************/
+static uint64_t hal_region_get_size(void *ctx)
+{
+    return ((hal_region_backend_struct_t *)ctx)->length;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_write.
+* Description: Write to the whole image, cut at the end of the region.
+*
+END***************************************************************************/
+static size_t hal_region_write(void *ctx, const uint8_t *buff, size_t length, uint64_t offset)
+{
+    hal_region_backend_struct_t *region = (hal_region_backend_struct_t *)ctx; /*region is the state of the backend*/
+    size_t total_bytes = 0;                                                  /*total_bytes stores the num of bytes written successfully*/
+
+    if (offset < region->length)
+    {
+        if (length > region->length - offset)
+        {
+            length = (size_t)(region->length - offset);
+        }
+
+        total_bytes = region->dev->ops->write(region->dev->ctx, buff, length, region->base + offset);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_flush.
+* Description: Flush the whole image.
+*
+END***************************************************************************/
+static int32_t hal_region_flush(void *ctx)
+{
+    hal_region_backend_struct_t *region = (hal_region_backend_struct_t *)ctx; /*region is the state of the backend*/
+
+    return region->dev->ops->flush(region->dev->ctx);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_map.
+* Description: View the range in the whole image if it is inside the region.
+*
+END***************************************************************************/
+static const uint8_t *hal_region_map(void *ctx, uint64_t offset, size_t length)
+{
+    hal_region_backend_struct_t *region = (hal_region_backend_struct_t *)ctx; /*region is the state of the backend*/
+    const uint8_t *view = NULL;                                              /*view points to the first byte of the range*/
+
+    if ((offset <= region->length) && (length <= region->length - offset))
+    {
+        view = region->dev->ops->map(region->dev->ctx, region->base + offset, length);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return view;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_advise.
+* Description: Forward the hint, cut at the end of the region.
+*
+END***************************************************************************/
+static void hal_region_advise(void *ctx, uint64_t offset, uint64_t length)
+{
+    hal_region_backend_struct_t *region = (hal_region_backend_struct_t *)ctx; /*region is the state of the backend*/
+
+    if (offset < region->length)
+    {
+        if (length > region->length - offset)
+        {
+            length = region->length - offset;
+        }
+
+        region->dev->ops->advise(region->dev->ctx, region->base + offset, length);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_get_fd.
+* Description: Return the descriptor of the whole image, the region starts at
+*              its base inside it.
+*
+END***************************************************************************/
+static int hal_region_get_fd(void *ctx, uint64_t *base_offset)
+{
+    hal_region_backend_struct_t *region = (hal_region_backend_struct_t *)ctx; /*region is the state of the backend*/
+    int fd = -1;                                                             /*fd stores the descriptor of the whole image*/
+
+    fd = region->dev->ops->get_fd(region->dev->ctx, base_offset);
+    *base_offset += region->base;
+
+    return fd;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_close.
+* Description: Drop the reference on the whole image and free the state.
+*
+END***************************************************************************/
+static void hal_region_close(void *ctx)
+{
+    hal_region_backend_struct_t *region = (hal_region_backend_struct_t *)ctx; /*region is the state of the backend*/
+
+    kmc_close(region->dev);
+
+    free(region);
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_region_is_zero.
+* Description: Ask the whole image if the range is a hole.
+*
+END***************************************************************************/
+static uint8_t hal_region_is_zero(void *ctx, uint64_t offset, uint64_t length)
+{
+    hal_region_backend_struct_t *region = (hal_region_backend_struct_t *)ctx; /*region is the state of the backend*/
+    uint8_t is_zero = 0;                                                     /*is_zero stores the result*/
+
+    if ((offset <= region->length) && (length <= region->length - offset))
+    {
+        is_zero = region->dev->ops->is_zero(region->dev->ctx, region->base + offset, length);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return is_zero;
+}
+
+/*******************************************************************************
+ * Functions
+ ******************************************************************************/
+
+/*Functions*********************************************************************
+*
+* Function name: hal_backend_open_file.
+* Description: Open the image for reading and writing, read only if the file
+*              does not allow writing. In mmap mode the image is mapped once
+*              here, the file backend is used if it can not be mapped.
+*
+END***************************************************************************/
+const kmc_backend_ops_struct_t *hal_backend_open_file(const uint8_t *file_name, kmc_access_mode_enum_t mode, void **ctx)
+{
+    const kmc_backend_ops_struct_t *ops = NULL; /*ops stores the operations of the opened backend*/
+    hal_file_backend_struct_t *file = NULL;     /*file stores the state of the backend*/
+    int fd = -1;                                /*fd is the descriptor of the image*/
+
+    /*Open the file in "file_name"*/
+#if defined(_WIN32)
+    fd = _open((const char *)file_name, _O_RDWR | _O_BINARY);
+
+    if (0 > fd)
+    {
+        fd = _open((const char *)file_name, _O_RDONLY | _O_BINARY);
+    }
+#else
+    fd = open((const char *)file_name, O_RDWR);
+
+    if (0 > fd)
+    {
+        fd = open((const char *)file_name, O_RDONLY);
+    }
+#endif
+
+    /*Check if the file opened succesfully*/
+    if (0 <= fd)
+    {
+        file = (hal_file_backend_struct_t *)calloc(1, sizeof(hal_file_backend_struct_t));
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if (NULL != file)
+    {
+        file->fd = fd;
+        ops = &s_file_ops;
+
+#if defined(_WIN32)
+        file->size = (uint64_t)_lseeki64(fd, 0, SEEK_END);
+#else
+        {
+            struct stat file_stat; /*file_stat stores the status of the image*/
+
+            if (0 == fstat(fd, &file_stat))
+            {
+                file->size = (uint64_t)file_stat.st_size;
+            }
+        }
+#endif
+
+        /*Find the holes of a sparse image*/
+        hal_file_build_map(file);
+
+        /*Map the image, stay on positional reads if it can not be mapped*/
+        if (KMC_ACCESS_MMAP == mode)
+        {
+            file->map_base = hal_map_file(fd, &file->map_size);
+
+            if (NULL != file->map_base)
+            {
+                ops = &s_mmap_ops;
+            }
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        *ctx = file;
+    }
+    else if (0 <= fd)
+    {
+#if defined(_WIN32)
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return ops;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: hal_backend_open_memory.
+* Description: Allocate the state of the memory backend for the caller buffer.
+*
+END***************************************************************************/
+const kmc_backend_ops_struct_t *hal_backend_open_memory(const uint8_t *image, size_t size, void **ctx)
+{
+    const kmc_backend_ops_struct_t *ops = NULL; /*ops stores the operations of the opened backend*/
+    hal_memory_backend_struct_t *memory = NULL; /*memory stores the state of the backend*/
+
+    if ((NULL != image) || (0 == size))
+    {
+        memory = (hal_memory_backend_struct_t *)malloc(sizeof(hal_memory_backend_struct_t));
+    }
+
+    if (NULL != memory)
+    {
+        memory->image = image;
+        memory->size = size;
+
+        *ctx = memory;
+        ops = &s_memory_ops;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return ops;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: hal_backend_open_region.
+* Description: Allocate the state of the region backend, its operations mirror
+*              the optional operations of the whole image, and take a
+*              reference on the handle of the whole image.
+*
+END***************************************************************************/
+const kmc_backend_ops_struct_t *hal_backend_open_region(kmc_dev_t *dev, uint64_t base_offset, uint64_t length, void **ctx)
+{
+    const kmc_backend_ops_struct_t *parent = dev->ops; /*parent is the backend of the whole image*/
+    hal_region_backend_struct_t *region = NULL;       /*region stores the state of the backend*/
+
+    region = (hal_region_backend_struct_t *)malloc(sizeof(hal_region_backend_struct_t));
+
+    if (NULL != region)
+    {
+        region->ops.read = hal_region_read;
+        region->ops.get_size = hal_region_get_size;
+        region->ops.write = (NULL != parent->write) ? hal_region_write : NULL;
+        region->ops.flush = (NULL != parent->flush) ? hal_region_flush : NULL;
+        region->ops.map = (NULL != parent->map) ? hal_region_map : NULL;
+        region->ops.advise = (NULL != parent->advise) ? hal_region_advise : NULL;
+        region->ops.get_fd = (NULL != parent->get_fd) ? hal_region_get_fd : NULL;
+        region->ops.close = hal_region_close;
+        region->ops.is_zero = (NULL != parent->is_zero) ? hal_region_is_zero : NULL;
+
+        region->dev = dev;
+        region->base = base_offset;
+        region->length = length;
+
+        dev->refs++;
+
+        *ctx = region;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return (NULL != region) ? &region->ops : NULL;
+}
+/*End of file*/
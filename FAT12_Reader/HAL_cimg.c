@@ -0,0 +1,986 @@
+/**
+ * @file  : HAL_cimg.c
+ * @author: Nguyen The Anh.
+ * @brief : Definition of the compressed image container backend and its converter.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HAL.h"
+#include "HAL_priv.h"
+#include "HAL_cimg.h"
+
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+/*Container layout (little endian):
+  header  : magic[8], chunk_size(4), chunk_count(4), image_size(8), reserved(8)
+  index   : chunk_count entries of offset(8), stored(4), type(4)
+  payload : the stored chunks
+  "stored" is the byte length of the chunk in the payload, or the byte value
+  of a KMC_CIMG_CHUNK_FILL chunk*/
+#define HAL_CIMG_MAGIC "KMCCIMG1"
+#define HAL_CIMG_MAGIC_SIZE 8
+#define HAL_CIMG_HEADER_SIZE 32
+#define HAL_CIMG_INDEX_ENTRY_SIZE 16
+
+/*Number of decompressed chunks kept by an opened container*/
+#define HAL_CIMG_CHUNK_SLOTS 4
+
+/*Marks an empty decompressed chunk slot*/
+#define HAL_CIMG_NO_CHUNK 0xFFFFFFFFu
+
+/*LZ codec: a token under 0x80 is followed by token + 1 literals, otherwise it is a
+  match of (token & 0x7F) + HAL_LZ_MIN_MATCH bytes followed by a 2 bytes distance*/
+#define HAL_LZ_MIN_MATCH 4
+#define HAL_LZ_MAX_MATCH (0x7F + HAL_LZ_MIN_MATCH)
+#define HAL_LZ_MAX_LITERALS 0x80
+#define HAL_LZ_MAX_DISTANCE 0xFFFF
+#define HAL_LZ_HASH_BITS 12
+#define HAL_LZ_HASH(p) ((uint32_t)(((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24)) * 2654435761u) >> (32 - HAL_LZ_HASH_BITS))
+
+/*******************************************************************************
+ * Struct
+ ******************************************************************************/
+
+/*1 decompressed chunk kept in memory*/
+typedef struct hal_cimg_slot
+{
+    uint32_t chunk; /*chunk is the chunk held by the slot, HAL_CIMG_NO_CHUNK if empty*/
+    uint32_t stamp; /*stamp is the time of the last use, the oldest slot is reused*/
+    uint8_t *data;  /*data stores the decompressed chunk*/
+} hal_cimg_slot_struct_t;
+
+/*State of the compressed container backend*/
+typedef struct hal_cimg_backend
+{
+    const kmc_backend_ops_struct_t *src_ops;           /*src_ops is the backend holding the container*/
+    void *src_ctx;                                     /*src_ctx is the state of src_ops*/
+    uint32_t chunk_size;                               /*chunk_size is the size of 1 chunk in bytes*/
+    uint32_t chunk_count;                              /*chunk_count is the number of chunks*/
+    uint64_t image_size;                               /*image_size is the size of the raw image*/
+    uint64_t *offset;                                  /*offset stores the payload offset of each chunk*/
+    uint32_t *stored;                                  /*stored stores the stored length (fill value) of each chunk*/
+    uint8_t *type;                                     /*type stores the kmc_cimg_chunk_type_enum_t of each chunk*/
+    uint8_t *packed;                                   /*packed receives the compressed bytes of 1 chunk*/
+    hal_cimg_slot_struct_t slot[HAL_CIMG_CHUNK_SLOTS]; /*slot stores the last decompressed chunks*/
+    uint32_t clock;                                    /*clock is incremented at every slot use*/
+} hal_cimg_backend_struct_t;
+
+/*******************************************************************************
+ * Static function prototype
+ ******************************************************************************/
+
+/**
+ * @brief Store a 32 bits value in little endian.
+ *
+ * @param buff the destination.
+ * @param value the value.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_cimg_put32(uint8_t *buff, uint32_t value);
+
+/**
+ * @brief Store a 64 bits value in little endian.
+ *
+ * @param buff the destination.
+ * @param value the value.
+ *
+ * @return: This function return nothing.
+ */
+static void hal_cimg_put64(uint8_t *buff, uint64_t value);
+
+/**
+ * @brief Load a 32 bits little endian value.
+ *
+ * @param buff the source.
+ *
+ * @return the value.
+ */
+static uint32_t hal_cimg_get32(const uint8_t *buff);
+
+/**
+ * @brief Load a 64 bits little endian value.
+ *
+ * @param buff the source.
+ *
+ * @return the value.
+ */
+static uint64_t hal_cimg_get64(const uint8_t *buff);
+
+/**
+ * @brief Compress a block with the built-in LZ codec.
+ *
+ * @param src the bytes to compress.
+ * @param length the number of bytes to compress (at most 65536).
+ * @param dst the buffer that stores the compressed bytes.
+ * @param capacity the size of dst.
+ *
+ * @return the compressed size, 0 if it does not fit in dst.
+ */
+static uint32_t hal_lz_compress(const uint8_t *src, uint32_t length, uint8_t *dst, uint32_t capacity);
+
+/**
+ * @brief Decompress a block of the built-in LZ codec, every token is checked against the buffers.
+ *
+ * @param src the compressed bytes.
+ * @param length the number of compressed bytes.
+ * @param dst the buffer that stores the decompressed bytes.
+ * @param capacity the size of dst.
+ *
+ * @return the decompressed size, 0 if the block is corrupted.
+ */
+static uint32_t hal_lz_decompress(const uint8_t *src, uint32_t length, uint8_t *dst, uint32_t capacity);
+
+/**
+ * @brief Get the length of a chunk, the last chunk may be shorter.
+ *
+ * @param cimg the state of the backend.
+ * @param chunk the chunk.
+ *
+ * @return the length in bytes.
+ */
+static uint32_t hal_cimg_chunk_length(const hal_cimg_backend_struct_t *cimg, uint32_t chunk);
+
+/**
+ * @brief Get a chunk stored as raw or LZ decompressed in a slot, decompress it if needed.
+ *
+ * @param cimg the state of the backend.
+ * @param chunk the chunk.
+ *
+ * @return the decompressed chunk, NULL if it can not be read or is corrupted.
+ */
+static const uint8_t *hal_cimg_load(hal_cimg_backend_struct_t *cimg, uint32_t chunk);
+
+/**
+ * @brief Read the header and the index of a container and check them.
+ *
+ * @param cimg the state of the backend, src_ops/src_ctx set.
+ *
+ * @return 0 if the container is valid, -1 otherwise.
+ */
+static int32_t hal_cimg_load_index(hal_cimg_backend_struct_t *cimg);
+
+/*Compressed container backend operations, see kmc_backend_ops_struct_t*/
+static size_t hal_cimg_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset);
+static uint64_t hal_cimg_get_size(void *ctx);
+static void hal_cimg_close(void *ctx);
+static uint8_t hal_cimg_is_zero(void *ctx, uint64_t offset, uint64_t length);
+
+/*******************************************************************************
+ * Variable
+ ******************************************************************************/
+
+/*Read only, the chunks are decompressed on demand*/
+static const kmc_backend_ops_struct_t s_cimg_ops =
+{
+    hal_cimg_read,
+    hal_cimg_get_size,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    hal_cimg_close,
+    hal_cimg_is_zero
+};
+
+/*******************************************************************************
+ * Static functions
+ ******************************************************************************/
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_put32.
+* Description: Store a 32 bits value in little endian.
+*
+END***************************************************************************/
+static void hal_cimg_put32(uint8_t *buff, uint32_t value)
+{
+    buff[0] = (uint8_t)value;
+    buff[1] = (uint8_t)(value >> 8);
+    buff[2] = (uint8_t)(value >> 16);
+    buff[3] = (uint8_t)(value >> 24);
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_put64.
+* Description: Store a 64 bits value in little endian.
+*
+END***************************************************************************/
+static void hal_cimg_put64(uint8_t *buff, uint64_t value)
+{
+    hal_cimg_put32(buff, (uint32_t)value);
+    hal_cimg_put32(buff + 4, (uint32_t)(value >> 32));
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_get32.
+* Description: Load a 32 bits little endian value.
+*
+END***************************************************************************/
+static uint32_t hal_cimg_get32(const uint8_t *buff)
+{
+    return (uint32_t)buff[0] | ((uint32_t)buff[1] << 8) | ((uint32_t)buff[2] << 16) | ((uint32_t)buff[3] << 24);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_get64.
+* Description: Load a 64 bits little endian value.
+*
+END***************************************************************************/
+static uint64_t hal_cimg_get64(const uint8_t *buff)
+{
+    return (uint64_t)hal_cimg_get32(buff) | ((uint64_t)hal_cimg_get32(buff + 4) << 32);
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_lz_compress.
+* Description: Greedy LZ77: the last position of every 4 bytes hash is kept in
+*              a table, a match is taken as soon as the 4 bytes are equal. A
+*              match may overlap the bytes it produces, so runs of 1 byte
+*              become 1 literal and a chain of matches.
+*
+END***************************************************************************/
+static uint32_t hal_lz_compress(const uint8_t *src, uint32_t length, uint8_t *dst, uint32_t capacity)
+{
+    int32_t table[1 << HAL_LZ_HASH_BITS]; /*table stores the last position of each hash*/
+    uint32_t out = 0;                     /*out is the next byte of dst*/
+    uint32_t pos = 0;                     /*pos is the current position in src*/
+    uint32_t literal_start = 0;           /*literal_start is the first byte not emitted yet*/
+    uint32_t run = 0;                     /*run is the length of 1 literal run*/
+    uint32_t match = 0;                   /*match is the length of the current match*/
+    uint32_t hash = 0;                    /*hash is the hash of the 4 bytes at pos*/
+    int32_t candidate = 0;                /*candidate is the previous position with the same hash*/
+    uint8_t overflow = 0;                 /*overflow tells if dst is too small*/
+
+    for (hash = 0; hash < (1u << HAL_LZ_HASH_BITS); hash++)
+    {
+        table[hash] = -1;
+    }
+
+    while ((0 == overflow) && (pos <= length))
+    {
+        match = 0;
+
+        if (pos + HAL_LZ_MIN_MATCH <= length)
+        {
+            hash = HAL_LZ_HASH(src + pos);
+            candidate = table[hash];
+            table[hash] = (int32_t)pos;
+
+            if ((0 <= candidate) && (pos - (uint32_t)candidate <= HAL_LZ_MAX_DISTANCE) && (0 == memcmp(src + candidate, src + pos, HAL_LZ_MIN_MATCH)))
+            {
+                match = HAL_LZ_MIN_MATCH;
+
+                while ((pos + match < length) && (match < HAL_LZ_MAX_MATCH) && (src[candidate + match] == src[pos + match]))
+                {
+                    match++;
+                }
+            }
+        }
+
+        /*Emit the pending literals before a match or at the end of the block*/
+        if ((0 < match) || (pos == length))
+        {
+            while ((0 == overflow) && (literal_start < pos))
+            {
+                run = (pos - literal_start > HAL_LZ_MAX_LITERALS) ? HAL_LZ_MAX_LITERALS : pos - literal_start;
+
+                if (out + 1 + run > capacity)
+                {
+                    overflow = 1;
+                }
+                else
+                {
+                    dst[out++] = (uint8_t)(run - 1);
+                    memcpy(dst + out, src + literal_start, run);
+                    out += run;
+                    literal_start += run;
+                }
+            }
+        }
+
+        if (0 < match)
+        {
+            if (out + 3 > capacity)
+            {
+                overflow = 1;
+            }
+            else
+            {
+                dst[out++] = (uint8_t)(0x80 | (match - HAL_LZ_MIN_MATCH));
+                dst[out++] = (uint8_t)(pos - (uint32_t)candidate);
+                dst[out++] = (uint8_t)((pos - (uint32_t)candidate) >> 8);
+            }
+
+            pos += match;
+            literal_start = pos;
+        }
+        else
+        {
+            pos++;
+        }
+    }
+
+    return (0 == overflow) ? out : 0;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_lz_decompress.
+* Description: Replay the literal runs and the matches, a match is copied byte
+*              by byte because it may overlap its own output.
+*
+END***************************************************************************/
+static uint32_t hal_lz_decompress(const uint8_t *src, uint32_t length, uint8_t *dst, uint32_t capacity)
+{
+    uint32_t in = 0;       /*in is the next byte of src*/
+    uint32_t out = 0;      /*out is the next byte of dst*/
+    uint32_t count = 0;    /*count is the length of the current token*/
+    uint32_t distance = 0; /*distance is the distance of the current match*/
+    uint8_t corrupted = 0; /*corrupted tells if a token goes out of the buffers*/
+
+    while ((0 == corrupted) && (in < length))
+    {
+        if (src[in] < 0x80)
+        {
+            count = (uint32_t)src[in] + 1;
+            in++;
+
+            if ((count > length - in) || (count > capacity - out))
+            {
+                corrupted = 1;
+            }
+            else
+            {
+                memcpy(dst + out, src + in, count);
+                in += count;
+                out += count;
+            }
+        }
+        else
+        {
+            count = (uint32_t)(src[in] & 0x7F) + HAL_LZ_MIN_MATCH;
+
+            if (2 > length - in - 1)
+            {
+                corrupted = 1;
+            }
+            else
+            {
+                distance = (uint32_t)src[in + 1] | ((uint32_t)src[in + 2] << 8);
+                in += 3;
+
+                if ((0 == distance) || (distance > out) || (count > capacity - out))
+                {
+                    corrupted = 1;
+                }
+                else
+                {
+                    for (; 0 < count; count--)
+                    {
+                        dst[out] = dst[out - distance];
+                        out++;
+                    }
+                }
+            }
+        }
+    }
+
+    return (0 == corrupted) ? out : 0;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_chunk_length.
+* Description: Return chunk_size, or what is left of the image for the last chunk.
+*
+END***************************************************************************/
+static uint32_t hal_cimg_chunk_length(const hal_cimg_backend_struct_t *cimg, uint32_t chunk)
+{
+    uint64_t start = (uint64_t)chunk * cimg->chunk_size; /*start is the first byte of the chunk*/
+
+    return (cimg->image_size - start < cimg->chunk_size) ? (uint32_t)(cimg->image_size - start) : cimg->chunk_size;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_load.
+* Description: Return the slot that holds the chunk, or read the chunk into the
+*              least recently used slot (decompressing it if it is LZ).
+*
+END***************************************************************************/
+static const uint8_t *hal_cimg_load(hal_cimg_backend_struct_t *cimg, uint32_t chunk)
+{
+    hal_cimg_slot_struct_t *slot = &cimg->slot[0]; /*slot is the slot that holds the chunk*/
+    const uint8_t *data = NULL;                    /*data points to the decompressed chunk*/
+    struct iovec iov;                              /*iov describes the buffer of the stored bytes*/
+    uint32_t length = 0;                           /*length is the decompressed length of the chunk*/
+    uint32_t i = 0;                                /*i used for traversaling the slots*/
+
+    cimg->clock++;
+
+    /*Find the chunk, or the oldest slot*/
+    for (i = 0; i < HAL_CIMG_CHUNK_SLOTS; i++)
+    {
+        if (chunk == cimg->slot[i].chunk)
+        {
+            slot = &cimg->slot[i];
+            break;
+        }
+        else if (cimg->slot[i].stamp < slot->stamp)
+        {
+            slot = &cimg->slot[i];
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    if (chunk == slot->chunk)
+    {
+        data = slot->data;
+    }
+    else
+    {
+        length = hal_cimg_chunk_length(cimg, chunk);
+        slot->chunk = HAL_CIMG_NO_CHUNK;
+
+        /*A raw chunk is read in place, an LZ chunk goes through the packed buffer*/
+        iov.iov_base = (KMC_CIMG_CHUNK_RAW == cimg->type[chunk]) ? slot->data : cimg->packed;
+        iov.iov_len = cimg->stored[chunk];
+
+        if (cimg->src_ops->read(cimg->src_ctx, &iov, 1, cimg->offset[chunk]) != iov.iov_len)
+        {
+            /*Do nothing*/
+        }
+        else if ((KMC_CIMG_CHUNK_LZ == cimg->type[chunk]) && (length != hal_lz_decompress(cimg->packed, cimg->stored[chunk], slot->data, cimg->chunk_size)))
+        {
+            /*Do nothing*/
+        }
+        else
+        {
+            slot->chunk = chunk;
+            data = slot->data;
+        }
+    }
+
+    slot->stamp = cimg->clock;
+
+    return data;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_load_index.
+* Description: Check the header, then load the index and check that every chunk
+*              is inside the container and has a sane length.
+*
+END***************************************************************************/
+static int32_t hal_cimg_load_index(hal_cimg_backend_struct_t *cimg)
+{
+    uint8_t header[HAL_CIMG_HEADER_SIZE]; /*header stores the header of the container*/
+    uint8_t *index = NULL;                /*index stores the raw index of the container*/
+    uint64_t container_size = 0;          /*container_size is the size of the container*/
+    uint64_t index_end = 0;               /*index_end is the first byte of the payload*/
+    uint32_t length = 0;                  /*length is the decompressed length of a chunk*/
+    int32_t result = -1;                  /*result stores the result of the check*/
+    uint32_t i = 0;                       /*i used for traversaling the chunks*/
+    struct iovec iov;                     /*iov describes the buffer of a read*/
+
+    container_size = cimg->src_ops->get_size(cimg->src_ctx);
+
+    iov.iov_base = header;
+    iov.iov_len = HAL_CIMG_HEADER_SIZE;
+
+    if ((HAL_CIMG_HEADER_SIZE == cimg->src_ops->read(cimg->src_ctx, &iov, 1, 0)) && (0 == memcmp(header, HAL_CIMG_MAGIC, HAL_CIMG_MAGIC_SIZE)))
+    {
+        cimg->chunk_size = hal_cimg_get32(header + 8);
+        cimg->chunk_count = hal_cimg_get32(header + 12);
+        cimg->image_size = hal_cimg_get64(header + 16);
+        index_end = HAL_CIMG_HEADER_SIZE + (uint64_t)cimg->chunk_count * HAL_CIMG_INDEX_ENTRY_SIZE;
+
+        /*The chunks must cover the image exactly*/
+        if ((KMC_CIMG_MIN_CHUNK_SIZE <= cimg->chunk_size) && (KMC_CIMG_MAX_CHUNK_SIZE >= cimg->chunk_size) &&
+            (0 == cimg->chunk_size % KMC_DEFAULT_SECTOR_SIZE) && (index_end <= container_size) &&
+            ((cimg->image_size + cimg->chunk_size - 1) / cimg->chunk_size == cimg->chunk_count))
+        {
+            index = (uint8_t *)malloc((size_t)cimg->chunk_count * HAL_CIMG_INDEX_ENTRY_SIZE + 1);
+            cimg->offset = (uint64_t *)malloc(sizeof(uint64_t) * cimg->chunk_count + 1);
+            cimg->stored = (uint32_t *)malloc(sizeof(uint32_t) * cimg->chunk_count + 1);
+            cimg->type = (uint8_t *)malloc(cimg->chunk_count + 1);
+        }
+    }
+
+    if ((NULL != index) && (NULL != cimg->offset) && (NULL != cimg->stored) && (NULL != cimg->type))
+    {
+        iov.iov_base = index;
+        iov.iov_len = (size_t)cimg->chunk_count * HAL_CIMG_INDEX_ENTRY_SIZE;
+
+        if (iov.iov_len == cimg->src_ops->read(cimg->src_ctx, &iov, 1, HAL_CIMG_HEADER_SIZE))
+        {
+            result = 0;
+        }
+
+        for (i = 0; (i < cimg->chunk_count) && (0 == result); i++)
+        {
+            cimg->offset[i] = hal_cimg_get64(index + (size_t)i * HAL_CIMG_INDEX_ENTRY_SIZE);
+            cimg->stored[i] = hal_cimg_get32(index + (size_t)i * HAL_CIMG_INDEX_ENTRY_SIZE + 8);
+            cimg->type[i] = (uint8_t)hal_cimg_get32(index + (size_t)i * HAL_CIMG_INDEX_ENTRY_SIZE + 12);
+            length = hal_cimg_chunk_length(cimg, i);
+
+            switch (cimg->type[i])
+            {
+            case KMC_CIMG_CHUNK_ZERO:
+            {
+                break;
+            }
+            case KMC_CIMG_CHUNK_FILL:
+            {
+                result = (0xFF >= cimg->stored[i]) ? 0 : -1;
+                break;
+            }
+            case KMC_CIMG_CHUNK_RAW:
+            case KMC_CIMG_CHUNK_LZ:
+            {
+                /*The stored bytes must lie in the payload*/
+                if ((cimg->offset[i] < index_end) || (cimg->offset[i] > container_size) || (cimg->stored[i] > container_size - cimg->offset[i]))
+                {
+                    result = -1;
+                }
+                else if ((KMC_CIMG_CHUNK_RAW == cimg->type[i]) ? (length != cimg->stored[i]) : (cimg->chunk_size < cimg->stored[i]))
+                {
+                    result = -1;
+                }
+                else
+                {
+                    /*Do nothing*/
+                }
+                break;
+            }
+            default:
+            {
+                result = -1;
+                break;
+            }
+            }
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    free(index);
+
+    return result;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_read.
+* Description: Fill the buffers chunk by chunk: zero and fill chunks are set
+*              without reading the container, the others are decompressed in
+*              a slot and copied. Stop at the end of the image or at the first
+*              chunk that can not be read.
+*
+END***************************************************************************/
+static size_t hal_cimg_read(void *ctx, const struct iovec *iov, uint32_t iov_count, uint64_t offset)
+{
+    hal_cimg_backend_struct_t *cimg = (hal_cimg_backend_struct_t *)ctx; /*cimg is the state of the backend*/
+    const uint8_t *data = NULL;                                        /*data points to a decompressed chunk*/
+    uint8_t *buff = NULL;                                              /*buff is the next byte to fill*/
+    size_t total_bytes = 0;                                            /*total_bytes stores the num of bytes read successfully*/
+    size_t done = 0;                                                   /*done stores the bytes already in the current buffer*/
+    size_t length = 0;                                                 /*length stores the bytes taken from 1 chunk*/
+    uint32_t chunk = 0;                                                /*chunk is the chunk that holds offset*/
+    uint32_t in_chunk = 0;                                             /*in_chunk is the position of offset in its chunk*/
+    uint8_t failed = 0;                                                /*failed tells if a chunk could not be read*/
+    uint32_t i = 0;                                                    /*i used for traversaling the buffers*/
+
+    for (i = 0; (i < iov_count) && (0 == failed); i++)
+    {
+        buff = (uint8_t *)iov[i].iov_base;
+
+        for (done = 0; (done < iov[i].iov_len) && (offset < cimg->image_size) && (0 == failed); done += length)
+        {
+            chunk = (uint32_t)(offset / cimg->chunk_size);
+            in_chunk = (uint32_t)(offset % cimg->chunk_size);
+            length = hal_cimg_chunk_length(cimg, chunk) - in_chunk;
+
+            if (length > iov[i].iov_len - done)
+            {
+                length = iov[i].iov_len - done;
+            }
+
+            switch (cimg->type[chunk])
+            {
+            case KMC_CIMG_CHUNK_ZERO:
+            {
+                memset(buff + done, 0, length);
+                break;
+            }
+            case KMC_CIMG_CHUNK_FILL:
+            {
+                memset(buff + done, (int)cimg->stored[chunk], length);
+                break;
+            }
+            default:
+            {
+                data = hal_cimg_load(cimg, chunk);
+
+                if (NULL != data)
+                {
+                    memcpy(buff + done, data + in_chunk, length);
+                }
+                else
+                {
+                    failed = 1;
+                    length = 0;
+                }
+                break;
+            }
+            }
+
+            offset += length;
+            total_bytes += length;
+        }
+
+        /*Stop at the end of the image*/
+        if (done < iov[i].iov_len)
+        {
+            break;
+        }
+    }
+
+    return total_bytes;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_get_size.
+* Description: Return the size of the raw image.
+*
+END***************************************************************************/
+static uint64_t hal_cimg_get_size(void *ctx)
+{
+    return ((hal_cimg_backend_struct_t *)ctx)->image_size;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_close.
+* Description: Free the index and the slots, close the container.
+*
+END***************************************************************************/
+static void hal_cimg_close(void *ctx)
+{
+    hal_cimg_backend_struct_t *cimg = (hal_cimg_backend_struct_t *)ctx; /*cimg is the state of the backend*/
+    uint32_t i = 0;                                                    /*i used for traversaling the slots*/
+
+    for (i = 0; i < HAL_CIMG_CHUNK_SLOTS; i++)
+    {
+        free(cimg->slot[i].data);
+    }
+
+    free(cimg->offset);
+    free(cimg->stored);
+    free(cimg->type);
+    free(cimg->packed);
+
+    cimg->src_ops->close(cimg->src_ctx);
+
+    free(cimg);
+
+    return;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_cimg_is_zero.
+* Description: Return 1 if every chunk the range touches is a zero chunk, the
+*              index answers without reading the container.
+*
+END***************************************************************************/
+static uint8_t hal_cimg_is_zero(void *ctx, uint64_t offset, uint64_t length)
+{
+    hal_cimg_backend_struct_t *cimg = (hal_cimg_backend_struct_t *)ctx; /*cimg is the state of the backend*/
+    uint8_t is_zero = 0;                                               /*is_zero stores the result*/
+    uint32_t chunk = 0;                                                /*chunk is used for traversaling the chunks*/
+    uint32_t last = 0;                                                 /*last is the last chunk of the range*/
+
+    if ((0 < length) && (offset <= cimg->image_size) && (length <= cimg->image_size - offset))
+    {
+        chunk = (uint32_t)(offset / cimg->chunk_size);
+        last = (uint32_t)((offset + length - 1) / cimg->chunk_size);
+        is_zero = 1;
+
+        for (; (chunk <= last) && (1 == is_zero); chunk++)
+        {
+            is_zero = ((KMC_CIMG_CHUNK_ZERO == cimg->type[chunk]) || ((KMC_CIMG_CHUNK_FILL == cimg->type[chunk]) && (0 == cimg->stored[chunk]))) ? 1 : 0;
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return is_zero;
+}
+
+/*******************************************************************************
+ * Functions
+ ******************************************************************************/
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_cimg_convert.
+* Description: Write the header and an empty index, append every chunk in its
+*              smallest form, then write the final index over the empty one.
+*
+END***************************************************************************/
+int32_t kmc_cimg_convert(const uint8_t *raw_name, const uint8_t *cimg_name, uint32_t chunk_size, kmc_cimg_convert_stats_struct_t *stats)
+{
+    kmc_cimg_convert_stats_struct_t result;     /*result stores the counters of the conversion*/
+    const kmc_backend_ops_struct_t *raw = NULL; /*raw is the backend of the raw image*/
+    void *raw_ctx = NULL;                       /*raw_ctx is the state of the raw image backend*/
+    struct iovec iov;                           /*iov describes the buffer of 1 chunk read*/
+    FILE *cimg = NULL;                          /*cimg is the container*/
+    uint8_t header[HAL_CIMG_HEADER_SIZE];       /*header stores the header of the container*/
+    uint8_t *index = NULL;                      /*index stores the index of the container*/
+    uint8_t *chunk = NULL;                      /*chunk stores 1 raw chunk*/
+    uint8_t *packed = NULL;                     /*packed stores 1 compressed chunk*/
+    const uint8_t *stored = NULL;               /*stored points to the bytes appended for 1 chunk*/
+    uint64_t offset = 0;                        /*offset is the container offset of the next chunk*/
+    uint32_t length = 0;                        /*length is the length of the current chunk*/
+    uint32_t stored_size = 0;                   /*stored_size is the stored length (fill value) of the chunk*/
+    uint32_t type = 0;                          /*type is the kmc_cimg_chunk_type_enum_t of the chunk*/
+    uint32_t i = 0;                             /*i used for traversaling the chunks*/
+    uint32_t j = 0;                             /*j used for traversaling the bytes of a chunk*/
+    int32_t status = -1;                        /*status stores the result of the conversion*/
+
+    memset(&result, 0, sizeof(result));
+
+    if (0 == chunk_size)
+    {
+        chunk_size = KMC_CIMG_DEFAULT_CHUNK_SIZE;
+    }
+
+    if ((KMC_CIMG_MIN_CHUNK_SIZE <= chunk_size) && (KMC_CIMG_MAX_CHUNK_SIZE >= chunk_size) && (0 == chunk_size % KMC_DEFAULT_SECTOR_SIZE))
+    {
+        raw = hal_backend_open_file(raw_name, KMC_ACCESS_PREAD, &raw_ctx);
+    }
+
+    if (NULL != raw)
+    {
+        result.image_size = raw->get_size(raw_ctx);
+    }
+
+    if (0 < result.image_size)
+    {
+        result.chunk_count = (uint32_t)((result.image_size + chunk_size - 1) / chunk_size);
+
+        index = (uint8_t *)calloc(result.chunk_count, HAL_CIMG_INDEX_ENTRY_SIZE);
+        chunk = (uint8_t *)malloc(chunk_size);
+        packed = (uint8_t *)malloc(chunk_size);
+        cimg = fopen((const char *)cimg_name, "wb");
+    }
+
+    if ((NULL != index) && (NULL != chunk) && (NULL != packed) && (NULL != cimg))
+    {
+        memset(header, 0, sizeof(header));
+        memcpy(header, HAL_CIMG_MAGIC, HAL_CIMG_MAGIC_SIZE);
+        hal_cimg_put32(header + 8, chunk_size);
+        hal_cimg_put32(header + 12, result.chunk_count);
+        hal_cimg_put64(header + 16, result.image_size);
+
+        offset = HAL_CIMG_HEADER_SIZE + (uint64_t)result.chunk_count * HAL_CIMG_INDEX_ENTRY_SIZE;
+
+        /*The index is written again once the offsets are known*/
+        if ((1 == fwrite(header, HAL_CIMG_HEADER_SIZE, 1, cimg)) && (1 == fwrite(index, (size_t)(offset - HAL_CIMG_HEADER_SIZE), 1, cimg)))
+        {
+            status = 0;
+        }
+
+        for (i = 0; (i < result.chunk_count) && (0 == status); i++)
+        {
+            length = ((result.image_size - (uint64_t)i * chunk_size) < chunk_size) ? (uint32_t)(result.image_size - (uint64_t)i * chunk_size) : chunk_size;
+
+            iov.iov_base = chunk;
+            iov.iov_len = length;
+
+            if (length != raw->read(raw_ctx, &iov, 1, (uint64_t)i * chunk_size))
+            {
+                status = -1;
+                break;
+            }
+
+            /*Check if every byte has the value of the first one*/
+            j = 1;
+
+            while ((j < length) && (chunk[j] == chunk[0]))
+            {
+                j++;
+            }
+
+            stored = NULL;
+
+            if ((j == length) && (0 == chunk[0]))
+            {
+                type = KMC_CIMG_CHUNK_ZERO;
+                stored_size = 0;
+                result.zero_chunks++;
+            }
+            else if (j == length)
+            {
+                type = KMC_CIMG_CHUNK_FILL;
+                stored_size = chunk[0];
+                result.fill_chunks++;
+            }
+            else
+            {
+                /*Keep the chunk raw if LZ does not make it smaller*/
+                stored_size = hal_lz_compress(chunk, length, packed, length - 1);
+
+                if (0 < stored_size)
+                {
+                    type = KMC_CIMG_CHUNK_LZ;
+                    stored = packed;
+                    result.lz_chunks++;
+                }
+                else
+                {
+                    type = KMC_CIMG_CHUNK_RAW;
+                    stored = chunk;
+                    stored_size = length;
+                    result.raw_chunks++;
+                }
+            }
+
+            hal_cimg_put64(index + (size_t)i * HAL_CIMG_INDEX_ENTRY_SIZE, (NULL != stored) ? offset : 0);
+            hal_cimg_put32(index + (size_t)i * HAL_CIMG_INDEX_ENTRY_SIZE + 8, stored_size);
+            hal_cimg_put32(index + (size_t)i * HAL_CIMG_INDEX_ENTRY_SIZE + 12, type);
+
+            if (NULL != stored)
+            {
+                if (1 != fwrite(stored, stored_size, 1, cimg))
+                {
+                    status = -1;
+                }
+
+                offset += stored_size;
+            }
+        }
+
+        /*Write the final index*/
+        if ((0 == status) && ((0 != fseek(cimg, HAL_CIMG_HEADER_SIZE, SEEK_SET)) || (1 != fwrite(index, (size_t)result.chunk_count * HAL_CIMG_INDEX_ENTRY_SIZE, 1, cimg))))
+        {
+            status = -1;
+        }
+
+        result.container_size = offset;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    if ((NULL != cimg) && (0 != fclose(cimg)))
+    {
+        status = -1;
+    }
+
+    if (NULL != raw)
+    {
+        raw->close(raw_ctx);
+    }
+
+    free(index);
+    free(chunk);
+    free(packed);
+
+    if ((0 == status) && (NULL != stats))
+    {
+        *stats = result;
+    }
+
+    return status;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_cimg_open.
+* Description: Open the container with the file backend, load its index and
+*              return a handle that decompresses the chunks on demand.
+*
+END***************************************************************************/
+kmc_dev_t *kmc_cimg_open(const uint8_t *cimg_name)
+{
+    hal_cimg_backend_struct_t *cimg = NULL; /*cimg stores the state of the backend*/
+    kmc_dev_t *dev = NULL;                  /*dev stores the new handle*/
+    uint8_t failed = 0;                     /*failed tells if the container can not be used*/
+    uint32_t i = 0;                         /*i used for traversaling the slots*/
+
+    cimg = (hal_cimg_backend_struct_t *)calloc(1, sizeof(hal_cimg_backend_struct_t));
+
+    if (NULL != cimg)
+    {
+        cimg->src_ops = hal_backend_open_file(cimg_name, KMC_ACCESS_PREAD, &cimg->src_ctx);
+    }
+
+    if ((NULL == cimg) || (NULL == cimg->src_ops))
+    {
+        free(cimg);
+    }
+    else
+    {
+        failed = (0 == hal_cimg_load_index(cimg)) ? 0 : 1;
+
+        if (0 == failed)
+        {
+            cimg->packed = (uint8_t *)malloc(cimg->chunk_size);
+            failed = (NULL == cimg->packed) ? 1 : 0;
+        }
+
+        for (i = 0; (i < HAL_CIMG_CHUNK_SLOTS) && (0 == failed); i++)
+        {
+            cimg->slot[i].chunk = HAL_CIMG_NO_CHUNK;
+            cimg->slot[i].data = (uint8_t *)malloc(cimg->chunk_size);
+            failed = (NULL == cimg->slot[i].data) ? 1 : 0;
+        }
+
+        if (0 == failed)
+        {
+            dev = kmc_open_backend(&s_cimg_ops, cimg);
+        }
+
+        if (NULL == dev)
+        {
+            hal_cimg_close(cimg);
+        }
+    }
+
+    return dev;
+}
+/*End of file*/
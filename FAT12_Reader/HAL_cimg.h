@@ -0,0 +1,96 @@
+/**
+ * @file  : HAL_cimg.h
+ * @author: Nguyen The Anh.
+ * @brief : Declare struct, typedef and function using in HAL_cimg.c.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdint.h>
+#include "HAL.h"
+
+/*******************************************************************************
+ * Header guard
+ ******************************************************************************/
+
+#ifndef _HAL_CIMG_H_
+#define _HAL_CIMG_H_
+
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+/*Chunk size used when the converter is given 0, 8 sectors of 512 bytes*/
+#define KMC_CIMG_DEFAULT_CHUNK_SIZE 4096
+
+/*Bounds of the chunk size, a multiple of KMC_DEFAULT_SECTOR_SIZE*/
+#define KMC_CIMG_MIN_CHUNK_SIZE 512
+#define KMC_CIMG_MAX_CHUNK_SIZE 65536
+
+/*******************************************************************************
+ * Enum
+ ******************************************************************************/
+
+/*How 1 chunk is stored in the container*/
+typedef enum kmc_cimg_chunk_type
+{
+    KMC_CIMG_CHUNK_ZERO = 0, /*every byte is 0, nothing is stored*/
+    KMC_CIMG_CHUNK_FILL = 1, /*every byte has the same value, kept in the index*/
+    KMC_CIMG_CHUNK_RAW = 2,  /*stored as is, it does not compress*/
+    KMC_CIMG_CHUNK_LZ = 3    /*compressed with the built-in LZ codec*/
+} kmc_cimg_chunk_type_enum_t;
+
+/*******************************************************************************
+ * Struct
+ ******************************************************************************/
+
+/*Result of a conversion*/
+typedef struct kmc_cimg_convert_stats
+{
+    uint64_t image_size;     /*size of the raw image in bytes*/
+    uint64_t container_size; /*size of the container in bytes*/
+    uint32_t chunk_count;    /*number of chunks*/
+    uint32_t zero_chunks;    /*chunks stored as KMC_CIMG_CHUNK_ZERO*/
+    uint32_t fill_chunks;    /*chunks stored as KMC_CIMG_CHUNK_FILL*/
+    uint32_t raw_chunks;     /*chunks stored as KMC_CIMG_CHUNK_RAW*/
+    uint32_t lz_chunks;      /*chunks stored as KMC_CIMG_CHUNK_LZ*/
+} kmc_cimg_convert_stats_struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Convert a raw disk image into a compressed image container. The image is cut into fixed
+ *        size chunks, each chunk is stored as zero, fill, raw or LZ compressed, and an index of the
+ *        chunk offsets follows the header so any chunk can be found without reading the others.
+ *
+ * @param raw_name the name of the raw image.
+ * @param cimg_name the name of the container to create (overwritten if it exists).
+ * @param chunk_size the size of 1 chunk in bytes (0 uses KMC_CIMG_DEFAULT_CHUNK_SIZE).
+ * @param stats stores the result of the conversion, may be NULL.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int32_t kmc_cimg_convert(const uint8_t *raw_name, const uint8_t *cimg_name, uint32_t chunk_size, kmc_cimg_convert_stats_struct_t *stats);
+
+/**
+ * @brief Open a compressed image container read only. A read decompresses only the chunks that hold
+ *        the requested sectors, the last decompressed chunks are kept to serve the next reads.
+ *        The handle must not be used by several threads at once.
+ *
+ * @param cimg_name the name of the container.
+ *
+ * @return the handle of the disk image, NULL if the container failed to open or is not valid.
+ */
+kmc_dev_t *kmc_cimg_open(const uint8_t *cimg_name);
+
+/*Header guard*/
+#endif
+/*End of file*/
@@ -0,0 +1,264 @@
+/**
+ * @file  : HAL_mbr.c
+ * @author: Nguyen The Anh.
+ * @brief : Definition of the MBR partition table parsing.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "HAL.h"
+#include "HAL_priv.h"
+#include "HAL_mbr.h"
+
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+/*Layout of an MBR (and of an extended boot record)*/
+#define HAL_MBR_TABLE_OFFSET 0x1BE
+#define HAL_MBR_ENTRY_SIZE 16
+#define HAL_MBR_ENTRIES 4
+#define HAL_MBR_SIGNATURE_OFFSET 0x1FE
+
+/*Fields of 1 partition entry*/
+#define HAL_MBR_ENTRY_STATUS 0
+#define HAL_MBR_ENTRY_TYPE 4
+#define HAL_MBR_ENTRY_LBA 8
+#define HAL_MBR_ENTRY_COUNT 12
+
+/*Partition types of an extended partition (CHS, LBA, Linux)*/
+#define HAL_MBR_IS_EXTENDED(type) ((0x05 == (type)) || (0x0F == (type)) || (0x85 == (type)))
+
+/*******************************************************************************
+ * Static function prototype
+ ******************************************************************************/
+
+/**
+ * @brief Read 1 partition table sector of the image, whatever the sector size of the handle is.
+ *
+ * @param dev the handle of the whole-disk image.
+ * @param lba the sector to read, in KMC_MBR_SECTOR_SIZE units.
+ * @param buff the buffer that stores the sector.
+ *
+ * @return 1 if the sector is read and carries the 0x55AA signature, 0 otherwise.
+ */
+static uint8_t hal_mbr_read_table(kmc_dev_t *dev, uint64_t lba, uint8_t *buff);
+
+/**
+ * @brief Load a 32 bits little endian value.
+ *
+ * @param buff the source.
+ *
+ * @return the value.
+ */
+static uint32_t hal_mbr_get32(const uint8_t *buff);
+
+/*******************************************************************************
+ * Static functions
+ ******************************************************************************/
+
+/*Static functions*************************************************************
+*
+* Function name: hal_mbr_read_table.
+* Description: Read the sector from the backend and check its signature.
+*
+END***************************************************************************/
+static uint8_t hal_mbr_read_table(kmc_dev_t *dev, uint64_t lba, uint8_t *buff)
+{
+    struct iovec iov; /*iov describes the buffer*/
+
+    iov.iov_base = buff;
+    iov.iov_len = KMC_MBR_SECTOR_SIZE;
+
+    return ((KMC_MBR_SECTOR_SIZE == dev->ops->read(dev->ctx, &iov, 1, lba * KMC_MBR_SECTOR_SIZE)) &&
+            (0x55 == buff[HAL_MBR_SIGNATURE_OFFSET]) && (0xAA == buff[HAL_MBR_SIGNATURE_OFFSET + 1])) ? 1 : 0;
+}
+
+/*Static functions*************************************************************
+*
+* Function name: hal_mbr_get32.
+* Description: Load a 32 bits little endian value.
+*
+END***************************************************************************/
+static uint32_t hal_mbr_get32(const uint8_t *buff)
+{
+    return (uint32_t)buff[0] | ((uint32_t)buff[1] << 8) | ((uint32_t)buff[2] << 16) | ((uint32_t)buff[3] << 24);
+}
+
+/*******************************************************************************
+ * Functions
+ ******************************************************************************/
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_mbr_read_partitions.
+* Description: Check the 4 primary entries (status 0x00/0x80, a used entry lies
+*              inside the image), store the used ones, then follow the chain
+*              of extended boot records of the extended partition.
+*
+END***************************************************************************/
+int32_t kmc_mbr_read_partitions(kmc_dev_t *dev, kmc_partition_struct_t *partitions, uint32_t max_count)
+{
+    uint8_t sector[KMC_MBR_SECTOR_SIZE]; /*sector stores the MBR, then each extended boot record*/
+    const uint8_t *entry = NULL;         /*entry points to the current partition entry*/
+    kmc_partition_struct_t partition;    /*partition stores the entry being parsed*/
+    uint64_t disk_sectors = 0;           /*disk_sectors is the size of the image in sectors*/
+    uint64_t extended_lba = 0;           /*extended_lba is the first sector of the extended partition*/
+    uint64_t ebr_lba = 0;                /*ebr_lba is the sector of the current extended boot record*/
+    int32_t count = -1;                  /*count stores the number of partitions stored*/
+    uint32_t logical = 0;                /*logical is the number of logical partitions found*/
+    uint32_t records = 0;                /*records is the number of extended boot records followed*/
+    uint32_t i = 0;                      /*i used for traversaling the entries*/
+
+    if ((NULL != dev) && (1 == hal_mbr_read_table(dev, 0, sector)))
+    {
+        disk_sectors = kmc_get_size(dev) / KMC_MBR_SECTOR_SIZE;
+        count = 0;
+
+        /*A boot sector of a volume has code where the table is, reject it*/
+        for (i = 0; (i < HAL_MBR_ENTRIES) && (0 <= count); i++)
+        {
+            entry = sector + HAL_MBR_TABLE_OFFSET + i * HAL_MBR_ENTRY_SIZE;
+
+            if ((0x00 != entry[HAL_MBR_ENTRY_STATUS]) && (0x80 != entry[HAL_MBR_ENTRY_STATUS]))
+            {
+                count = -1;
+            }
+            else if ((0 != entry[HAL_MBR_ENTRY_TYPE]) &&
+                     ((0 == hal_mbr_get32(entry + HAL_MBR_ENTRY_LBA)) || (0 == hal_mbr_get32(entry + HAL_MBR_ENTRY_COUNT)) ||
+                      ((uint64_t)hal_mbr_get32(entry + HAL_MBR_ENTRY_LBA) >= disk_sectors)))
+            {
+                count = -1;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+
+        for (i = 0; (i < HAL_MBR_ENTRIES) && (0 <= count); i++)
+        {
+            entry = sector + HAL_MBR_TABLE_OFFSET + i * HAL_MBR_ENTRY_SIZE;
+
+            if (0 == entry[HAL_MBR_ENTRY_TYPE])
+            {
+                /*Do nothing*/
+            }
+            else if (HAL_MBR_IS_EXTENDED(entry[HAL_MBR_ENTRY_TYPE]))
+            {
+                /*Only 1 extended partition is followed*/
+                if (0 == extended_lba)
+                {
+                    extended_lba = hal_mbr_get32(entry + HAL_MBR_ENTRY_LBA);
+                }
+            }
+            else if ((uint32_t)count < max_count)
+            {
+                partition.number = i + 1;
+                partition.type = entry[HAL_MBR_ENTRY_TYPE];
+                partition.bootable = (0x80 == entry[HAL_MBR_ENTRY_STATUS]) ? 1 : 0;
+                partition.first_lba = hal_mbr_get32(entry + HAL_MBR_ENTRY_LBA);
+                partition.sector_count = hal_mbr_get32(entry + HAL_MBR_ENTRY_COUNT);
+                partition.base_offset = partition.first_lba * KMC_MBR_SECTOR_SIZE;
+                partition.length = partition.sector_count * KMC_MBR_SECTOR_SIZE;
+
+                partitions[count++] = partition;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+
+        /*Each extended boot record holds 1 logical partition (relative to the record) and the link
+          to the next record (relative to the extended partition)*/
+        ebr_lba = extended_lba;
+
+        while (0 <= count)
+        {
+            if ((0 == ebr_lba) || (KMC_MBR_MAX_LOGICAL <= records) || (0 == hal_mbr_read_table(dev, ebr_lba, sector)))
+            {
+                break;
+            }
+
+            entry = sector + HAL_MBR_TABLE_OFFSET;
+
+            if ((0 != entry[HAL_MBR_ENTRY_TYPE]) && (0 != hal_mbr_get32(entry + HAL_MBR_ENTRY_COUNT)) && ((uint32_t)count < max_count))
+            {
+                partition.number = HAL_MBR_ENTRIES + 1 + logical;
+                partition.type = entry[HAL_MBR_ENTRY_TYPE];
+                partition.bootable = (0x80 == entry[HAL_MBR_ENTRY_STATUS]) ? 1 : 0;
+                partition.first_lba = ebr_lba + hal_mbr_get32(entry + HAL_MBR_ENTRY_LBA);
+                partition.sector_count = hal_mbr_get32(entry + HAL_MBR_ENTRY_COUNT);
+                partition.base_offset = partition.first_lba * KMC_MBR_SECTOR_SIZE;
+                partition.length = partition.sector_count * KMC_MBR_SECTOR_SIZE;
+
+                partitions[count++] = partition;
+                logical++;
+            }
+            else
+            {
+                /*Do nothing, an empty record takes no number*/
+            }
+
+            records++;
+
+            /*The link of the last record is empty*/
+            entry = sector + HAL_MBR_TABLE_OFFSET + HAL_MBR_ENTRY_SIZE;
+            ebr_lba = (HAL_MBR_IS_EXTENDED(entry[HAL_MBR_ENTRY_TYPE]) && (0 != hal_mbr_get32(entry + HAL_MBR_ENTRY_LBA))) ? extended_lba + hal_mbr_get32(entry + HAL_MBR_ENTRY_LBA) : 0;
+        }
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return count;
+}
+
+/*Functions*********************************************************************
+*
+* Function name: kmc_mbr_open_partition.
+* Description: Find the partition in the table and open a region on it.
+*
+END***************************************************************************/
+kmc_dev_t *kmc_mbr_open_partition(kmc_dev_t *dev, uint32_t number)
+{
+    kmc_partition_struct_t *partitions = NULL; /*partitions stores the partition table*/
+    kmc_dev_t *volume = NULL;                  /*volume stores the handle of the partition*/
+    int32_t count = 0;                         /*count stores the number of partitions*/
+    int32_t i = 0;                             /*i used for traversaling the partitions*/
+
+    partitions = (kmc_partition_struct_t *)malloc(sizeof(kmc_partition_struct_t) * (HAL_MBR_ENTRIES + KMC_MBR_MAX_LOGICAL));
+
+    if (NULL != partitions)
+    {
+        count = kmc_mbr_read_partitions(dev, partitions, HAL_MBR_ENTRIES + KMC_MBR_MAX_LOGICAL);
+
+        for (i = 0; i < count; i++)
+        {
+            if (number == partitions[i].number)
+            {
+                volume = kmc_open_region(dev, partitions[i].base_offset, partitions[i].length);
+                break;
+            }
+        }
+
+        free(partitions);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return volume;
+}
+/*End of file*/
@@ -0,0 +1,81 @@
+/**
+ * @file  : HAL_mbr.h
+ * @author: Nguyen The Anh.
+ * @brief : Declare struct, typedef and function using in HAL_mbr.c.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdint.h>
+#include "HAL.h"
+
+/*******************************************************************************
+ * Header guard
+ ******************************************************************************/
+
+#ifndef _HAL_MBR_H_
+#define _HAL_MBR_H_
+
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+/*Size of the sectors the partition table counts in*/
+#define KMC_MBR_SECTOR_SIZE 512
+
+/*Upper bound of the logical partitions followed in an extended partition*/
+#define KMC_MBR_MAX_LOGICAL 128
+
+/*******************************************************************************
+ * Struct
+ ******************************************************************************/
+
+/*1 partition of the MBR partition table*/
+typedef struct kmc_partition
+{
+    uint32_t number;       /*1 to 4 for the primary partitions, 5 and more for the logical ones*/
+    uint8_t type;          /*partition type (0x01 FAT12, 0x04/0x06/0x0E FAT16, 0x0B/0x0C FAT32, ...)*/
+    uint8_t bootable;      /*1 if the partition is marked active*/
+    uint64_t first_lba;    /*first sector of the partition in the image*/
+    uint64_t sector_count; /*number of sectors of the partition*/
+    uint64_t base_offset;  /*byte offset of the partition in the image*/
+    uint64_t length;       /*byte length of the partition*/
+} kmc_partition_struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Parse the MBR partition table of a whole-disk image. The primary partitions come first,
+ *        then the logical partitions of the extended partition in chain order. The extended
+ *        partition itself is not listed.
+ *
+ * @param dev the handle of the whole-disk image.
+ * @param partitions stores the partitions found.
+ * @param max_count the number of entries of partitions.
+ *
+ * @return the number of partitions stored, -1 if sector 0 is not an MBR (for example the boot
+ *         sector of a volume without partition table).
+ */
+int32_t kmc_mbr_read_partitions(kmc_dev_t *dev, kmc_partition_struct_t *partitions, uint32_t max_count);
+
+/**
+ * @brief Open a handle on 1 partition of a whole-disk image (see kmc_open_region).
+ *
+ * @param dev the handle of the whole-disk image.
+ * @param number the number of the partition (kmc_partition_struct_t.number).
+ *
+ * @return the handle of the partition, NULL if the partition does not exist.
+ */
+kmc_dev_t *kmc_mbr_open_partition(kmc_dev_t *dev, uint32_t number);
+
+/*Header guard*/
+#endif
+/*End of file*/
@@ -0,0 +1,122 @@
+/**
+ * @file  : HAL_priv.h
+ * @author: Nguyen The Anh.
+ * @brief : Declare the layout of the disk image handle, shared by the HAL modules only.
+ * @version: 0.0
+ *
+ * @copyright Copyright (c) 2024.
+ *
+ */
+
+/*******************************************************************************
+ * Include
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "HAL.h"
+
+/*******************************************************************************
+ * Header guard
+ ******************************************************************************/
+
+#ifndef _HAL_PRIV_H_
+#define _HAL_PRIV_H_
+
+/*******************************************************************************
+ * Struct
+ ******************************************************************************/
+
+/*Sector cache: slots are found through a chained hash table and evicted with CLOCK*/
+typedef struct hal_cache
+{
+    uint32_t budget;             /*budget is the memory budget of the cached sectors in bytes*/
+    uint32_t hand;               /*hand is the CLOCK hand (next eviction candidate)*/
+    uint32_t bucket_mask;        /*bucket_mask is the number of hash buckets minus 1*/
+    uint32_t *sector;            /*sector stores the sector index held by each slot*/
+    int32_t *next;               /*next links the slots of the same bucket, -1 ends the chain*/
+    int32_t *bucket;             /*bucket stores the first slot of each hash bucket*/
+    uint8_t *referenced;         /*referenced is the CLOCK bit of each slot*/
+    uint8_t *data;               /*data stores the content of the slots*/
+    kmc_cache_stats_struct_t stats;
+} hal_cache_struct_t;
+
+/*Number of prefetches remembered to count the readahead hits*/
+#define HAL_RA_TRACKED_RANGES 8
+
+/*A prefetch of "count" reads of "num" sectors, "stride" sectors apart (0: 1 contiguous range)*/
+typedef struct hal_ra_range
+{
+    uint32_t index;
+    uint32_t num;
+    int64_t stride;
+    uint32_t count;
+} hal_ra_range_struct_t;
+
+/*Readahead engine: pattern detection state and the last prefetches*/
+typedef struct hal_readahead
+{
+    uint32_t last_index;                                 /*last_index is the first sector of the last read*/
+    uint32_t last_num;                                   /*last_num is the length of the last read*/
+    int64_t stride;                                      /*stride is the distance between the last 2 reads*/
+    int64_t frontier;                                    /*frontier is where the next prefetch of the pattern starts*/
+    uint8_t sequential;                                  /*sequential tells if the last read followed the one before*/
+    hal_ra_range_struct_t ranges[HAL_RA_TRACKED_RANGES]; /*ranges stores the last prefetches*/
+    uint32_t range_next;                                 /*range_next is the next tracked slot to overwrite*/
+    uint8_t *buffer;                                     /*buffer receives the prefetched sectors before they are cached*/
+    size_t buffer_size;                                  /*buffer_size is the size of buffer in bytes*/
+    kmc_readahead_stats_struct_t stats;
+} hal_readahead_struct_t;
+
+struct kmc_dev
+{
+    const kmc_backend_ops_struct_t *ops; /*ops is the backend serving the image*/
+    void *ctx;                           /*ctx is the state of the backend*/
+    uint32_t refs;                       /*refs is 1 plus the number of regions opened on the handle*/
+    uint16_t sector_size;                /*sector_size is the size of 1 sector of this image*/
+    hal_cache_struct_t cache;            /*cache is the sector cache of the handle*/
+    hal_readahead_struct_t ra;           /*ra is the readahead engine of the handle*/
+};
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**
+ * @brief Open an image file with the built-in file backend (positional reads) or mmap backend.
+ *
+ * @param file_name the name of the image.
+ * @param mode the access mode, KMC_ACCESS_MMAP falls back to positional reads if mapping fails.
+ * @param ctx stores the state of the backend.
+ *
+ * @return the operations of the backend, NULL if the image failed to open.
+ */
+const kmc_backend_ops_struct_t *hal_backend_open_file(const uint8_t *file_name, kmc_access_mode_enum_t mode, void **ctx);
+
+/**
+ * @brief Wrap an image already in memory with the built-in memory backend.
+ *
+ * @param image the content of the image (borrowed, not copied).
+ * @param size the size of the image in bytes.
+ * @param ctx stores the state of the backend.
+ *
+ * @return the operations of the backend, NULL if the state can not be allocated.
+ */
+const kmc_backend_ops_struct_t *hal_backend_open_memory(const uint8_t *image, size_t size, void **ctx);
+
+/**
+ * @brief Wrap a byte range of the image of a handle with the built-in region backend. The
+ *        backend reads the image through the backend of "dev" and takes a reference on "dev".
+ *
+ * @param dev the handle of the whole image.
+ * @param base_offset the byte offset of the range in the image.
+ * @param length the byte length of the range.
+ * @param ctx stores the state of the backend.
+ *
+ * @return the operations of the backend, NULL if the state can not be allocated.
+ */
+const kmc_backend_ops_struct_t *hal_backend_open_region(kmc_dev_t *dev, uint64_t base_offset, uint64_t length, void **ctx);
+
+/*Header guard*/
+#endif
+/*End of file*/
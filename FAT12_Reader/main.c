@@ -20,6 +20,13 @@
 
 #include "FATfs.h"
 
+/*******************************************************************************
+ * Macro
+ ******************************************************************************/
+
+/*Memory budget of the sector cache, enough for the root directory and the hot subdirectories*/
+#define APP_SECTOR_CACHE_BYTES (64 * 1024)
+
 /*******************************************************************************
  * Variable
  ******************************************************************************/
@@ -85,13 +92,13 @@ void app_print_entry_list(fatfs_entry_list_struct_t *entry_list)
         if (FOLDER_ENTRY == entry_list->attribute[i])
         {
             strcpy(type, "Folder");
-            printf("\n|  %4d     |%12s           |%-6s       |         %c       |", i + 1, entry_list->entry_name[i], type, '#');
+            printf("\n|  %4d     |%12.11s           |%-6s       |         %c       |", i + 1, entry_list->entry_name[i], type, '#');
         }
         /*If the entry is file*/
         else
         {
             strcpy(type, "File");
-            printf("\n|  %4d     |%12s           |%-6s       | %8d Bytes  |", i + 1, entry_list->entry_name[i], type, entry_list->entry_size[i]);
+            printf("\n|  %4d     |%12.11s           |%-6s       | %8d Bytes  |", i + 1, entry_list->entry_name[i], type, entry_list->entry_size[i]);
         }
     }
     printf("\n+-----------+-------------------------------------------------------+");
@@ -158,11 +165,19 @@ int main(void)
 {
     fatfs_entry_list_struct_t dir_list; /*dir_list stores the directory entry list*/
     disk_state_enum_t disk_state;       /*disk_state stores the status of the disk*/
+    kmc_dev_t *disk = NULL;             /*disk is the handle of the disk image*/
     int32_t choice = 0;                 /*choice stores the choice of user*/
     uint32_t check_choice = 0;          /*check_choice is used to check if user enter a right format input*/
 
+    /*Open the disk image with a sector cache, navigating back and forth re-reads the same directories*/
+    disk = kmc_open("floppy.img", KMC_ACCESS_PREAD);
+    kmc_cache_enable(disk, APP_SECTOR_CACHE_BYTES);
+
+    /*Expand the FAT and index every chain at mount, the tables of a floppy are only a few KB*/
+    fatfs_set_mount_options(FATFS_OPT_EXPAND_FAT | FATFS_OPT_CHAIN_INDEX);
+
     /*Initial the FATfs layer*/
-    disk_state = fatfs_init("floppy.img");
+    disk_state = fatfs_mount(disk);
 
     /*Check if the disk is in good state*/
     if (GOOD_CONDITION == disk_state)
@@ -196,6 +211,7 @@ int main(void)
             if (choice == 0)
             {
                 fatfs_de_init();
+                kmc_close(disk);
                 exit(0);
             }
             /*If the user choice is a folder entry*/
@@ -204,10 +220,7 @@ int main(void)
                 /*Clear the screen*/
                 system("cls");
 
-                /*Clear the current directory entry list*/
-                fatfs_clear_dir_list();
-
-                /*Get the directory entry list of the user choice*/
+                /*Get the directory entry list of the user choice, it replaces the current one*/
                 dir_list = fatfs_read_dir(dir_list.first_logical_cluster[choice - 1]);
 
                 /*Print the directory entry list to console*/
@@ -249,6 +262,9 @@ int main(void)
         app_print_disk_state(disk_state);
     }
 
+    /*Close the disk image*/
+    kmc_close(disk);
+
     return 0;
 }
 /*End of file*/